@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2026 yarp-wholebodyinterface authors
+ *
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#ifndef WB_FORCE_TORQUE_ESTIMATOR_YARP_H
+#define WB_FORCE_TORQUE_ESTIMATOR_YARP_H
+
+#include <wbi/wbiID.h>
+
+#include <iDynTree/Estimation/ExtWrenchesAndJointTorquesEstimator.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+namespace yarpWbi
+{
+    /** Unknown external wrenches of a set of contact links, with the position of each contact in the estimator output. */
+    struct contactConfiguration
+    {
+        iDynTree::LinkUnknownWrenchContacts unknowns;
+        std::vector<iDynTree::LinkIndex>    contactLinks;       ///< link of each contact, in the order of the contact list
+        std::vector<size_t>                 contactIndices;     ///< index of each contact among the contacts of its link
+    };
+
+    /**
+     * Model based estimation of force/torque quantities from the six axis force/torque sensors,
+     * used by the yarpWholeBodyEstimator thread.
+     *
+     * The model (with its force/torque sensors) is loaded from the urdf file and is private to the
+     * estimator, so it is never shared with the threads using the iWholeBodyModel. The kinematics
+     * is propagated from a frame assumed fixed with respect to the world, with gravity expressed in that frame.
+     * Joints of the model not read by the estimator are kept in their zero position.
+     *
+     * All the buffers are allocated when the joint and sensor lists are set, so that the
+     * estimation functions called in the estimator loop do not allocate memory.
+     * The unknowns of each set of contact links are built the first time the set is used
+     * and cached, so switching between contact configurations does not allocate memory either.
+     */
+    class modelBasedForceTorqueEstimator
+    {
+    protected:
+        bool initDone;
+        iDynTree::ExtWrenchesAndJointTorquesEstimator estimator;
+        iDynTree::FrameIndex fixedFrame;
+        iDynTree::Vector3 gravity;
+
+        ///< kinematics buffers
+        iDynTree::JointPosDoubleArray  jointPos;
+        iDynTree::JointDOFsDoubleArray jointVel;
+        iDynTree::JointDOFsDoubleArray jointAcc;
+
+        ///< for each joint of the estimator, its dof in the model (-1 if not in the model)
+        std::vector<int> jointDofs;
+        ///< for each joint torque output of the estimator, its dof in the model (-1 if not in the model)
+        std::vector<int> torqueDofs;
+        ///< for each force/torque sensor of the estimator, its index in the model sensors (-1 if not in the model)
+        std::vector<int> ftSensorIndices;
+
+        ///< gravity compensation: the only unknown wrench is applied on the fixed frame
+        iDynTree::LinkUnknownWrenchContacts compensationUnknowns;
+        iDynTree::SensorsMeasurements       predictedFT;
+        iDynTree::LinkContactWrenches       predictedContactWrenches;
+        iDynTree::JointDOFsDoubleArray      predictedJointTorques;
+        iDynTree::Wrench                    predictedWrench;
+
+        ///< external wrench estimation
+        std::map<std::string, contactConfiguration> contactConfigurations;   ///< cache of the contact configurations, by list of contact frames
+        contactConfiguration *              activeContacts;
+        iDynTree::SensorsMeasurements       measuredFT;
+        iDynTree::Wrench                    measuredWrench;
+        iDynTree::LinkContactWrenches       estimatedContactWrenches;
+        iDynTree::JointDOFsDoubleArray      estimatedJointTorques;
+
+    public:
+        modelBasedForceTorqueEstimator();
+
+        /**
+         * Load the model and its force/torque sensors.
+         * @param urdfFilePath path of the urdf file.
+         * @param fixedFrameName frame assumed fixed with respect to the world (if empty, the default base link of the model).
+         * @param gravity gravity acceleration (3 elements) expressed in the fixed frame.
+         * @return true if successful, false otherwise
+         */
+        bool init(const std::string & urdfFilePath, const std::string & fixedFrameName, const double * gravity);
+
+        /** Map the joints read by the estimator (in order) to the dofs of the model. */
+        bool setJointList(const wbi::IDList & joints);
+
+        /**
+         * Map the joint torques output by the estimator (in order) to the dofs of the model.
+         * @return false if some joints are not in the model: their torques can not be estimated and are not written.
+         */
+        bool setJointTorqueList(const wbi::IDList & joints);
+
+        /** @return true if the torque of the j-th joint of setJointTorqueList can be estimated. */
+        bool canEstimateJointTorque(const int j) const;
+
+        /** Map the force/torque sensors read by the estimator (in order) to the sensors of the model. */
+        bool setForceTorqueSensorList(const wbi::IDList & ftSensors);
+
+        /** @return the number of force/torque sensors set with setForceTorqueSensorList. */
+        int getNrOfForceTorqueSensors() const;
+
+        /**
+         * Update the kinematics of the model.
+         * @param q joint positions, dq joint velocities, ddq joint accelerations, in the order of setJointList
+         */
+        bool updateKinematics(const double * q, const double * dq, const double * ddq);
+
+        /**
+         * Remove from the force/torque measurements the wrench due to the weight and the motion of the links
+         * beyond each sensor (with respect to the fixed frame), computed with the last updated kinematics.
+         * @param ft measured wrenches (6 elements for each sensor, force then torque, in sensor frame).
+         * @param compensatedFT output compensated wrenches (same layout, can be the same buffer of ft).
+         */
+        bool computeCompensatedForceTorque(const double * ft, double * compensatedFT);
+
+        /**
+         * Set the frames where external wrenches can be applied (one unknown full wrench in the origin of each frame).
+         * Each subtree of the model delimited by the force/torque sensors should contain at least one contact.
+         */
+        bool setContactFrames(const wbi::IDList & contactFrames);
+
+        /** @return true if the frame exists in the model, so that it can be used as contact frame. */
+        bool hasFrame(const wbi::ID & frame) const;
+
+        /** @return the number of contact frames set with setContactFrames. */
+        int getNrOfContactFrames() const;
+
+        /**
+         * Estimate the external wrenches and the joint torques from the force/torque measurements, with the last updated kinematics.
+         * All the force/torque sensors of the model should be in the list set with setForceTorqueSensorList.
+         * @param ft measured wrenches (6 elements for each sensor, force then torque, in sensor frame).
+         * @param externalWrenches output wrenches (6 elements for each contact frame, force then torque), applied
+         *        in the origin of the contact frame and expressed in the orientation of the link of the frame (ignored if 0).
+         * @param jointTorques output joint torques, in the order of setJointTorqueList (ignored if 0).
+         *        The elements of the joints not in the model are not written.
+         */
+        bool estimateExternalWrenchesAndJointTorques(const double * ft, double * externalWrenches, double * jointTorques=0);
+    };
+}
+
+#endif
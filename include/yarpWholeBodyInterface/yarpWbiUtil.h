@@ -62,8 +62,36 @@ namespace yarpWbi
                           yarp::dev::PolyDriver *&pd,
                         const std::string &bodyPartName);
 
+    /** Open a single remote control board remapper driver covering the specified axes.
+     * @param localName Name to use as stem for the names of the YARP ports to open.
+     * @param robotName Name of the robot to connect to.
+     * @param pd Pointer to the poly driver to instanciate.
+     * @param axesNames Names of the axes exposed by the remapper, in the desired order.
+     * @param controlBoardNames Names of the robot controlboards that contain the axes.
+     * @return True if the operation succeeded, false otherwise. */
+    bool openRemapperPolyDriver(const std::string &localName,
+                                const std::string &robotName,
+                                yarp::dev::PolyDriver *&pd,
+                                const std::vector<std::string> &axesNames,
+                                const std::vector<std::string> &controlBoardNames);
+
     bool closePolyDriver(yarp::dev::PolyDriver *&pd);
 
+    /** Gather elements of a buffer: dst[i] = src[index[i]] for i in [0,n).
+     * @param src Buffer from which the elements are read.
+     * @param index Array of n positions in src.
+     * @param n Number of elements to gather.
+     * @param dst Buffer of (at least) n elements in which the gathered elements are written. */
+    void gather(const double * src, const int * index, const int n, double * dst);
+
+    /** Gather and scale elements of a buffer: dst[i] = scale*src[index[i]] for i in [0,n).
+     * @param src Buffer from which the elements are read.
+     * @param index Array of n positions in src.
+     * @param n Number of elements to gather.
+     * @param scale Scaling factor applied to each gathered element.
+     * @param dst Buffer of (at least) n elements in which the gathered elements are written. */
+    void gatherAndScale(const double * src, const int * index, const int n, const double scale, double * dst);
+
 
     /*
     bool loadControlBoardsFromConfig(yarp::os::Property & wbi_yarp_properties,
@@ -105,14 +133,38 @@ namespace yarpWbi
                                std::vector<std::string> & ports,
                                const std::string group_name);
 
+    /**
+     * Load the ports and the carriers of the sensors from the group group_name.
+     *
+     * The port of a sensor can be specified as "sensorName /port" (using the default carrier)
+     * or as "sensorName (/port carrier)". The default carrier is udp, and it can be changed
+     * with the "defaultCarrier carrier" option in the same group (e.g. shmem or fast_tcp
+     * when the sensor streams are published on the same host).
+     */
+    bool loadSensorPortsFromConfig(yarp::os::Property & wbi_yarp_properties,
+                               const wbi::IDList & sensorIdList,
+                               std::vector<std::string> & ports,
+                               std::vector<std::string> & carriers,
+                               const std::string group_name);
+
     bool loadFTSensorPortsFromConfig(yarp::os::Property & wbi_yarp_properties,
                                  wbi::IDList & sensorIdList,
                                  std::vector<std::string> & ports);
 
+    bool loadFTSensorPortsFromConfig(yarp::os::Property & wbi_yarp_properties,
+                                 wbi::IDList & sensorIdList,
+                                 std::vector<std::string> & ports,
+                                 std::vector<std::string> & carriers);
+
     bool loadIMUSensorPortsFromConfig(yarp::os::Property & wbi_yarp_properties,
                                       wbi::IDList & sensorIdList,
                                       std::vector<std::string> & ports);
 
+    bool loadIMUSensorPortsFromConfig(yarp::os::Property & wbi_yarp_properties,
+                                      wbi::IDList & sensorIdList,
+                                      std::vector<std::string> & ports,
+                                      std::vector<std::string> & carriers);
+
     /**
      * Get the requested joint id list from a yarp::os::Searchable
      *
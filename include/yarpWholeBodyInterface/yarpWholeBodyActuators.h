@@ -25,6 +25,7 @@
 #include <yarp/dev/IVelocityControl2.h>
 #include <yarp/os/RateThread.h>
 #include <yarp/os/Semaphore.h>
+#include <yarp/os/Mutex.h>
 #include <yarp/os/BufferedPort.h>
 #include <iCub/ctrl/adaptWinPolyEstimator.h>
 #include <iCub/ctrl/filters.h>
@@ -35,6 +36,7 @@ namespace yarp {
     namespace os {
         class Property;
         class Value;
+        class Bottle;
     }
 }
 
@@ -69,6 +71,34 @@ namespace yarpWbi
 
     typedef std::vector< std::vector<yarpWBAControlledJoint> > yarpWBAControlledJointsControlBoardList;
 
+    /**
+     * Helper structure for representing the references sent with a single call
+     * to a controlboard, for all the joints of the controlboard in a given control mode.
+     * It is compiled when the control modes change, so that sending the references
+     * does not check the empty modes nor allocate memory.
+     */
+    struct yarpWBADispatchEntry
+    {
+        int wbi_controlboard_id;
+        wbi::ControlMode controlMode;
+        bool allAxes;                       //< true if the references of all the axes of the controlboard are sent
+        double scale;                       //< conversion factor from wbi to yarp units
+        std::vector<int> wbi_ids;           //< wbi id of each joint
+        std::vector<int> yarp_axes;         //< controlboard axis of each joint
+        std::vector<int> bufferIndices;     //< position of the reference of each joint in references
+        std::vector<double> references;     //< buffer of the references sent to the controlboard
+
+        ///< deadband filter (referenceDeadband option)
+        bool filtered;                      //< true if the references equal (within the deadband) to the last sent ones are not sent
+        bool sentOnce;                      //< true after the references have been sent at least once
+        double lastRefreshTime;             //< time of the last call sending the references of all the joints
+        std::vector<double> deadbands;      //< deadband of each joint (in yarp units)
+        std::vector<double> lastSent;       //< last reference sent for each joint (in yarp units)
+        std::vector<int> changedJoints;     //< joints whose reference is out of the deadband
+        std::vector<int> changed_yarp_axes; //< buffers for sending only the references of the changed joints
+        std::vector<double> changedReferences;
+    };
+
     /**
      * Helper class for efficiently storing information about joints controlled
      * by the yarpWholeBodyActuactors interfaces, divided for controlboards
@@ -83,9 +113,45 @@ namespace yarpWbi
         yarpWBAControlledJointsControlBoardList torqueControlledJoints;
         yarpWBAControlledJointsControlBoardList pwmControlledJoints;
 
+        std::vector<yarpWBADispatchEntry> dispatchPlan; //< Calls needed to send the references of all joints, only for the (controlboard, mode) pairs with joints
+
         bool reset(const int nrOfControlBoards);
     };
 
+    /** Last references of a control mode commanded through the wbi, for all joints (cacheControlReferences option). */
+    struct yarpWBAReferenceShadow
+    {
+        std::vector<double> references;     //< reference of each joint (in wbi units)
+        std::vector<bool> valid;            //< true if the reference of the joint is known
+        double lastVerificationTime;        //< time of the last reading of the references of all joints from the controlboards
+    };
+
+    /** Number of references of a joint modified by the reference limiter (referenceLimiter option). */
+    struct ReferenceLimiterStatistics
+    {
+        unsigned long saturations;      ///< references outside the limits of the control mode (position limits, maximum velocity, torque or pwm)
+        unsigned long rateLimitations;  ///< references changing faster than the maximum rate of the control mode
+    };
+
+    /** Statistics of the deadband filter of the references. */
+    struct ReferenceFilterStatistics
+    {
+        unsigned long sent;         ///< joint references sent to the controlboards by the filtered calls
+        unsigned long filtered;     ///< joint references not sent because within the deadband of the last sent one
+    };
+
+    /** Statistics of the references sent by the asynchronous writer of a controlboard. */
+    struct ReferenceWriterStatistics
+    {
+        unsigned long sent;         ///< number of references sent to the controlboard
+        unsigned long overwritten;  ///< number of references replaced by a newer one before being sent
+        unsigned long failed;       ///< number of references the controlboard failed to receive
+    };
+
+    class yarpWholeBodyActuatorsWriter;
+    class yarpWholeBodyActuatorsModeVerifier;
+    class PIDList;
+
     /**
      * Class for communicating with motor control boards of robot supporting a yarp interface.
      *
@@ -101,9 +167,36 @@ namespace yarpWbi
      *
      * \todo document the other parameters
      *
+     * The options specific to the actuators should be placed in the WBI_ACTUATORS_OPTIONS group.
+     *
+     * # WBI_ACTUATORS_OPTIONS
+     *
+     * | Parameter name | Type | Units | Default Value | Required | Description | Notes |
+     * |:--------------:|:------:|:-----:|:-------------:|:--------:|:-----------:|:-----:|
+     * | asyncReferences | - | - | - | No | If present, setControlReference for all the joints does not wait for the controlboards: the references of each controlboard are left in a single slot mailbox and sent by a writer thread dedicated to the controlboard. If a reference is still in the mailbox when a new one arrives, the old one is discarded (and counted, see getReferenceWriterStatistics). | setControlReference for a single joint and setControlMode are still synchronous. Errors of the controlboards are printed by the writer threads and are not returned by setControlReference. |
+     * | referenceDeadband | double | rad or duty cycle | - | No | If present, setControlReference for all the joints does not send the position, direct position and PWM references whose change since the last sent one is not greater than this deadband (0 only suppresses the identical references, see getReferenceFilterStatistics). When only some joints of a controlboard change, only their references are sent, with a single call (one call per joint for PWM). | In the units of the control mode of the joint. Velocity and torque references are never filtered, as the controlboards stop the joints whose streamed references are not refreshed. |
+     * | referenceDeadbandJoints | list of (jointName deadband) pairs | rad or duty cycle | - | No | Deadband of specific joints, overriding referenceDeadband. | Enables the deadband filter for the other joints with a 0 deadband, if referenceDeadband is not present. |
+     * | referenceRefreshPeriod | double | seconds | 0.05 | No | Period after which the filtered references of all the joints are sent again, even if they did not change. | At most 0.1 seconds, below the reference watchdog of the controlboards. A reference is also always sent after a control mode change. |
+     * | controlModeVerificationPeriod | int | milliseconds | 1000 | No | setControlMode does not switch the joints already in the requested mode (as cached by the wbi): if no joint has to be switched, only the references are sent, as with setControlReference. With this period, a thread checks the cached modes against the controlboards: a joint found in another mode (e.g. after a fault) is switched again at the next setControlMode. | If 0, the cached modes are not verified. The cache is initialized with the modes read from the controlboards at init. |
+     * | cacheControlReferences | - | - | - | No | If present, getControlReferences returns the last references commanded through this object with setControlReference, without contacting the controlboards. The references not commanded yet (or of joints whose control mode changed) are read from the controlboards the first time. | The cached value is the commanded one: it does not reflect a failed setControlReference, a deadband, or a reference changed by another module until the next verification. getControlReferencesFromControlBoards always reads the controlboards. |
+     * | controlReferencesVerificationPeriod | double | seconds | 1.0 | No | With cacheControlReferences, period after which getControlReferences for all joints reads the references from the controlboards again. | If 0, the cache is never verified. |
+     * | referenceLimiter | - | - | - | No | If present, setControlReference (and the references passed to setControlMode) are clamped before being sent: position and direct position references to the joint limits, the other modes to the maximum references below, and all of them to the maximum rate of their control mode. The modified references are counted, see getReferenceLimiterStatistics. | After a control mode change, the rate of the first reference is limited with respect to the measured position (position modes) or the current reference of the controlboard (other modes), if it can be read (with a single read per controlboard). Only the references actually sent to the controlboards advance the limiter. |
+     * | referencePositionLimits | list of (jointName min max) | rad | limits of the controlboards | No | With referenceLimiter, position limits of specific joints, overriding the ones read from the controlboards. | |
+     * | maxVelocityReference | double | rad/s | - | No | With referenceLimiter, saturation of the velocity references. | |
+     * | maxTorqueReference | double | Nm | - | No | With referenceLimiter, saturation of the torque references. | |
+     * | maxPWMReference | double | duty cycle | - | No | With referenceLimiter, saturation of the PWM references. | |
+     * | maxPositionReferenceRate | double | rad/s | - | No | With referenceLimiter, maximum rate of change of the position and direct position references. | |
+     * | maxVelocityReferenceRate | double | rad/s^2 | - | No | With referenceLimiter, maximum rate of change of the velocity references. | |
+     * | maxTorqueReferenceRate | double | Nm/s | - | No | With referenceLimiter, maximum rate of change of the torque references. | |
+     * | maxPWMReferenceRate | double | 1/s | - | No | With referenceLimiter, maximum rate of change of the PWM references. | |
+     * | parallelReferences | - | - | - | No | If present, setControlReference for all the joints sends the references of each controlboard from a writer thread dedicated to the controlboard, and returns when all the controlboards have received them. The call is still synchronous, but takes the time of the slowest controlboard instead of the sum of the times of all the controlboards. | Not compatible with asyncReferences. The writer statistics are available as with asyncReferences. |
+     *
      */
     class yarpWholeBodyActuators : public wbi::iWholeBodyActuators
     {
+        friend class yarpWholeBodyActuatorsWriter;
+        friend class yarpWholeBodyActuatorsModeVerifier;
+
     protected:
         // true after init has been called, false before
         bool                               initDone;
@@ -129,6 +222,14 @@ namespace yarpWbi
 
         // current control mode of each joint (size: jointIdList.size())
         std::vector<wbi::ControlMode>        currentCtrlModes;
+        // true for the joints whose controlboard reported a mode different from currentCtrlModes (size: jointIdList.size())
+        std::vector<bool>                    ctrlModeMismatch;
+        // mutex protecting currentCtrlModes and ctrlModeMismatch from the control mode verifier
+        yarp::os::Mutex                      ctrlModesMutex;
+        // buffer of the control modes read from each controlboard
+        std::vector< std::vector<int> >      controlBoardModesBuffer;
+        // thread verifying currentCtrlModes against the controlboards (0 if controlModeVerificationPeriod is 0)
+        yarpWholeBodyActuatorsModeVerifier * modeVerifier;
 
         // Map containing parameters to be read at initialization time
         yarp::os::Property wbi_yarp_properties;
@@ -142,6 +243,7 @@ namespace yarpWbi
         std::vector<yarp::dev::IInteractionMode*>     iinteraction;
         std::vector<yarp::dev::IVelocityControl2*>    ivel;
         std::vector<yarp::dev::IPidControl*>          ipid;
+        std::vector<yarp::dev::IEncoders*>            ienc;   // 0 if the controlboard has no encoders interface
 
         // Temporary defined open loop as void to be compatible with both YARP master and devel
         // see https://github.com/robotology/yarp-wholebodyinterface/issues/72
@@ -150,6 +252,48 @@ namespace yarpWbi
 
         std::vector<yarp::sig::Vector>   controlBoardReadingBuffer;
 
+        // writer threads of the controlboards (one for each controlboard, empty if neither asyncReferences nor parallelReferences is set)
+        std::vector<yarpWholeBodyActuatorsWriter*> referenceWriters;
+        // true if setControlReference waits for the writer threads (parallelReferences option)
+        bool synchronousReferenceWriters;
+
+        // deadband filter of the references (referenceDeadband, referenceDeadbandJoints and referenceRefreshPeriod options)
+        bool                referenceFilterEnabled;
+        std::vector<double> referenceDeadbands;     // deadband of each joint in wbi units (size: jointIdList.size())
+        double              referenceRefreshPeriod; // period (seconds) of the forced sending of all the references
+        ReferenceFilterStatistics filterStatistics;
+        yarp::os::Mutex     filterStatisticsMutex;
+
+        // reference limiter (referenceLimiter option)
+        bool                referenceLimiterEnabled;
+        std::vector<double> jointPositionMin;       // position limits of each joint (rad)
+        std::vector<double> jointPositionMax;
+        double              maxVelocityReference;   // saturations of the other control modes (<= 0 if not limited)
+        double              maxTorqueReference;
+        double              maxPWMReference;
+        double              maxPositionReferenceRate;   // rate limits for each control mode (<= 0 if not limited)
+        double              maxVelocityReferenceRate;
+        double              maxTorqueReferenceRate;
+        double              maxPWMReferenceRate;
+        // limits of each joint in its current control mode, updated when the control modes change
+        std::vector<double> limiterMin;
+        std::vector<double> limiterMax;
+        std::vector<double> limiterMaxRate;
+        // last limited reference of each joint, to limit the rate of the next one
+        std::vector<double> limiterLast;
+        std::vector<double> limiterLastTime;
+        std::vector<bool>   limiterLastValid;
+        std::vector<wbi::ControlMode> limiterModes; // control mode the limits of each joint were computed for
+        std::vector<double> limitedReferences;
+        std::vector< std::vector<double> > limiterSeeds; // references read from each controlboard to seed the limiter
+        std::vector<ReferenceLimiterStatistics> limiterStatistics;
+        yarp::os::Mutex     limiterStatisticsMutex;
+
+        // cache of the control references for each control mode (empty if cacheControlReferences is not set)
+        std::map<wbi::ControlMode, yarpWBAReferenceShadow> referenceShadows;
+        yarp::os::Mutex     referenceShadowsMutex;
+        double              controlReferencesVerificationPeriod; // period (seconds) of the reading of the cached references from the controlboards
+
         /**
          * Open the yarp PolyDriver relative to control board bodyPartNames[bodyPart].
          */
@@ -161,14 +305,100 @@ namespace yarpWbi
          */
         bool updateControlledJointsForEachControlBoard();
 
+        /**
+         * Add to the dispatch plan the call sending the references of the joints
+         * of a controlboard in a control mode (nothing if there are no such joints).
+         */
+        void addDispatchEntry(int wbi_controlboard_id, wbi::ControlMode controlMode,
+                              const std::vector<yarpWBAControlledJoint> & joints);
+
+        /** Send the references of a dispatch plan entry to its controlboard. */
+        bool sendDispatchEntry(yarpWBADispatchEntry & entry, const double *ref);
+
+        /**
+         * Send the references (in yarp units) of a subset of the axes of a controlboard in a control mode,
+         * with the subset call of the control mode (one call per axis for PWM, that has no subset call).
+         */
+        bool sendJointReferences(int wbi_controlboard_id, wbi::ControlMode controlMode,
+                                 int nrOfJoints, const int *axes, const double *references);
+
+        /**
+         * Send only the references of the changed joints of a dispatch plan entry
+         * (entry.changedJoints), with the subset call of the control mode.
+         */
+        bool sendDispatchEntryChanges(yarpWBADispatchEntry & entry, const double *ref, int nrOfChangedJoints);
+
+        /** Read the options of the reference limiter from the WBI_ACTUATORS_OPTIONS group and the position limits from the controlboards. */
+        bool configureReferenceLimiter(yarp::os::Bottle & actuators_opt_bot);
+
+        /**
+         * Update the limits of the joints whose control mode changed, seeding their last reference
+         * with the measured position (position modes) or the current reference of the controlboard.
+         */
+        void updateReferenceLimiter();
+
+        /**
+         * Read in limiterSeeds, with a single call, the values the rate of the first references of the axes of a
+         * controlboard in a control mode is limited from (measured positions or references of the controlboard).
+         */
+        bool readReferenceLimiterSeeds(int wbi_controlboard_id, wbi::ControlMode controlMode);
+
+        /**
+         * Clamp the references of the joint(s) to the limits of their control mode, in a single pass over all the joints.
+         * @param limitedJoints if not null, only the flagged joints (indexed as the wbi joints) are limited: the references
+         *        of the others are copied unchanged and their limiter state is kept, as they are not going to be sent.
+         * @return the limited references (the same layout of ref), or ref itself if the referenceLimiter option is not set.
+         */
+        double * limitReferences(double *ref, int joint = -1, const std::vector<bool> * limitedJoints = 0);
+
+        /** Store in the cache the references commanded to the joint(s) (nothing if cacheControlReferences is not set). */
+        void updateReferenceShadows(const double *ref, int joint = -1);
+
+        /** Mark as unknown the cached references of the joints flagged in joints (indexed by wbi joint). */
+        void invalidateReferenceShadows(const std::vector<bool> & joints);
+
+        /** Read the options of the deadband filter of the references from the WBI_ACTUATORS_OPTIONS group. */
+        bool configureReferenceFilter(yarp::os::Bottle & actuators_opt_bot);
+
+        /** Send the references of all the dispatch plan entries of a controlboard. */
+        bool sendControlBoardReferences(int wbi_controlboard_id, const double *ref);
+
+        /** Start (stop) the writer threads of the controlboards used with the asyncReferences and parallelReferences options. */
+        bool startReferenceWriters();
+        void stopReferenceWriters();
+
+        /**
+         * Wait for the writer threads to finish the references they are sending and discard the pending ones,
+         * so that the dispatch plan can be changed. The writers are blocked until resumeReferenceWriters is called.
+         */
+        void pauseReferenceWriters();
+        void resumeReferenceWriters();
+
+        /**
+         * Read the control modes of the controlboards into currentCtrlModes, at initialization.
+         * Joints in a mode unknown to the wbi are marked as mismatching.
+         */
+        bool readControlModes();
+
+        /** Called by the control mode verifier: mark the joints whose controlboard mode differs from currentCtrlModes. */
+        void verifyControlModes();
+
         /** Convert the control modes defined in yarp/dev/IControlMode.h into the one defined in wbi. */
         wbi::ControlMode yarpToWbiCtrlMode(int yarpCtrlMode);
 
+        /** Convert the control modes defined in wbi into the one defined in yarp/dev/IControlMode.h. */
+        int wbiToYarpCtrlMode(wbi::ControlMode controlMode);
+
+        /** Get the type of the pids used by a control mode. @return false if the control mode has no pids. */
+        bool wbiToYarpPidType(wbi::ControlMode controlMode, yarp::dev::PidControlTypeEnum & pidType);
+
         /** Set the reference speed for the position control of the specified joint(s). */
         virtual bool setReferenceSpeed(double *rspd, int joint = -1);
 
         /** Set the proportional, derivative and integrale gain for the current joint(s) controller.
-         * If you want to leave some values unchanged simply pass NULL to the corresponding gain
+         * If you want to leave some values unchanged simply pass NULL to the corresponding gain.
+         * Only the joints controlled in torque are affected; for all joints, the pids are read and written
+         * with one call for each controlboard.
          * @param pValue Value(s) of the proportional gain.
          * @param dValue Value(s) of the derivative gain.
          * @param iValue Value(s) of the integral gain.
@@ -182,11 +412,25 @@ namespace yarpWbi
          * @return True if operation succeeded, false otherwise. */
         bool setControlOffset(const double *value, int joint = -1);
 
+        /**
+         * Set (get) the pids of all the joints, with one call for each controlboard
+         * (two if the wbi does not control all the axes of the controlboard, to preserve the pids of the other axes).
+         * @param pids pids of all the joints, in the order of the actuator list.
+         */
+        bool setPIDsAllJoints(yarp::dev::PidControlTypeEnum pidType, const yarp::dev::Pid *pids);
+        bool getPIDsAllJoints(yarp::dev::PidControlTypeEnum pidType, yarp::dev::Pid *pids);
+
         /**
          * Private, single joint only version of setControlMode
          */
         bool setControlModeSingleJoint(wbi::ControlMode controlMode, double *ref, int joint);
 
+        /**
+         * Private, all joints version of setControlMode: the joints are switched with one call for each control board,
+         * then the references are sent to all the joints in the mode, except the ones of the boards that failed to switch.
+         */
+        bool setControlModeAllJoints(wbi::ControlMode controlMode, double *ref);
+
         bool setInteractionModeSingleJoint(yarp::dev::InteractionModeEnum mode, int joint, wbi::Error *error);
 
         bool setImpedanceStiffness(double stiffness, int joint, wbi::Error *error);
@@ -246,6 +490,32 @@ namespace yarpWbi
          */
         virtual bool setControlReference(double *ref, int joint=-1);
 
+        /**
+         * Get the statistics of the asynchronous writer of a controlboard.
+         * @param controlBoard index of the controlboard (in the order of the controlboards of the configuration).
+         * @return false if neither asyncReferences nor parallelReferences option is set or the controlboard does not exist, true otherwise.
+         */
+        bool getReferenceWriterStatistics(int controlBoard, ReferenceWriterStatistics & statistics);
+
+        /**
+         * Get the number of references of a joint modified by the reference limiter.
+         * @param joint joint number.
+         * @return false if the referenceLimiter option is not set or the joint does not exist, true otherwise.
+         */
+        bool getReferenceLimiterStatistics(int joint, ReferenceLimiterStatistics & statistics);
+
+        /** Reset the counters of the reference limiter. */
+        void resetReferenceLimiterStatistics();
+
+        /**
+         * Get the number of joint references sent and suppressed by the deadband filter.
+         * @return false if neither referenceDeadband nor referenceDeadbandJoints option is set, true otherwise.
+         */
+        bool getReferenceFilterStatistics(ReferenceFilterStatistics & statistics);
+
+        /** Reset the counters of the deadband filter. */
+        void resetReferenceFilterStatistics();
+
         /**
          * Set a parameter (e.g. a gain) of one or more joint controllers.
          * @param paramId Id of the parameter.
@@ -262,7 +532,8 @@ namespace yarpWbi
          * @param controlMode control mode for which PIDs must be set
          * @param joint       joint number, if negative, all joints are considered.
          *
-         * @return true if operation succeeded, false otherwise.
+         * @return true if operation succeeded, false otherwise (also if the control mode has no pids:
+         *         position and direct position use the position pids, velocity and torque their own).
          */
         bool setPIDGains(yarp::dev::Pid *pids, wbi::ControlMode controlMode, int joint = -1);
 
@@ -273,10 +544,53 @@ namespace yarpWbi
          * @param[in] controlMode control mode for which PIDs must be set
          * @param[in] joint       joint number, if negative, all joints are considered.
          *
-         * @return true if operation succeeded, false otherwise.
+         * @return true if operation succeeded, false otherwise (also if the control mode has no pids:
+         *         position and direct position use the position pids, velocity and torque their own).
          */
         bool getPIDGains(yarp::dev::Pid *pids, wbi::ControlMode controlMode, int joint = -1);
 
+        /**
+         * Set the pids of all the joints for the specified control mode, with one call for each controlboard.
+         *
+         * @param pids        pids to be set (one for each actuator, in the order of the actuator list)
+         * @param controlMode control mode for which PIDs must be set
+         *
+         * @return true if operation succeeded, false otherwise.
+         */
+        bool setPIDGains(const PIDList &pids, wbi::ControlMode controlMode);
+
+        /**
+         * Get the pids of all the joints for the specified control mode, with one call for each controlboard.
+         *
+         * @param[out] pids        list with one element for each actuator
+         * @param[in] controlMode control mode for which PIDs must be read
+         *
+         * @return true if operation succeeded, false otherwise.
+         */
+        bool getPIDGains(PIDList &pids, wbi::ControlMode controlMode);
+
+        /**
+         * Set the impedance (stiffness and damping) of all the joints.
+         * The yarp impedance interface has no call for all the axes of a controlboard, so this is
+         * still one call for each joint, but without reading the previous values.
+         *
+         * @param stiffness stiffness of each joint, in the order of the actuator list
+         * @param damping   damping of each joint, in the order of the actuator list
+         *
+         * @return true if operation succeeded, false otherwise.
+         */
+        bool setFullImpedances(const double *stiffness, const double *damping, wbi::Error *error = 0);
+
+        /**
+         * Get the impedance (stiffness and damping) of all the joints.
+         *
+         * @param[out] stiffness stiffness of each joint, in the order of the actuator list
+         * @param[out] damping   damping of each joint, in the order of the actuator list
+         *
+         * @return true if operation succeeded, false otherwise.
+         */
+        bool getFullImpedances(double *stiffness, double *damping);
+
         /**
          * Set the motor torque parameters for a specific joint or a list of joints
          *
@@ -312,8 +626,21 @@ namespace yarpWbi
 
         virtual bool getControlProperty(std::string key, std::string &value, int joint = -1, ::wbi::Error *error = 0) const;
 
+        /**
+         * Get the references of the specified joint(s) in the specified control mode.
+         * With the cacheControlReferences option, the references commanded through this object are
+         * returned without contacting the controlboards (see getControlReferencesFromControlBoards).
+         */
         virtual bool getControlReferences(wbi::ControlMode controlMode, double *ref, int joint=-1);
 
+        /**
+         * Get the references of the specified joint(s) in the specified control mode, always reading them from the controlboards.
+         * @param controlMode control mode of the references.
+         * @param ref output references (one for each joint if joint is negative).
+         * @param joint joint number, if negative, all joints are considered.
+         */
+        bool getControlReferencesFromControlBoards(wbi::ControlMode controlMode, double *ref, int joint=-1);
+
     };
 }
 
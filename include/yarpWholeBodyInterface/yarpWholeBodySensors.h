@@ -20,11 +20,15 @@
 #define WBSENSORS_ICUB_H
 
 #include "yarpWholeBodyInterface/yarpWbiUtil.h"
+#include "yarpWholeBodyInterface/yarpWholeBodySensorsLog.h"
+#include "yarpWholeBodyInterface/yarpWholeBodySensorsTelemetry.h"
 
 #include <yarp/dev/ControlBoardInterfaces.h>
 #include <yarp/dev/IVelocityControl2.h>
+#include <yarp/dev/PreciselyTimed.h>
 #include <yarp/os/RateThread.h>
 #include <yarp/os/Semaphore.h>
+#include <yarp/os/Mutex.h>
 #include <yarp/os/BufferedPort.h>
 #include <iCub/ctrl/adaptWinPolyEstimator.h>
 #include <iCub/ctrl/filters.h>
@@ -52,6 +56,25 @@ namespace yarpWbi
         ENCODER_ACCELERATION
     };
 
+    /** List of the readings acquired from a controlboard, used as key of the per-controlboard read cache. */
+    enum ControlBoardReadingType
+    {
+        CONTROLBOARD_READING_ENCODER_POS,
+        CONTROLBOARD_READING_ENCODER_SPEED,
+        CONTROLBOARD_READING_ENCODER_ACCELERATION,
+        CONTROLBOARD_READING_PWM,
+        CONTROLBOARD_READING_TORQUE,
+        CONTROLBOARD_READING_TYPE_SIZE
+    };
+
+    /** Interpolation used to align the readings of different controlboards to a common time. */
+    enum TimestampAlignmentType
+    {
+        TIMESTAMP_ALIGNMENT_NONE,
+        TIMESTAMP_ALIGNMENT_LINEAR,
+        TIMESTAMP_ALIGNMENT_HERMITE
+    };
+
     /**
      * Struct for holding information about loaded accelerometers
      */
@@ -61,6 +84,20 @@ namespace yarpWbi
         std::string type_option;
     };
 
+    /**
+     * Calibration of a force/torque sensor: wrench = matrix*(raw - offset).
+     * Plain arrays are used (instead of fixed size Eigen types) to store it safely in std::vector.
+     */
+    struct FTSensorCalibration
+    {
+        bool   enabled;                 ///< false if the sensor is not calibrated (raw readings are returned)
+        double offset[6];               ///< offset of the raw readings
+        double matrix[36];              ///< calibration matrix, row major
+        int    rezeroSamplesRequested;  ///< number of samples to average for the pending re-zeroing (0 if none)
+        int    rezeroSamplesCollected;
+        double rezeroSum[6];
+    };
+
     /**
      * Struct for holding information about loaded accelerometers
      */
@@ -78,7 +115,33 @@ namespace yarpWbi
      * You can configure this object with a yarp::os::Property object, that you can
      * pass to the constructor. Alternativly you can set the Property through the setYarpWbiProperties method,
      * but in that case you have to set the property before calling the init method.
-     * 
+     *
+     * Options specific to the sensor interface should be placed in the WBI_SENSORS_OPTIONS group.
+     *
+     * # WBI_SENSORS_OPTIONS
+     *
+     * | Parameter name | Type | Units | Default Value | Required | Description | Notes |
+     * |:--------------:|:----:|:-----:|:-------------:|:--------:|:-----------:|:-----:|
+     * | readCache | - | - | - | No | If present, enable the per-controlboard read cache: all the readings of the same controlboard requested in the same read epoch are served by a single acquisition. | Requires an epoch driver: the epoch is advanced with advanceReadEpoch(), and the yarpWholeBodyStates estimator advances it at every cycle. Until the first advanceReadEpoch() the cache is not used, so a standalone yarpWholeBodySensors never returns stale readings. |
+     * | controlBoardBackend | string | - | remote_controlboard | No | Device used to read the controlboard related sensors: remote_controlboard opens one device for each controlboard, remapper opens a single remotecontrolboardremapper covering exactly the wbi joints, so each reading of the whole robot is a single interface call. | With remapper the wbi joint IDs must match the axis names exposed by the robot controlboards. |
+     * | logFile | string | - | - | No | If present, all the readings (readSensors and readSensor) are recorded with their timestamps in this file, in the binary format described in yarpWholeBodySensorsLog.h. | FT readings are recorded raw, before the calibration. Not available on Windows. |
+     * | logFileSize | int | MB | 256 | No | Size of the preallocated log file, readings exceeding it are dropped. | |
+     * | logFlushPeriod | int | ms | 100 | No | Period of the background flush of the log to disk. | |
+     * | timestampAlignment | string | - | - | No | If linear or hermite, the bulk readings of encoders and joint torques of all the controlboards are resampled (with linear or cubic Hermite interpolation) to a common reference time: the oldest among the latest timestamps of the read controlboards. The returned stamps are all equal to the reference time. | Single sensor reads are not aligned. With the remapper backend there is a single controlboard, so no alignment is performed. |
+     * | alignmentHistoryLength | int | - | 4 | No | Number of readings of each controlboard kept for the timestamp alignment. | Must be at least 2. |
+     * | telemetry | - | - | - | No | If present, read latency percentiles, timeouts, stale samples and sequence gaps are tracked for every controlboard and sensor port. | See getTelemetry(). |
+     * | telemetryPeriod | int | ms | - | No | If present (and telemetry is enabled), the telemetry is periodically published on the /<name>/sensors/telemetry:o port. | |
+     * | sensorPortProbeTimeout | double | s | 0 | No | If positive, at init the connection of each FT and IMU port waits up to this time for the first sample, to report the latency of the stream. | Sensors added after init are never probed, so adding them does not block the caller. |
+     * | replayLog | string | - | - | No | If present, yarpWholeBodyStates replays the readings recorded in this log instead of reading the robot sensors. | See yarpWholeBodySensorsReplay. |
+     * | replayRealTime | - | - | - | No | If present, the log is replayed following its original timing, otherwise as fast as possible. | |
+     *
+     * # WBI_YARP_FT_CALIBRATION
+     *
+     * The readings of the FT sensors listed in this group are calibrated as wrench = matrix*(raw - offset),
+     * in place in the buffers returned by readSensor and readSensors. Each line is in the form
+     * `sensorName (offset o0 ... o5) (matrix m00 m01 ... m55)`, with the matrix in row major order.
+     * Both elements are optional (defaults: zero offset and identity matrix).
+     * The offset can also be re-estimated online with requestFTsensorRezero.
      *
      */
     class yarpWholeBodySensors: public wbi::iWholeBodySensors
@@ -118,17 +181,33 @@ namespace yarpWbi
         //wbi::IDList            imuIdList;      // list of the IMU ids
         //wbi::IDList            ftSensIdList;   // list of the force/torque sensor ids
 
-        // LAST READING DATA (map controlboard numeric IDs (i.e. indeces of controlBoardNames vector) to data)
-        std::vector<yarp::sig::Vector>            qLastRead;
-        std::vector<yarp::sig::Vector>            qStampLastRead;
-        std::vector<yarp::sig::Vector>            pwmLastRead;
-        std::vector<yarp::sig::Vector>            torqueSensorsLastRead;
+        // LAST READING DATA
+        // The readings of all the controlboards are stored in contiguous arenas, the readings of
+        // the controlboard cb start at controlBoardArenaOffset[cb]. Encoder readings are stored in
+        // controlboard units (degrees) and converted to radians when gathered in wbi order.
+        std::vector<int>          controlBoardArenaOffset;
+        yarp::sig::Vector         qArena;
+        yarp::sig::Vector         dqArena;
+        yarp::sig::Vector         d2qArena;
+        yarp::sig::Vector         qStampArena;
+        yarp::sig::Vector         pwmArena;
+        yarp::sig::Vector         torqueArena;
+        yarp::sig::Vector         torqueStampArena;
+        ///< acquisition buffers with the layout of the arenas, indexed by ControlBoardReadingType
+        std::vector<yarp::sig::Vector> readScratchArena;
+        std::vector<yarp::sig::Vector> readScratchStampArena;
+
+        // GATHER INDECES (map wbi numeric sensor ids to the position of their reading in the arenas)
+        std::vector<int>          encoderGatherIndex;
+        std::vector<int>          pwmGatherIndex;
+        std::vector<int>          torqueGatherIndex;
 
         // the "key" of these vectors is the wbi numeric id
         std::vector<yarp::sig::Vector>  imuLastRead;
         std::vector<double>  imuStampLastRead;
         std::vector<yarp::sig::Vector>  ftSensLastRead;
         std::vector<double>  ftStampSensLastRead;
+        std::vector<bool>    ftNewSample;      ///< whether each FT sensor had a new sample in the last bulk read (protected by ftCalibrationMutex)
         std::vector<yarp::sig::Vector> accLastRead;
         std::vector<double>  accStampLastRead;
 
@@ -139,6 +218,7 @@ namespace yarpWbi
         std::vector<void*>     iopl;   // interface to read motor PWM
         std::vector<yarp::dev::PolyDriver*>           dd; //device drivers
         std::vector<yarp::dev::ITorqueControl*>       itrq;  // interface to read joint torques
+        std::vector<yarp::dev::IPreciselyTimed*>      itrqTimed;  // interface to get the acquisition time of joint torques (if available)
 
         // input ports (the key of the maps is the wbi numeric sensor id)
         std::vector< yarp::os::BufferedPort<yarp::sig::Vector>*>   portsFTsens;
@@ -149,6 +229,147 @@ namespace yarpWbi
         //  from another sensor, such as the IMU)
         std::vector< AccelerometerRuntimeInfo > accelerometersReferenceIndeces;
 
+        // READ CACHE
+        bool                        readCacheEnabled;
+        unsigned long               readEpoch;      ///< current read epoch (0 until the first advanceReadEpoch)
+        yarp::os::Mutex             readEpochMutex; ///< the epoch is advanced by the estimator and read by every reader
+        ///< epoch of the last acquisition, indexed by ControlBoardReadingType and controlboard numeric id
+        std::vector< std::vector<unsigned long> > controlBoardReadEpoch;
+
+        // CONTROLBOARD REMAPPER BACKEND
+        bool                        useControlBoardRemapper;
+        ///< names of the robot controlboards remapped by the remapper device
+        std::vector<std::string>    remappedControlBoardNames;
+        ///< axes of the remapper device, in the order used by the remapper
+        wbi::IDList                 remappedAxesList;
+
+        /** Open the device driver of the specified controlboard, using the configured backend. */
+        bool openControlBoardDriver(const int controlBoard);
+
+        // TIMESTAMP ALIGNMENT
+        TimestampAlignmentType      timestampAlignment;
+        int                         alignmentHistoryLength;
+        ///< ring buffers of the last readings, indexed by ControlBoardReadingType: [slot*arenaSize + arena offset + axis]
+        std::vector<yarp::sig::Vector>  alignmentHistoryData;
+        ///< timestamps of the ring buffers, indexed by ControlBoardReadingType: [slot*nrOfControlBoards + controlboard]
+        std::vector<yarp::sig::Vector>  alignmentHistoryTime;
+        ///< slot of the newest reading and number of readings in the ring buffers, indexed by ControlBoardReadingType and controlboard
+        std::vector< std::vector<int> > alignmentHistoryHead;
+        std::vector< std::vector<int> > alignmentHistoryCount;
+        ///< readings resampled at the reference time, indexed by ControlBoardReadingType (same layout of the arenas)
+        std::vector<yarp::sig::Vector>  alignedArena;
+
+        /** Get the arena of a type of controlboard reading. */
+        yarp::sig::Vector & controlBoardArena(const ControlBoardReadingType type);
+
+        /** Store the last acquired reading of a controlboard in the alignment history (if it is a new sample). */
+        void pushAlignmentHistory(const ControlBoardReadingType type, const int controlBoard, const double stamp);
+
+        /**
+         * Resample the readings of the listed controlboards at their common reference time,
+         * storing them in alignedArena[type].
+         * @return the reference time.
+         */
+        double alignControlBoards(const ControlBoardReadingType type, const std::vector<int> & controlBoardList);
+
+        /** Resample the readings of a controlboard at time t, storing them in alignedArena[type]. */
+        void resampleControlBoard(const ControlBoardReadingType type, const int controlBoard, const double t);
+
+        // SENSOR PORTS
+        ///< time waited at init for the first sample of each sensor port (0: the connection is reported without waiting)
+        double                      sensorPortProbeTimeout;
+
+        // SENSOR LOG
+        yarpWholeBodySensorsLog *   sensorsLog;
+        ///< buffer used to record the timestamps of the readings when the caller does not request them
+        yarp::sig::Vector           logStamps;
+
+        /** Open the sensor log, if configured in the WBI_SENSORS_OPTIONS group. */
+        bool openSensorsLog();
+
+        // TELEMETRY
+        yarpWholeBodySensorsTelemetry * telemetry;
+        ///< telemetry source of each controlboard, FT sensor and IMU (-1 if the telemetry is not enabled)
+        std::vector<int>            controlBoardTelemetrySource;
+        std::vector<int>            ftTelemetrySources;
+        std::vector<int>            imuTelemetrySources;
+        ///< sequence number of the last sample read from each FT sensor and IMU port (-1 if none)
+        std::vector<int>            ftLastSequence;
+        std::vector<int>            imuLastSequence;
+
+        // FT CALIBRATION
+        ///< calibration of each FT sensor (the key is the wbi numeric sensor id)
+        std::vector<FTSensorCalibration>    ftCalibration;
+        yarp::os::Mutex                     ftCalibrationMutex;
+
+        /** Load the calibration of a FT sensor from the WBI_YARP_FT_CALIBRATION group. */
+        bool loadFTSensorCalibration(const wbi::ID & sid, FTSensorCalibration & calibration);
+
+        /**
+         * Apply the calibration to the reading of a FT sensor (in place), first using it for a pending re-zeroing.
+         * @param newSample true if the reading is a new sample of the sensor.
+         */
+        void calibrateFTsensor(const int ft_sensor_numeric_id, double * wrench, bool newSample);
+
+        // RUNTIME SENSOR CHANGES
+        ///< lock taken while swapping in the tables of the sensors added or removed after init (0 if not used)
+        yarp::os::Semaphore *       sensorTablesLock;
+        ///< incremented (under the sensor tables lock) every time the sensor tables change after init
+        unsigned long               sensorTablesGeneration;
+
+        void lockSensorTables();
+        void unlockSensorTables();
+
+        /**
+         * Add or remove a sensor after init: the drivers and ports of the sensor are opened (or closed)
+         * without holding the sensor tables lock, which is taken only to swap in the new tables.
+         */
+        bool addSensorAfterInit(const wbi::SensorType st, const wbi::ID & sid);
+        bool removeSensorAfterInit(const wbi::SensorType st, const wbi::ID & sid);
+        bool addPortSensorAfterInit(const wbi::SensorType st, const wbi::ID & sid);
+        bool removePortSensorAfterInit(const wbi::SensorType st, const wbi::ID & sid, const int index);
+        bool addControlBoardSensorAfterInit(const wbi::SensorType st, const wbi::ID & sid);
+        bool removeControlBoardSensorAfterInit(const wbi::SensorType st, const wbi::ID & sid);
+
+        /**
+         * Recompute the controlboard tables, arenas and gather indeces from the sensor lists.
+         * @param unusedDrivers drivers of the controlboards not used anymore by any sensor, detached from the tables.
+         */
+        bool updateControlBoardTables(std::vector<yarp::dev::PolyDriver*> & unusedDrivers);
+
+        /** Close the sensor log, whose record layout is fixed, when the set of sensors changes. */
+        void closeSensorsLogOnSensorChange();
+
+        /** Create the telemetry, if configured in the WBI_SENSORS_OPTIONS group. */
+        bool openTelemetry();
+
+        /**
+         * Read a sensor port, updating the last read data and the telemetry.
+         * @return true if a new sample has been read, false otherwise.
+         */
+        bool readSensorPort(yarp::os::BufferedPort<yarp::sig::Vector> * port,
+                            yarp::sig::Vector & lastRead,
+                            double & lastStamp,
+                            const int telemetrySource,
+                            int & lastSequence,
+                            bool wait);
+
+        /**
+         * Acquire the specified reading of a controlboard, updating its last read data.
+         * If the read cache is enabled and the controlboard has already been read in the
+         * current epoch, no acquisition is performed.
+         * @return true if the last read data is up to date, false otherwise (or on timeout if wait is true).
+         */
+        bool readControlBoard(const ControlBoardReadingType type, const int controlBoard, bool wait);
+
+        /** Store in controlBoardAxes the number of axes of the specified (already opened) controlboard. */
+        bool readControlBoardAxes(const int controlBoard);
+
+        /**
+         * Allocate the arenas of the last read data and compute the gather indeces
+         * of the controlboard related sensors. Called by init() once all the controlboards are open.
+         */
+        void buildControlBoardArenas();
 
 
         //ControlBoard oriented sensors
@@ -162,8 +383,30 @@ namespace yarpWbi
                                         std::vector<AccelerometerConfigurationInfo> & infos);
 
         //Indipendent sensors
-        bool openImu(const int id, const std::string & port_name);
-        bool openFTsens(const int id, const std::string & port_name);
+        /** Open a local port and connect the remote sensor port to it. On failure port is set to 0. */
+        bool openSensorPort(const std::string & localPort, const std::string & port_name, const std::string & carrier,
+                            const int dataSize, yarp::os::BufferedPort<yarp::sig::Vector> * & port,
+                            yarp::sig::Vector & lastRead, double & lastStamp);
+        bool openImu(const int id, const std::string & port_name, const std::string & carrier="udp");
+        bool openFTsens(const int id, const std::string & port_name, const std::string & carrier="udp");
+
+        /**
+         * Connect a remote sensor port to a local port with the requested carrier,
+         * falling back to udp if the requested carrier is not available.
+         * @param effectiveCarrier the carrier actually used for the connection.
+         */
+        bool connectSensorPort(const std::string & remotePort, const std::string & localPort,
+                               const std::string & carrier, std::string & effectiveCarrier);
+
+        /**
+         * Report the carrier of a sensor port connection. At init, if sensorPortProbeTimeout is set,
+         * wait for the first sample of the port to report also the latency of the stream.
+         */
+        void reportSensorPortConnection(yarp::os::BufferedPort<yarp::sig::Vector> * port,
+                                        yarp::sig::Vector & lastRead,
+                                        double & lastStamp,
+                                        const std::string & remotePort,
+                                        const std::string & effectiveCarrier);
         bool openAccelerometer(const int id, const AccelerometerConfigurationInfo & info);
 
         bool convertIMU(double * wbi_inertial_readings, const double * yarp_inertial_readings);
@@ -198,6 +441,40 @@ namespace yarpWbi
         virtual bool init();
         virtual bool close();
 
+        /**
+         * Start a new read epoch.
+         * If the read cache is enabled, the next read of each controlboard will perform a new
+         * acquisition, while all subsequent single and bulk reads in the same epoch are
+         * served from the data already acquired.
+         * The cache is used only once the epochs are driven by calling this method periodically
+         * (yarpWholeBodyStates calls it at every estimator cycle): if it is never called, every read
+         * performs a new acquisition.
+         */
+        void advanceReadEpoch();
+
+        /**
+         * Generation of the sensor tables, incremented every time a sensor is added or removed after init.
+         * Users holding per-sensor state (e.g. filters) compare it with the last value they saw to
+         * detect a change of the sensor tables, even when the number of sensors did not change.
+         * Read it while holding the lock passed to setSensorTablesLock.
+         */
+        unsigned long getSensorTablesGeneration() const;
+
+        /**
+         * Enable or disable the per-controlboard read cache.
+         * @param enabled true to serve all the readings of the same epoch from a single acquisition per controlboard.
+         */
+        void setReadCacheEnabled(bool enabled);
+
+        /** @return true if the per-controlboard read cache is enabled, false otherwise. */
+        bool isReadCacheEnabled() const;
+
+        /**
+         * Get the read telemetry of the sensors.
+         * @return the telemetry, or 0 if the telemetry option is not enabled.
+         */
+        yarpWholeBodySensorsTelemetry * getTelemetry();
+
         /**
          * Set the properties of the yarpWbiActuactors interface
          * Note: this function must be called before init, otherwise it takes no effect
@@ -212,8 +489,33 @@ namespace yarpWbi
         virtual bool getYarpWbiProperties(yarp::os::Property & yarp_wbi_properties);
 
 
+        /**
+         * Request the re-zeroing of a FT sensor: its offset is set to the mean of its next nrOfSamples
+         * raw readings, acquired by the normal reads of the sensor (so the sensor must be unloaded meanwhile).
+         * If the sensor has no calibration, an identity calibration matrix is used.
+         * @param ft_sensor_numeric_id numeric id of the FT sensor, or -1 for all the FT sensors.
+         */
+        bool requestFTsensorRezero(const int ft_sensor_numeric_id, const int nrOfSamples);
+
+        /** @return true if the re-zeroing of the FT sensor is still collecting samples, false otherwise. */
+        bool isFTsensorRezeroPending(const int ft_sensor_numeric_id);
+
+        /** Get the offset (raw units) currently removed from the readings of a FT sensor. */
+        bool getFTsensorOffset(const int ft_sensor_numeric_id, double * offset);
+
+        /**
+         * Set the lock taken while swapping in the tables of the sensors added or removed after init.
+         * The drivers and ports of those sensors are opened and closed without the lock, so a thread reading
+         * the sensors under it (as the yarpWholeBodyStates estimator does with its mutex) keeps running meanwhile.
+         * Readings concurrent with a runtime change must hold the same lock; if no lock is set, the caller must
+         * serialize changes and readings.
+         */
+        void setSensorTablesLock(yarp::os::Semaphore * lock);
+
         /**
          * Add the specified sensor so that it can be read.
+         * After init, only the driver or port of the added sensor is opened: this is supported for
+         * encoders, pwm and torque sensors (not with the remapper backend), FT sensors and IMUs.
          * @param st Type of sensor.
          * @param sid Id of the sensor.
          * @return True if the sensor has been added, false otherwise (e.g. the sensor has been already added).
@@ -230,6 +532,7 @@ namespace yarpWbi
 
         /**
          * Remove the specified sensor.
+         * After init, the driver or port of the sensor is closed if no other sensor uses it.
          * @param st Type of the sensor to remove.
          * @param j Id of the sensor to remove.
          * @return True if the sensor has been removed, false otherwise.
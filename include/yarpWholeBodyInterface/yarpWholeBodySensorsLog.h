@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2026 yarp-wholebodyinterface authors
+ *
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#ifndef WBSENSORS_LOG_ICUB_H
+#define WBSENSORS_LOG_ICUB_H
+
+#include <yarp/os/Mutex.h>
+
+#include <wbi/wbi.h>
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+namespace yarpWbi
+{
+    /** Version of the sensor log format written by yarpWholeBodySensorsLog. */
+    const uint32_t SENSORS_LOG_VERSION = 2;
+
+    /** Magic string at the beginning of a sensor log file ("WBISLOG" followed by a null character). */
+    extern const char SensorsLogMagic[8];
+
+    /**
+     * Header at the beginning of a sensor log file.
+     *
+     * All the fields are stored in the byte order of the machine that wrote the log.
+     * The header is followed by:
+     *  - uint32_t nrOfSensors[nrOfSensorTypes]: number of logged sensors of each wbi::SensorType,
+     *  - uint32_t dataSize[nrOfSensorTypes]: number of doubles of the reading of a single sensor of each type,
+     *  - the null-terminated IDs of all the sensors, grouped by type and in wbi numeric id order,
+     *  - zero padding up to headerSize (a multiple of 8 bytes).
+     */
+    struct SensorsLogFileHeader
+    {
+        char      magic[8];          ///< SensorsLogMagic
+        uint32_t  version;           ///< SENSORS_LOG_VERSION
+        uint32_t  headerSize;        ///< size in bytes of the header, the first record starts at this offset
+        uint64_t  fileSize;          ///< size in bytes of the preallocated file
+        uint64_t  endOffset;         ///< offset of the end of the last complete record
+        uint64_t  dataSize;          ///< size in bytes of the header and of the records, the size of the file after close (0 if not closed)
+        uint32_t  nrOfSensorTypes;   ///< number of sensor types (wbi::SENSOR_TYPE_SIZE of the writer)
+        uint32_t  reserved;          ///< unused, always 0
+    };
+
+    /**
+     * Header of a record of a sensor log file.
+     *
+     * A record contains the raw readings of the consecutive sensors firstSensor ... firstSensor+nrOfSensors-1
+     * of a type, as acquired: all the sensors for a bulk reading (readSensors), one sensor
+     * for a single reading (readSensor). The header is followed by:
+     *  - double data[nrOfSensors*dataSize]: the readings in wbi order and units,
+     *  - double stamps[nrOfSensors]: the timestamps of the readings.
+     */
+    struct SensorsLogRecordHeader
+    {
+        uint32_t  sensorType;        ///< wbi::SensorType of the record
+        uint32_t  recordSize;        ///< size in bytes of the record, including this header
+        double    recordTime;        ///< time at which the reading has been logged
+        uint32_t  firstSensor;       ///< wbi numeric id of the first sensor of the record
+        uint32_t  nrOfSensors;       ///< number of sensors of the record
+    };
+
+    class yarpWholeBodySensorsLogFlusher;
+
+    /**
+     * Recorder of the readings of yarpWholeBodySensors.
+     *
+     * The readings are appended to a preallocated memory-mapped file, in the format
+     * described by SensorsLogFileHeader and SensorsLogRecordHeader. A background thread
+     * periodically flushes the written pages to disk. When the file is full the new
+     * readings are dropped (and counted), the log is never overwritten.
+     *
+     * \note Memory-mapped logging is available only on POSIX systems.
+     */
+    class yarpWholeBodySensorsLog
+    {
+    private:
+        yarp::os::Mutex             mutex;
+        int                         fileDescriptor;
+        char *                      mappedFile;
+        uint64_t                    fileSize;
+        uint64_t                    writeOffset;
+        uint64_t                    flushedOffset;
+        unsigned long               droppedRecords;
+        std::vector<uint32_t>       nrOfSensors;     ///< number of sensors of each sensor type
+        std::vector<uint32_t>       dataSize;        ///< number of doubles of a single sensor reading of each type
+        yarpWholeBodySensorsLogFlusher * flusher;
+
+        /** Append the readings of the sensors firstSensor ... firstSensor+n-1 of type st. */
+        bool logRange(const wbi::SensorType st, const int firstSensor, const int n, const double * data, const double * stamps);
+
+    public:
+        yarpWholeBodySensorsLog();
+        virtual ~yarpWholeBodySensorsLog();
+
+        /**
+         * Create and map the log file.
+         * @param fileName name of the file to create (it is overwritten if it already exists).
+         * @param fileSize size in bytes of the preallocated file.
+         * @param sensorIdList list of the logged sensor IDs, indexed by wbi::SensorType.
+         * @param flushPeriodInMs period of the background flush of the log to disk.
+         * @return true if the log has been created, false otherwise.
+         */
+        bool open(const std::string & fileName,
+                  const uint64_t fileSize,
+                  const std::vector<wbi::IDList> & sensorIdList,
+                  const int flushPeriodInMs);
+
+        /** @return true if the log is open, false otherwise. */
+        bool isOpen() const;
+
+        /**
+         * Append a bulk reading of all the sensors of a type.
+         * @param st type of the sensors.
+         * @param data readings of all the sensors of type st, in wbi order.
+         * @param stamps timestamps of the readings (if 0, the logging time is stored).
+         * @return true if the record has been written, false if the log is not open or full.
+         */
+        bool log(const wbi::SensorType st, const double * data, const double * stamps);
+
+        /**
+         * Append a reading of a single sensor.
+         * @param st type of the sensor.
+         * @param sid wbi numeric id of the sensor.
+         * @param data reading of the sensor.
+         * @param stamps timestamp of the reading (if 0, the logging time is stored).
+         * @return true if the record has been written, false if the log is not open or full.
+         */
+        bool logSensor(const wbi::SensorType st, const int sid, const double * data, const double * stamps);
+
+        /** Flush to disk the records written since the last flush. */
+        bool flush();
+
+        /** Flush the log, truncate the file to the written records and close it. */
+        bool close();
+
+        /** @return the number of records dropped because the log was full. */
+        unsigned long getDroppedRecords();
+    };
+
+}
+
+#endif
@@ -0,0 +1,106 @@
+/*
+ * Copyright (C) 2026 yarp-wholebodyinterface authors
+ *
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#ifndef WBSENSORS_REPLAY_ICUB_H
+#define WBSENSORS_REPLAY_ICUB_H
+
+#include "yarpWholeBodyInterface/yarpWholeBodySensors.h"
+
+#include <yarp/os/Mutex.h>
+
+namespace yarpWbi
+{
+    /**
+     * Sensor interface that replays the readings recorded by yarpWholeBodySensors
+     * (see yarpWholeBodySensorsLog), without connecting to any robot.
+     *
+     * The replay is configured in the WBI_SENSORS_OPTIONS group:
+     *
+     * | Parameter name | Type | Units | Default Value | Required | Description | Notes |
+     * |:--------------:|:----:|:-----:|:-------------:|:--------:|:-----------:|:-----:|
+     * | replayLog | string | - | - | Yes | Sensor log to replay. | All the sensors added to the interface must be present in the log. |
+     * | replayRealTime | - | - | - | No | If present, the readings are replayed following the original timing of the log, otherwise each bulk read (readSensors) of a sensor type returns the next recorded reading of that type, as fast as the caller reads them. | Without real time, each sensor type is replayed in order independently of the others. |
+     *
+     * Single sensor reads (readSensor) return the last replayed reading without advancing the replay.
+     */
+    class yarpWholeBodySensorsReplay: public yarpWholeBodySensors
+    {
+    protected:
+        yarp::os::Mutex                     replayMutex;
+        bool                                replayRealTime;
+        std::vector<char>                   logBuffer;          ///< content of the replayed log
+        std::vector<uint64_t>               recordOffsets;      ///< offsets of the records in logBuffer
+        size_t                              nextRecord;         ///< index of the next record to replay (real time mode)
+        std::vector<size_t>                 nextRecordOfType;   ///< index of the next record to examine for each sensor type (as fast as possible mode)
+        std::vector<size_t>                 lastRecordOfType;   ///< index after the last record of each sensor type
+        bool                                replayStarted;
+        double                              logStartTime;       ///< logging time of the first record
+        double                              replayStartTime;    ///< time at which the replay started
+
+        std::vector<uint32_t>               logNrOfSensors;     ///< number of sensors of each type in the log
+        std::vector<uint32_t>               logDataSize;        ///< size of a single reading of each type in the log
+        ///< map from wbi numeric sensor ids to the index of the sensor in the log, indexed by wbi::SensorType
+        std::vector< std::vector<int> >     logSensorIndex;
+        ///< last replayed readings and stamps, in log order, indexed by wbi::SensorType
+        std::vector<yarp::sig::Vector>      replayedData;
+        std::vector<yarp::sig::Vector>      replayedStamps;
+        ///< whether a reading of each sensor has been replayed, in log order, indexed by wbi::SensorType
+        std::vector< std::vector<bool> >    replayedDataAvailable;
+
+        /** Load the log and map its sensors to the sensors added to the interface. */
+        bool loadLog(const std::string & logFile);
+
+        /** @return true if a reading of all the sensors of type st added to the interface has been replayed. */
+        bool isReplayedDataAvailable(const wbi::SensorType st, const int sid = -1);
+
+        /** Copy the content of the specified record in the last replayed readings. */
+        void replayRecord(const size_t record);
+
+        /**
+         * Advance the replay: in real time mode all the records up to the current time,
+         * otherwise the next record of the specified sensor type (the records of the other types are left to their reads).
+         * @return true if a reading of sensor type st is available, false otherwise.
+         */
+        bool advanceReplay(const wbi::SensorType st);
+
+        /** Copy the last replayed reading of the sensor sid of type st in data and stamps. */
+        void copyReplayedReading(const wbi::SensorType st, const int sid, double *data, double *stamps);
+
+    public:
+        /**
+         * @param _name Local name of the interface
+         * @param _yarp_wbi_properties yarp::os::Property object used to configure the interface
+         */
+        yarpWholeBodySensorsReplay(const char* _name,
+                                   const yarp::os::Property & _yarp_wbi_properties=yarp::os::Property());
+
+        virtual bool init();
+        virtual bool close();
+
+        /** Sensors can be added or removed only before init, as the replayed log has a fixed set of sensors. */
+        virtual bool addSensor(const wbi::SensorType st, const wbi::ID &sid);
+        virtual int addSensors(const wbi::SensorType st, const wbi::IDList &sids);
+        virtual bool removeSensor(const wbi::SensorType st, const wbi::ID &sid);
+
+        virtual bool readSensor(const wbi::SensorType st, const int sid, double *data, double *stamps=0, bool blocking=true);
+        virtual bool readSensors(const wbi::SensorType st, double *data, double *stamps=0, bool blocking=true);
+
+        /** @return true if all the records of the log have been replayed, false otherwise. */
+        bool isReplayFinished();
+    };
+}
+
+#endif
@@ -0,0 +1,132 @@
+/*
+ * Copyright (C) 2026 yarp-wholebodyinterface authors
+ *
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#ifndef WBSENSORS_TELEMETRY_ICUB_H
+#define WBSENSORS_TELEMETRY_ICUB_H
+
+#include <yarp/os/Mutex.h>
+#include <yarp/os/RateThread.h>
+#include <yarp/os/BufferedPort.h>
+#include <yarp/os/Bottle.h>
+
+#include <string>
+#include <vector>
+
+namespace yarpWbi
+{
+    /** Statistics of the readings of a sensor source (a controlboard or a sensor port). */
+    struct SensorReadStatistics
+    {
+        unsigned long reads;            ///< number of successful readings
+        unsigned long timeouts;         ///< number of readings failed for timeout
+        unsigned long staleSamples;     ///< number of readings returning a sample older than twice the expected period of the source
+        unsigned long sequenceGaps;     ///< number of samples lost between two readings (from the sequence number of the stream)
+        unsigned long rejectedSamples;  ///< number of samples rejected by the estimator as outliers
+        double latencyP50;              ///< median of the read latency (seconds)
+        double latencyP90;              ///< 90th percentile of the read latency (seconds)
+        double latencyP99;              ///< 99th percentile of the read latency (seconds)
+        double latencyMax;              ///< maximum read latency (seconds)
+    };
+
+    class yarpWholeBodySensorsTelemetryPublisher;
+
+    /**
+     * Read latency and drop counters of the sensor sources of yarpWholeBodySensors.
+     *
+     * Latencies are accumulated in a fixed histogram with logarithmic bins (from 10 us to about 1 s),
+     * so recording a reading never allocates memory and percentiles are accurate to a quarter of octave.
+     * The counters are protected by a mutex, held only for the few instructions of each update.
+     */
+    class yarpWholeBodySensorsTelemetry
+    {
+    private:
+        mutable yarp::os::Mutex                     mutex;
+        std::vector<std::string>                    sourceNames;
+        std::vector<SensorReadStatistics>           statistics;
+        std::vector< std::vector<unsigned long> >   latencyHistograms;
+        std::vector<double>                         lastNewSampleTime;  ///< time at which each source returned its last new sample (0 if never)
+        std::vector<double>                         expectedPeriod;     ///< estimated period of the new samples of each source (0 if not estimated yet)
+        yarpWholeBodySensorsTelemetryPublisher *    publisher;
+
+        static int latencyBin(const double latency);
+        static double latencyBinUpperBound(const int bin);
+        double latencyPercentile(const int source, const double percentile) const;
+
+    public:
+        yarpWholeBodySensorsTelemetry();
+        virtual ~yarpWholeBodySensorsTelemetry();
+
+        /**
+         * Add a sensor source.
+         * @return the numeric id of the added source.
+         */
+        int addSource(const std::string & sourceName);
+
+        /** @return the number of sensor sources. */
+        int getNrOfSources() const;
+
+        /** @return the name of a sensor source. */
+        std::string getSourceName(const int source) const;
+
+        void recordRead(const int source, const double latency);
+        void recordTimeout(const int source);
+
+        /**
+         * Record whether a reading returned a new sample of the source. Readings can be faster than the
+         * source, so a reading without a new sample is counted as stale only if the last new sample is older
+         * than twice the expected period of the source, estimated from the intervals between its new samples.
+         */
+        void recordSample(const int source, const bool newSample);
+
+        void recordSequenceGap(const int source, const unsigned long lostSamples);
+        void recordRejectedSample(const int source, const unsigned long rejectedSamples=1);
+
+        /**
+         * Get the statistics of a sensor source.
+         * @return true if the source exists, false otherwise.
+         */
+        bool getStatistics(const int source, SensorReadStatistics & sourceStatistics);
+
+        /** Reset the statistics of all the sensor sources. */
+        void reset();
+
+        /**
+         * Serialize the statistics of all the sources, one list for each source:
+         * (name reads timeouts staleSamples sequenceGaps rejectedSamples latencyP50 latencyP90 latencyP99 latencyMax),
+         * with latencies in milliseconds.
+         */
+        void toBottle(yarp::os::Bottle & bot);
+
+        /**
+         * Start periodically publishing the statistics on a port.
+         * @param portName name of the port.
+         * @param periodInMs publishing period.
+         */
+        bool startPublishing(const std::string & portName, const int periodInMs);
+
+        /** Stop publishing the statistics and close the port. */
+        void stopPublishing();
+
+        /**
+         * Number of samples lost between two sequence numbers of a yarp stream, modulo the range of the counter
+         * (yarp::os::Stamp counts up to 2^31-1 and then wraps to 0).
+         * @return the number of lost samples, 0 if count does not follow previousCount (e.g. the sender restarted).
+         */
+        static unsigned long sequenceGap(const int previousCount, const int count);
+    };
+}
+
+#endif
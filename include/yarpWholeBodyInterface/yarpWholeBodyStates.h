@@ -19,6 +19,7 @@
 #ifndef WBSTATES_YARP_H
 #define WBSTATES_YARP_H
 #include "yarpWholeBodyInterface/floatingBaseEstimators.h"
+#include "yarpWholeBodyInterface/forceTorqueEstimators.h"
 
 #include <yarp/dev/ControlBoardInterfaces.h>
 #include <yarp/dev/IVelocityControl2.h>
@@ -48,6 +49,52 @@ namespace yarpWbi
 {
     class yarpWholeBodySensors;
 
+    /** Outlier rejection applied to the joint readings before the estimator filters. */
+    enum OutlierRejectionType
+    {
+        OUTLIER_REJECTION_NONE,
+        OUTLIER_REJECTION_MEDIAN3,      ///< each sample is replaced by the median of the last three samples
+        OUTLIER_REJECTION_RATE_LIMIT    ///< samples changing faster than a bound are replaced by the last accepted sample
+    };
+
+    /**
+     * Per-joint outlier rejection of a stream of joint readings, with O(1) state per joint.
+     *
+     * The median of three rejects isolated glitches at the price of delaying real steps by one sample.
+     * The rate limit holds the last accepted sample when the rate of change exceeds maxRate, but accepts
+     * a change persisting for more than two samples, so that a real jump is not rejected forever.
+     */
+    class jointOutlierRejector
+    {
+    protected:
+        OutlierRejectionType    type;
+        double                  maxRate;
+        yarp::sig::Vector       previous;           ///< last sample (median3) or last accepted sample (rate limit)
+        yarp::sig::Vector       previous2;          ///< second last sample (median3)
+        std::vector<int>        consecutiveRejections;
+        double                  previousTime;
+        int                     nrOfSamples;        ///< number of samples seen since the last reset (saturated at 2)
+
+    public:
+        jointOutlierRejector();
+
+        /** Configure the rejection (this resets its state). */
+        void configure(const OutlierRejectionType type, const double maxRate=0.0);
+
+        /** Resize the rejector for n joints, resetting its state if n changed. */
+        void resize(const int n);
+
+        /** Reset the state of the rejector (e.g. after the joints were remapped). */
+        void reset();
+
+        /**
+         * Filter a new sample in place.
+         * @param fallbackDt time step used when the sample time does not advance.
+         * @return the number of rejected joint readings.
+         */
+        int filter(yarp::sig::Vector & x, const double time, const double fallbackDt);
+    };
+
     /**
      * Thread that estimates the state of the iCub robot.
      */
@@ -77,10 +124,15 @@ namespace yarpWbi
 
         yarp::sig::Vector           q, dq, d2q, qStamps;         // last joint position estimation
         yarp::sig::Vector           tauJ, tauJStamps;
+        double                      lastTauJStamp;               // acquisition time of the last joint torques fed to the derivative filters
         yarp::sig::Vector           pwm, pwmStamps;
+        yarp::sig::Vector           ft, ftStamps;                // last force/torque sensor readings
+        unsigned long               sensorTablesGeneration;      // generation of the sensor tables the filters were built for
 
         /* Resize all vectors using current number of DoFs. */
         void resizeAll(int n);
+        /** Recreate the filters (and reset the estimates) after a change of the sensor tables. */
+        void rebuildFilters();
         void lockAndResizeAll(int n);
 
         /** Set the parameters of the adaptive window filter used for velocity estimation. */
@@ -105,6 +157,13 @@ namespace yarpWbi
          * @return true if succeded, false otherwise.
          */
         bool setVelocitiesCutFrequency(double fc);
+
+        /**
+         * Compute the model based force/torque estimates from the last joint estimates.
+         * @param sensorsChanged true if the sensor tables changed in this cycle.
+         * @return true if new joint torques have been estimated in tauJ (estimateJointTorquesFromFT option), false otherwise.
+         */
+        bool computeForceTorqueEstimates(bool sensorsChanged);
     public:
 
 
@@ -132,6 +191,8 @@ namespace yarpWbi
             yarp::sig::Vector lastBasePos;                // last Base Position
             yarp::sig::Vector lastBaseVel;                // last Base Velocity
             yarp::sig::Vector lastBaseAcc;                // last Base Acceleration
+            yarp::sig::Vector lastCompensatedFT;          // last force/torque measurements without the weight of the links beyond the sensors
+            yarp::sig::Vector lastExternalWrenches;       // last external wrenches, 6 elements for each external wrench frame
         }
         estimates;
 
@@ -141,6 +202,11 @@ namespace yarpWbi
         /** Matrix such that tau_m = joint_kinematic_to_motor_kinematic_coupling*tau_joint */
         Eigen::MatrixXd joint_to_motor_torque_coupling;
 
+        /** Outlier rejection of the encoder and joint torque readings */
+        jointOutlierRejector qOutlierRejector;
+        jointOutlierRejector tauJOutlierRejector;
+        int qOutliersTelemetrySource, tauJOutliersTelemetrySource;   ///< telemetry sources of the rejected samples (-1 if none)
+
         /** If true, read speed and accelerations from the controlboard */
         bool readSpeedAccFromControlBoard;
 
@@ -156,9 +222,28 @@ namespace yarpWbi
         bool use_remoteFloatingBaseStateEstimator;
         remoteFloatingBaseStateEstimator remoteFltBaseStateEstimator;
 
+        /** helper for model based force/torque estimation (0 if disabled) */
+        modelBasedForceTorqueEstimator * ftEstimator;
+
+        /** If true, compensate the force/torque sensors for the weight of the attached links */
+        bool compensateForceTorque;
+
+        /** Frames of the ESTIMATE_EXTERNAL_FORCE_TORQUE estimates */
+        wbi::IDList externalWrenchFrames;
+        bool externalWrenchFramesChanged;
+        bool externalWrenchesValid;             ///< false if the last external wrench estimation failed
+        bool forceTorqueEstimationOk;           ///< outcome of the last model based estimation, to report its failures once
+        bool tauJEstimatesValid;                ///< false if the joint torques could not be estimated from the force/torque sensors in the last cycle
+
+        /** If true, the joint torques are estimated from the force/torque sensors instead of being read from the controlboards */
+        bool estimateJointTorquesFromFT;
+        /** Frames of the unknown external wrenches used for the joint torque estimation when no external wrench estimate is added */
+        wbi::IDList defaultContactFrames;
+
         /** Constructor.
          */
         yarpWholeBodyEstimator(int period_in_ms, double cutOffFrequencyTorqueInHz, double cutOffFrequencyVelocitiesInHz, yarpWbi::yarpWholeBodySensors *_sensors);
+        virtual ~yarpWholeBodyEstimator();
 
         bool lockAndSetEstimationParameter(const wbi::EstimateType et,
                                            const wbi::EstimationParameter ep,
@@ -172,6 +257,31 @@ namespace yarpWbi
         bool lockAndCopyVector(const yarp::sig::Vector &src, double *dest);
         /** Take the mutex and copy the i-th element of src into dest. */
         bool lockAndCopyVectorElement(int i, const yarp::sig::Vector &src, double *dest);
+        /** Take the mutex and copy the i-th block of size elements of src into dest. */
+        bool lockAndCopyVectorBlock(int i, int size, const yarp::sig::Vector &src, double *dest);
+
+        /**
+         * Take the mutex and copy the i-th joint torque estimate of src (all of them if i is negative) into dest,
+         * in the order of the SENSOR_TORQUE list.
+         * @return false if the joint torques are estimated from the force/torque sensors and the last estimation
+         *         failed, or (some of) the joints are not in the model.
+         */
+        bool lockAndCopyJointTorqueEstimates(int i, const yarp::sig::Vector &src, double *dest);
+
+        /**
+         * Take the mutex and copy the i-th external wrench estimate (all of them if i is negative) into dest.
+         * @return false if the last estimation of the external wrenches failed.
+         */
+        bool lockAndCopyExternalWrenches(int i, double *dest);
+
+        /**
+         * Take the mutex and add frames to the external wrench estimates.
+         * Frames not found in the model of the force/torque estimation are not added.
+         * @return the number of added frames.
+         */
+        int lockAndAddExternalWrenchFrames(const wbi::IDList &frames);
+        /** Take the mutex and remove a frame from the external wrench estimates. */
+        bool lockAndRemoveExternalWrenchFrame(const wbi::ID &frame);
 
     };
 
@@ -207,10 +317,28 @@ namespace yarpWbi
      * | localWorldReferenceFrame | string | - | - | No | If present, specifies the default frame for computation of the world-to-root rototranslation.  | Not compatible with the externalFloatingBaseStatePort |
      * | cutOffFrequencyTorqueInHz  | double | Hz | 3.0 | No | Specify the cutoff frequency of the first order filter used to filter joint torque measurements, motor torque measurements and pwm | |
      * | cutOffFrequencyVelocitiesInHz | double | Hz | (If not present, no filter is used) | No | If present, specify the cutoff frequency of the first order filter used to filter joint velocities measurements. If not present, no filter is used. | |
+     * | outlierRejection | string | - | none | No | Outlier rejection applied to encoders and joint torques before the filters: none, median3 (median of the last three samples) or rateLimit (samples changing faster than maxJointVelocity/maxJointTorqueRate are replaced by the last accepted one). | Rejected samples are counted in the sensor telemetry, if enabled. |
+     * | maxJointVelocity | double | rad/s | - | With rateLimit | Bound on the rate of change of the encoder readings. | |
+     * | maxJointTorqueRate | double | Nm/s | - | With rateLimit | Bound on the rate of change of the joint torque readings. | |
+     * | forceTorqueCompensation | - | - | - | No | If present, the estimator thread removes from the force/torque sensor measurements the weight (and the inertial effects) of the links beyond each sensor, see getCompensatedForceTorqueEstimates. | Requires the urdf option (the same used by yarpWholeBodyModel) with the force/torque sensors. |
+     * | forceTorqueEstimationFixedFrame | string | - | default base link of the urdf | No | Frame of the model assumed fixed with respect to the world by the model based force/torque estimation. | |
+     * | forceTorqueEstimationGravity | list of 3 doubles | m/s^2 | (0.0 0.0 -9.81) | No | Gravity acceleration expressed in the forceTorqueEstimationFixedFrame. | |
+     * | estimateJointTorquesFromFT | - | - | - | No | If present, the joint torques (ESTIMATE_JOINT_TORQUE and the derived estimates) are computed at the estimator rate by propagating the force/torque sensor measurements through the model, instead of being read from the controlboards. | Requires the urdf option. The contacts are the frames of the ESTIMATE_EXTERNAL_FORCE_TORQUE estimates, or defaultContactFrames if there are none. The joints not in the urdf are not estimated: reading their torques fails. |
+     * | defaultContactFrames | list of strings | - | - | With estimateJointTorquesFromFT | Frames of the unknown external wrenches used for the joint torque estimation when no ESTIMATE_EXTERNAL_FORCE_TORQUE estimate is added. | The frames (as the ones of the ESTIMATE_EXTERNAL_FORCE_TORQUE estimates) must exist in the urdf. While the estimation fails, the external wrench estimates are not available. |
      *
      * Furthermore for accessing joint sensors, the property should contain all the information used
      * for configuring a a yarpWholeBodyActuators object.
      *
+     * # EXTERNAL WRENCHES
+     *
+     * The ESTIMATE_EXTERNAL_FORCE_TORQUE estimates are computed in the estimator thread from the force/torque
+     * sensors and the model (loaded from the urdf option), without the need of an external wholeBodyDynamics.
+     * The ID of each estimate is a frame of the model, where an unknown external wrench is assumed applied.
+     * Each estimate is a 6 elements wrench (force then torque) applied in the origin of the frame and expressed
+     * in the orientation of the link of the frame. All the force/torque sensors of the model should be added
+     * as ESTIMATE_FORCE_TORQUE_SENSOR estimates, and each part of the robot delimited by the sensors should contain
+     * at least one external wrench frame. The kinematics is propagated as described for forceTorqueCompensation.
+     *
      * # FILTERS
      *
      * For historical reasons, the yarpWholeBodyStates always filters the readed torques and pwm with a first order filter,
@@ -231,12 +359,16 @@ namespace yarpWbi
 
         //List of IDList for each estimate
         std::vector<wbi::IDList> estimateIdList;
+        //Copies of the estimate lists returned by getEstimateList after init (the lists change at runtime)
+        std::vector<wbi::IDList> estimateListCopies;
 
         virtual bool lockAndReadSensor(const wbi::SensorType st, const int numeric_id, double *data, double time, bool blocking);
         virtual bool lockAndReadSensors(const wbi::SensorType st, double *data, double time, bool blocking);
-        virtual bool lockAndAddSensor(const wbi::SensorType st, const wbi::ID &sid);
-        virtual int lockAndAddSensors(const wbi::SensorType st, const wbi::IDList &sids);
-        virtual bool lockAndRemoveSensor(const wbi::SensorType st, const wbi::ID &sid);
+        /** Add the sensors needed by an estimate. @return the number of added sensors. */
+        int addSensorsForEstimate(const wbi::EstimateType et, const wbi::IDList &sids);
+        /** Remove the sensor of an estimate. */
+        bool removeSensorForEstimate(const wbi::EstimateType et, const wbi::ID &sid);
+
         virtual wbi::IDList lockAndGetSensorList(const wbi::SensorType st);
         virtual int lockAndGetSensorNumber(const wbi::SensorType st);
         //virtual bool lockAndGetExternalWrench(const wbi::LocalId sid, double * data);
@@ -258,6 +390,10 @@ namespace yarpWbi
         // the estimate of the floating base state
         bool configureFloatingBaseStateEstimator();
 
+        // Configure (using options provided by a configuration file)
+        // the model based force/torque estimation
+        bool configureForceTorqueEstimator();
+
         // Pointer to a wholeBodyModel
         wbi::iWholeBodyModel * wholeBodyModel;
 
@@ -285,6 +421,7 @@ namespace yarpWbi
 
 
         /** Add the specified estimate so that it can be read.
+         * After init, the sensors of the estimate are opened without stopping the estimator.
          * @param st Type of estimate.
          * @param sid Id of the estimate.
          * @return True if the estimate has been added, false otherwise (e.g. the estimate has been already added).
@@ -307,7 +444,8 @@ namespace yarpWbi
 
         /** Get a copy of the estimate list of the specified estimate type.
          * @param st Type of estimate.
-         * @return A copy of the estimate list. */
+         * @return A copy of the estimate list (taken under the estimator mutex after init,
+         * overwritten by the next call for the same estimate type). */
         virtual const wbi::IDList& getEstimateList(const wbi::EstimateType st);
 
         /** Get the number of estimates of the specified type.
@@ -340,6 +478,19 @@ namespace yarpWbi
          * @param value Value of the parameter to set.
          * @return True if the operation succeeded, false otherwise. */
         virtual bool setEstimationParameter(const wbi::EstimateType et, const wbi::EstimationParameter ep, const void *value);
+
+        /** Get the measurement of a force/torque sensor without the weight of the links beyond the sensor,
+         * computed once per cycle by the estimator thread (forceTorqueCompensation option).
+         * @param numeric_id Id of the sensor in the ESTIMATE_FORCE_TORQUE_SENSOR estimate list.
+         * @param data Output wrench (6 elements, force then torque, in sensor frame).
+         * @return True if the compensation is enabled, false otherwise.
+         */
+        bool getCompensatedForceTorqueEstimate(const int numeric_id, double *data);
+
+        /** Get the compensated measurements of all the force/torque sensors, in the order of the ESTIMATE_FORCE_TORQUE_SENSOR estimate list.
+         * @return True if the compensation is enabled, false otherwise.
+         */
+        bool getCompensatedForceTorqueEstimates(double *data);
     };
 
 
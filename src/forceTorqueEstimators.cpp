@@ -0,0 +1,301 @@
+/*
+ * Copyright (C) 2026 yarp-wholebodyinterface authors
+ *
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#include "forceTorqueEstimators.h"
+
+#include <yarp/os/Log.h>
+#include <yarp/os/LogStream.h>
+
+#include <iDynTree/Model/Model.h>
+#include <iDynTree/Sensors/Sensors.h>
+
+using namespace yarpWbi;
+
+modelBasedForceTorqueEstimator::modelBasedForceTorqueEstimator():
+initDone(false), fixedFrame(iDynTree::FRAME_INVALID_INDEX), activeContacts(0)
+{
+}
+
+bool modelBasedForceTorqueEstimator::init(const std::string & urdfFilePath, const std::string & fixedFrameName, const double * _gravity)
+{
+    if( !estimator.loadModelAndSensorsFromFile(urdfFilePath) )
+    {
+        yError() << "modelBasedForceTorqueEstimator: impossible to load model and sensors from " << urdfFilePath;
+        return false;
+    }
+
+    const iDynTree::Model & model = estimator.model();
+    if( fixedFrameName.empty() )
+    {
+        fixedFrame = model.getDefaultBaseLink();
+    }
+    else
+    {
+        fixedFrame = model.getFrameIndex(fixedFrameName);
+    }
+    if( fixedFrame == iDynTree::FRAME_INVALID_INDEX )
+    {
+        yError() << "modelBasedForceTorqueEstimator: frame " << fixedFrameName << " not found in " << urdfFilePath;
+        return false;
+    }
+
+    for(int i=0; i < 3; i++ )
+    {
+        gravity(i) = _gravity[i];
+    }
+
+    jointPos.resize(model);
+    jointVel.resize(model);
+    jointAcc.resize(model);
+    jointPos.zero();
+    jointVel.zero();
+    jointAcc.zero();
+
+    compensationUnknowns.resize(model);
+    compensationUnknowns.clear();
+    compensationUnknowns.addNewUnknownFullWrenchInFrameOrigin(model, fixedFrame);
+    predictedFT.resize(estimator.sensors());
+    predictedContactWrenches.resize(model);
+    predictedJointTorques.resize(model);
+    measuredFT.resize(estimator.sensors());
+    estimatedContactWrenches.resize(model);
+    estimatedJointTorques.resize(model);
+
+    initDone = true;
+    return true;
+}
+
+bool modelBasedForceTorqueEstimator::setJointList(const wbi::IDList & joints)
+{
+    if( !initDone ) return false;
+
+    const iDynTree::Model & model = estimator.model();
+    bool ok = true;
+    jointDofs.assign(joints.size(), -1);
+    for(int j=0; j < (int)joints.size(); j++ )
+    {
+        wbi::ID jointId;
+        joints.indexToID(j, jointId);
+        iDynTree::JointIndex jointIndex = model.getJointIndex(jointId.toString());
+        if( jointIndex == iDynTree::JOINT_INVALID_INDEX || model.getJoint(jointIndex)->getNrOfDOFs() != 1 )
+        {
+            yWarning() << "modelBasedForceTorqueEstimator: joint " << jointId.toString() << " not found in the model, it will be ignored";
+            ok = false;
+            continue;
+        }
+        jointDofs[j] = model.getJoint(jointIndex)->getDOFsOffset();
+    }
+
+    // joints removed from the list are kept in their last position: bring them back to zero
+    jointPos.zero();
+    jointVel.zero();
+    jointAcc.zero();
+    return ok;
+}
+
+bool modelBasedForceTorqueEstimator::setJointTorqueList(const wbi::IDList & joints)
+{
+    if( !initDone ) return false;
+
+    const iDynTree::Model & model = estimator.model();
+    bool ok = true;
+    torqueDofs.assign(joints.size(), -1);
+    for(int j=0; j < (int)joints.size(); j++ )
+    {
+        wbi::ID jointId;
+        joints.indexToID(j, jointId);
+        iDynTree::JointIndex jointIndex = model.getJointIndex(jointId.toString());
+        if( jointIndex == iDynTree::JOINT_INVALID_INDEX || model.getJoint(jointIndex)->getNrOfDOFs() != 1 )
+        {
+            yWarning() << "modelBasedForceTorqueEstimator: joint " << jointId.toString() << " not found in the model, its torque can not be estimated";
+            ok = false;
+            continue;
+        }
+        torqueDofs[j] = model.getJoint(jointIndex)->getDOFsOffset();
+    }
+    return ok;
+}
+
+bool modelBasedForceTorqueEstimator::canEstimateJointTorque(const int j) const
+{
+    return j >= 0 && j < (int)torqueDofs.size() && torqueDofs[j] >= 0;
+}
+
+bool modelBasedForceTorqueEstimator::setForceTorqueSensorList(const wbi::IDList & ftSensors)
+{
+    if( !initDone ) return false;
+
+    bool ok = true;
+    ftSensorIndices.assign(ftSensors.size(), -1);
+    for(int s=0; s < (int)ftSensors.size(); s++ )
+    {
+        wbi::ID sensorId;
+        ftSensors.indexToID(s, sensorId);
+        ftSensorIndices[s] = estimator.sensors().getSensorIndex(iDynTree::SIX_AXIS_FORCE_TORQUE, sensorId.toString());
+        if( ftSensorIndices[s] < 0 )
+        {
+            yWarning() << "modelBasedForceTorqueEstimator: force/torque sensor " << sensorId.toString() << " not found in the model, its measurements will not be compensated";
+            ok = false;
+        }
+    }
+
+    if( ftSensors.size() < estimator.sensors().getNrOfSensors(iDynTree::SIX_AXIS_FORCE_TORQUE) )
+    {
+        yWarning() << "modelBasedForceTorqueEstimator: not all the force/torque sensors of the model are read, external wrench estimation will be inaccurate";
+    }
+    measuredFT.resize(estimator.sensors());
+    return ok;
+}
+
+int modelBasedForceTorqueEstimator::getNrOfForceTorqueSensors() const
+{
+    return ftSensorIndices.size();
+}
+
+bool modelBasedForceTorqueEstimator::updateKinematics(const double * q, const double * dq, const double * ddq)
+{
+    if( !initDone ) return false;
+
+    for(int j=0; j < (int)jointDofs.size(); j++ )
+    {
+        int dof = jointDofs[j];
+        if( dof < 0 ) continue;
+        jointPos(dof) = q[j];
+        jointVel(dof) = dq[j];
+        jointAcc(dof) = ddq[j];
+    }
+
+    return estimator.updateKinematicsFromFixedBase(jointPos, jointVel, jointAcc, fixedFrame, gravity);
+}
+
+bool modelBasedForceTorqueEstimator::computeCompensatedForceTorque(const double * ft, double * compensatedFT)
+{
+    if( !initDone ) return false;
+
+    // wrench transmitted by each sensor when the robot is only supported on the fixed frame
+    bool ok = estimator.computeExpectedFTSensors(compensationUnknowns, predictedFT,
+                                                 predictedContactWrenches, predictedJointTorques);
+
+    for(int s=0; s < (int)ftSensorIndices.size(); s++ )
+    {
+        if( ftSensorIndices[s] < 0 || !ok )
+        {
+            for(int i=0; i < 6; i++ ) compensatedFT[6*s+i] = ft[6*s+i];
+            continue;
+        }
+
+        predictedFT.getMeasurement(iDynTree::SIX_AXIS_FORCE_TORQUE, ftSensorIndices[s], predictedWrench);
+        for(int i=0; i < 6; i++ )
+        {
+            compensatedFT[6*s+i] = ft[6*s+i] - predictedWrench.getVal(i);
+        }
+    }
+
+    return ok;
+}
+
+bool modelBasedForceTorqueEstimator::setContactFrames(const wbi::IDList & contactFrames)
+{
+    if( !initDone ) return false;
+
+    std::string key;
+    for(int c=0; c < (int)contactFrames.size(); c++ )
+    {
+        wbi::ID frameId;
+        contactFrames.indexToID(c, frameId);
+        key += frameId.toString() + ";";
+    }
+
+    std::map<std::string, contactConfiguration>::iterator cached = contactConfigurations.find(key);
+    if( cached != contactConfigurations.end() )
+    {
+        activeContacts = &(cached->second);
+        return true;
+    }
+
+    // first use of this contact configuration: build its unknowns
+    const iDynTree::Model & model = estimator.model();
+    contactConfiguration configuration;
+    configuration.unknowns.resize(model);
+    configuration.unknowns.clear();
+    for(int c=0; c < (int)contactFrames.size(); c++ )
+    {
+        wbi::ID frameId;
+        contactFrames.indexToID(c, frameId);
+        iDynTree::FrameIndex frame = model.getFrameIndex(frameId.toString());
+        if( frame == iDynTree::FRAME_INVALID_INDEX )
+        {
+            yError() << "modelBasedForceTorqueEstimator: contact frame " << frameId.toString() << " not found in the model";
+            activeContacts = 0;
+            return false;
+        }
+        iDynTree::LinkIndex link = model.getFrameLink(frame);
+        configuration.contactLinks.push_back(link);
+        configuration.contactIndices.push_back(configuration.unknowns.getNrOfContactsForLink(link));
+        configuration.unknowns.addNewUnknownFullWrenchInFrameOrigin(model, frame);
+    }
+
+    activeContacts = &(contactConfigurations[key] = configuration);
+    return true;
+}
+
+bool modelBasedForceTorqueEstimator::hasFrame(const wbi::ID & frame) const
+{
+    return initDone && estimator.model().getFrameIndex(frame.toString()) != iDynTree::FRAME_INVALID_INDEX;
+}
+
+int modelBasedForceTorqueEstimator::getNrOfContactFrames() const
+{
+    return activeContacts != 0 ? activeContacts->contactLinks.size() : 0;
+}
+
+bool modelBasedForceTorqueEstimator::estimateExternalWrenchesAndJointTorques(const double * ft, double * externalWrenches, double * jointTorques)
+{
+    if( !initDone || activeContacts == 0 ) return false;
+
+    for(int s=0; s < (int)ftSensorIndices.size(); s++ )
+    {
+        if( ftSensorIndices[s] < 0 ) continue;
+        for(int i=0; i < 6; i++ )
+        {
+            measuredWrench.setVal(i, ft[6*s+i]);
+        }
+        measuredFT.setMeasurement(iDynTree::SIX_AXIS_FORCE_TORQUE, ftSensorIndices[s], measuredWrench);
+    }
+
+    if( !estimator.estimateExtWrenchesAndJointTorques(activeContacts->unknowns, measuredFT,
+                                                      estimatedContactWrenches, estimatedJointTorques) )
+    {
+        return false;
+    }
+
+    for(int c=0; externalWrenches != 0 && c < (int)activeContacts->contactLinks.size(); c++ )
+    {
+        const iDynTree::Wrench & contactWrench =
+            estimatedContactWrenches.contactWrench(activeContacts->contactLinks[c], activeContacts->contactIndices[c]).contactWrench();
+        for(int i=0; i < 6; i++ )
+        {
+            externalWrenches[6*c+i] = contactWrench.getVal(i);
+        }
+    }
+
+    for(int j=0; jointTorques != 0 && j < (int)torqueDofs.size(); j++ )
+    {
+        if( torqueDofs[j] >= 0 ) jointTorques[j] = estimatedJointTorques(torqueDofs[j]);
+    }
+
+    return true;
+}
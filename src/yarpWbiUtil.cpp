@@ -58,6 +58,45 @@ bool openPolyDriver(const std::string &localName,
     return true;
 }
 
+bool openRemapperPolyDriver(const std::string &localName,
+                            const std::string &robotName,
+                            yarp::dev::PolyDriver *&pd,
+                            const std::vector<std::string> &axesNames,
+                            const std::vector<std::string> &controlBoardNames)
+{
+    yarp::os::Property options;
+    options.put("device","remotecontrolboardremapper");
+
+    yarp::os::Bottle axesNamesBot;
+    yarp::os::Bottle & axesNamesList = axesNamesBot.addList();
+    for(int axis=0; axis < (int)axesNames.size(); axis++ )
+    {
+        axesNamesList.addString(axesNames[axis].c_str());
+    }
+    options.put("axesNames",axesNamesBot.get(0));
+
+    yarp::os::Bottle remoteControlBoardsBot;
+    yarp::os::Bottle & remoteControlBoardsList = remoteControlBoardsBot.addList();
+    for(int ctrlBoard=0; ctrlBoard < (int)controlBoardNames.size(); ctrlBoard++ )
+    {
+        remoteControlBoardsList.addString(("/" + robotName + "/" + controlBoardNames[ctrlBoard]).c_str());
+    }
+    options.put("remoteControlBoards",remoteControlBoardsBot.get(0));
+
+    options.put("localPortPrefix",("/" + localName + "/remapper").c_str());
+
+    yarp::os::Property & remoteControlBoardsOpts = options.addGroup("REMOTE_CONTROLBOARD_OPTIONS");
+    remoteControlBoardsOpts.put("writeStrict","on");
+
+    pd = new yarp::dev::PolyDriver(options);
+    if(!pd || !(pd->isValid()))
+    {
+        yError("Problems instantiating the remapper device driver for %s", localName.c_str());
+        return false;
+    }
+    return true;
+}
+
 bool closePolyDriver(yarp::dev::PolyDriver *&pd)
 {
     if( !pd || !(pd->isValid()) )
@@ -73,6 +112,22 @@ bool closePolyDriver(yarp::dev::PolyDriver *&pd)
     return ret;
 }
 
+void gather(const double * src, const int * index, const int n, double * dst)
+{
+    for(int i=0; i < n; i++ )
+    {
+        dst[i] = src[index[i]];
+    }
+}
+
+void gatherAndScale(const double * src, const int * index, const int n, const double scale, double * dst)
+{
+    for(int i=0; i < n; i++ )
+    {
+        dst[i] = scale*src[index[i]];
+    }
+}
+
 yarp::os::Bottle & getWBIYarpJointsOptions(yarp::os::Property & wbi_yarp_properties)
 {
     return wbi_yarp_properties.findGroup(WBI_YARP_JOINTS_GROUP);
@@ -240,33 +295,60 @@ bool loadJointsControlBoardFromConfig(yarp::os::Property & wbi_yarp_properties,
 bool loadSensorPortsFromConfig(yarp::os::Property & wbi_yarp_properties,
                                const wbi::IDList & sensorIdList,
                                std::vector<std::string> & ports,
+                               std::vector<std::string> & carriers,
                                const std::string group_name)
 {
     yarp::os::Bottle ports_list = wbi_yarp_properties.findGroup(group_name);
     if( ports_list.isNull() || ports_list.size() == 0 ) {
         ports.resize(0);
+        carriers.resize(0);
         return true;
     }
 
     ports.resize(sensorIdList.size());
+    carriers.resize(sensorIdList.size());
 
+    //The carrier of the sensors for which it is not specified
+    std::string default_carrier = "udp";
+    if( ports_list.check("defaultCarrier") ) {
+        default_carrier = ports_list.find("defaultCarrier").asString().c_str();
+    }
 
     for(int sensor_index = 0; sensor_index < (int)sensorIdList.size(); sensor_index++ ) {
         wbi::ID sensorID;
         sensorIdList.indexToID(sensor_index,sensorID);
         yarp::os::Value & port = ports_list.find(sensorID.toString());
-        if( (port.isNull()) || !(port.isString()) ) {
+        std::string port_name, carrier = default_carrier;
+        if( port.isString() ) {
+            port_name = port.asString().c_str();
+        } else if( port.isList() && port.asList()->size() == 2
+                   && port.asList()->get(0).isString() && port.asList()->get(1).isString() ) {
+            // (port carrier)
+            port_name = port.asList()->get(0).asString().c_str();
+            carrier   = port.asList()->get(1).asString().c_str();
+        } else {
             yError() << "yarpWbi::loadSensorPortsFromConfig error: " << ports_list.toString() <<
                          " returned an error when search for port of sensor " << sensorID.toString();
             return false;
         }
-        std::string port_name = port.asString().c_str();
         ports[sensor_index] = port_name;
+        carriers[sensor_index] = carrier;
     }
     return true;
 }
 
-
+bool loadSensorPortsFromConfig(yarp::os::Property & wbi_yarp_properties,
+                               const wbi::IDList & sensorIdList,
+                               std::vector<std::string> & ports,
+                               const std::string group_name)
+{
+    std::vector<std::string> carriers;
+    return loadSensorPortsFromConfig(wbi_yarp_properties,
+                                     sensorIdList,
+                                     ports,
+                                     carriers,
+                                     group_name);
+}
 
 bool loadFTSensorPortsFromConfig(yarp::os::Property & wbi_yarp_properties,
                                  wbi::IDList & sensorIdList,
@@ -278,6 +360,18 @@ bool loadFTSensorPortsFromConfig(yarp::os::Property & wbi_yarp_properties,
                                      "WBI_YARP_FT_PORTS");
 }
 
+bool loadFTSensorPortsFromConfig(yarp::os::Property & wbi_yarp_properties,
+                                 wbi::IDList & sensorIdList,
+                                 std::vector<std::string> & ports,
+                                 std::vector<std::string> & carriers)
+{
+    return loadSensorPortsFromConfig(wbi_yarp_properties,
+                                     sensorIdList,
+                                     ports,
+                                     carriers,
+                                     "WBI_YARP_FT_PORTS");
+}
+
 bool loadIMUSensorPortsFromConfig(yarp::os::Property & wbi_yarp_properties,
                                  wbi::IDList & sensorIdList,
                                  std::vector<std::string> & ports)
@@ -288,6 +382,18 @@ bool loadIMUSensorPortsFromConfig(yarp::os::Property & wbi_yarp_properties,
                                      "WBI_YARP_IMU_PORTS");
 }
 
+bool loadIMUSensorPortsFromConfig(yarp::os::Property & wbi_yarp_properties,
+                                 wbi::IDList & sensorIdList,
+                                 std::vector<std::string> & ports,
+                                 std::vector<std::string> & carriers)
+{
+    return loadSensorPortsFromConfig(wbi_yarp_properties,
+                                     sensorIdList,
+                                     ports,
+                                     carriers,
+                                     "WBI_YARP_IMU_PORTS");
+}
+
 
 bool loadIdListsFromConfigRecursiveHelper(std::string & requested_list,
                                           std::vector<std::string> & lists_names_stack,
@@ -17,12 +17,19 @@
 
 #define MAX_NJ 20
 #include "yarpWholeBodyActuators.h"
+#include "PIDList.h"
 #include <wbi/wbiConstants.h>
 #include <wbi/Error.h>
 #include <yarp/os/LogStream.h>
 #include <yarp/os/Property.h>
+#include <yarp/os/Thread.h>
+#include <yarp/os/Mutex.h>
+#include <yarp/os/Time.h>
 #include <string>
+#include <algorithm>
 #include <cassert>
+#include <cmath>
+#include <limits>
 
 using namespace std;
 using namespace wbi;
@@ -32,6 +39,10 @@ using namespace yarp::dev;
 
 #define WAIT_TIME 0.001         ///< waiting time in seconds before retrying to perform an operation that has failed
 #define DEFAULT_REF_SPEED 10.0  ///< default reference joint speed for the joint position control
+#define DEFAULT_REFERENCE_REFRESH_PERIOD 0.05 ///< default period (seconds) of the forced sending of the references filtered by the deadband
+#define MAX_REFERENCE_REFRESH_PERIOD 0.1 ///< largest refresh period (seconds) accepted, below the reference watchdog of the controlboards
+#define DEFAULT_CONTROL_MODE_VERIFICATION_PERIOD 1000 ///< default period (milliseconds) of the verification of the cached control modes
+#define DEFAULT_CONTROL_REFERENCES_VERIFICATION_PERIOD 1.0 ///< default period (seconds) of the verification of the cached control references
 
 const std::string yarpWbi::YarpWholeBodyActuatorsPropertyInteractionModeKey = "yarp.dev.interaction";
 const std::string yarpWbi::YarpWholeBodyActuatorsPropertyInteractionModeStiff = "yarp.dev.interaction.stiff";
@@ -44,6 +55,149 @@ const std::string yarpWbi::YarpWholeBodyActuatorsPropertyImpedanceDampingKey = "
 #endif
 
 
+namespace yarpWbi
+{
+    /**
+     * Thread sending the references of a controlboard, used with the asyncReferences and parallelReferences options.
+     * The references are left by the controller in a single slot mailbox: if the writer is still
+     * busy with the previous reference when a new one arrives, only the latest one is kept.
+     * If synchronous, the controller waits for the references to be sent with waitSent
+     * (so no reference is ever overwritten).
+     */
+    class yarpWholeBodyActuatorsWriter: public yarp::os::Thread
+    {
+        yarpWholeBodyActuators * actuators;
+        int wbi_controlboard_id;
+
+        yarp::os::Mutex     mailboxMutex;   // protects pending, hasPending and statistics (held only to copy the references)
+        yarp::os::Semaphore wakeUp;
+        std::vector<double> pending;        // references waiting to be sent
+        std::vector<double> sending;        // references being sent
+        bool                hasPending;
+        ReferenceWriterStatistics statistics;
+
+        bool                synchronous;
+        yarp::os::Semaphore sentSignal;     // posted when a reference has been sent (or discarded), if synchronous
+        bool                lastResult;
+
+    public:
+        // held while sending, so the dispatch plan is never changed under the writer
+        yarp::os::Mutex     sendMutex;
+
+        yarpWholeBodyActuatorsWriter(yarpWholeBodyActuators * _actuators, int _wbi_controlboard_id, int nrOfJoints, bool _synchronous):
+        actuators(_actuators), wbi_controlboard_id(_wbi_controlboard_id), wakeUp(0),
+        pending(nrOfJoints,0.0), sending(nrOfJoints,0.0), hasPending(false),
+        synchronous(_synchronous), sentSignal(0), lastResult(false)
+        {
+            statistics.sent = 0;
+            statistics.overwritten = 0;
+            statistics.failed = 0;
+        }
+
+        void post(const double *ref)
+        {
+            mailboxMutex.lock();
+            if( hasPending )
+            {
+                statistics.overwritten++;
+            }
+            for(int i=0; i < (int)pending.size(); i++ )
+            {
+                pending[i] = ref[i];
+            }
+            hasPending = true;
+            mailboxMutex.unlock();
+            wakeUp.post();
+        }
+
+        /** Wait for the posted references to be sent, only if synchronous. @return true if they have been sent successfully. */
+        bool waitSent()
+        {
+            sentSignal.wait();
+            return lastResult;
+        }
+
+        /** Discard the pending references, the caller must hold sendMutex. */
+        void discardPending()
+        {
+            mailboxMutex.lock();
+            if( hasPending && synchronous )
+            {
+                // do not leave the controller waiting for references that will never be sent
+                lastResult = false;
+                sentSignal.post();
+            }
+            hasPending = false;
+            mailboxMutex.unlock();
+        }
+
+        void getStatistics(ReferenceWriterStatistics & _statistics)
+        {
+            mailboxMutex.lock();
+            _statistics = statistics;
+            mailboxMutex.unlock();
+        }
+
+        virtual void onStop()
+        {
+            wakeUp.post();
+        }
+
+        virtual void run()
+        {
+            while( !isStopping() )
+            {
+                wakeUp.wait();
+
+                sendMutex.lock();
+                mailboxMutex.lock();
+                bool toSend = hasPending;
+                if( toSend )
+                {
+                    pending.swap(sending);
+                    hasPending = false;
+                }
+                mailboxMutex.unlock();
+
+                bool ok = toSend && !isStopping() && actuators->sendControlBoardReferences(wbi_controlboard_id, &(sending[0]));
+                sendMutex.unlock();
+
+                if( toSend )
+                {
+                    mailboxMutex.lock();
+                    ok ? statistics.sent++ : statistics.failed++;
+                    mailboxMutex.unlock();
+                    if( synchronous )
+                    {
+                        lastResult = ok;
+                        sentSignal.post();
+                    }
+                }
+            }
+        }
+    };
+}
+
+namespace yarpWbi
+{
+    /** Thread periodically checking the cached control modes against the ones of the controlboards. */
+    class yarpWholeBodyActuatorsModeVerifier: public yarp::os::RateThread
+    {
+        yarpWholeBodyActuators * actuators;
+
+    public:
+        yarpWholeBodyActuatorsModeVerifier(int periodInMs, yarpWholeBodyActuators * _actuators):
+        RateThread(periodInMs), actuators(_actuators)
+        {
+        }
+
+        virtual void run()
+        {
+            actuators->verifyControlModes();
+        }
+    };
+}
+
 // *********************************************************************************************************************
 // *********************************************************************************************************************
 //                                          YARP WHOLE BODY ACTUATOR
@@ -53,8 +207,14 @@ const std::string yarpWbi::YarpWholeBodyActuatorsPropertyImpedanceDampingKey = "
 
 yarpWholeBodyActuators::yarpWholeBodyActuators(const char* _name,
                                                const yarp::os::Property & yarp_wbi_properties)
-: initDone(false), name(_name), wbi_yarp_properties(yarp_wbi_properties)
+: initDone(false), name(_name), modeVerifier(0), wbi_yarp_properties(yarp_wbi_properties), synchronousReferenceWriters(false),
+  referenceFilterEnabled(false), referenceRefreshPeriod(DEFAULT_REFERENCE_REFRESH_PERIOD),
+  referenceLimiterEnabled(false), maxVelocityReference(0.0), maxTorqueReference(0.0), maxPWMReference(0.0),
+  maxPositionReferenceRate(0.0), maxVelocityReferenceRate(0.0), maxTorqueReferenceRate(0.0), maxPWMReferenceRate(0.0),
+  controlReferencesVerificationPeriod(DEFAULT_CONTROL_REFERENCES_VERIFICATION_PERIOD)
 {
+    filterStatistics.sent = 0;
+    filterStatistics.filtered = 0;
 }
 
 
@@ -85,7 +245,7 @@ bool yarpWholeBodyActuators::openControlBoardDrivers(int bp)
                      " but the total number of bodyparts considered in the interface is " << controlBoardNames.size() << std::endl;
         return false;
     }
-    itrq[bp]=0; iimp[bp]=0; icmd[bp]=0; ivel[bp]=0; ipos[bp]=0; iopl[bp]=0;  dd[bp]=0; ipositionDirect[bp]=0; iinteraction[bp]=0; ipid[bp]=0;
+    itrq[bp]=0; iimp[bp]=0; icmd[bp]=0; ivel[bp]=0; ipos[bp]=0; iopl[bp]=0;  dd[bp]=0; ipositionDirect[bp]=0; iinteraction[bp]=0; ipid[bp]=0; ienc[bp]=0;
     if(!openPolyDriver(name, robot, dd[bp], controlBoardNames[bp].c_str()))
     {
         std::cerr << "[ERR] yarpWholeBodyActuators::openDrivers error: unable to open controlboard " << controlBoardNames[bp]
@@ -109,6 +269,11 @@ bool yarpWholeBodyActuators::openControlBoardDrivers(int bp)
               && dd[bp]->view(ivel[bp]) && dd[bp]->view(ipos[bp]) && dd[bp]->view(typed_iopl)
               && dd[bp]->view(ipositionDirect[bp]) && dd[bp]->view(iinteraction[bp]) && dd[bp]->view(ipid[bp]);
     iopl[bp] = typed_iopl; // copy to iopl which is a (void*)
+    // the encoders are used only to seed the reference limiter, they are optional
+    if( ok && !dd[bp]->view(ienc[bp]) )
+    {
+        ienc[bp] = 0;
+    }
 
     if(!ok)
     {
@@ -172,6 +337,15 @@ bool yarpWholeBodyActuators::init()
             totalControlledAxesInControlBoard[controlBoardAxisList[wbi_jnt].first]++;
         }
 
+        //Validate the options that do not need the controlboards before opening them
+        yarp::os::Bottle & actuators_opt_bot = wbi_yarp_properties.findGroup("WBI_ACTUATORS_OPTIONS");
+        ok = configureReferenceFilter(actuators_opt_bot);
+        if (ok && actuators_opt_bot.check("asyncReferences") && actuators_opt_bot.check("parallelReferences"))
+        {
+            std::cerr << "[ERR] yarpWholeBodyActuators: asyncReferences and parallelReferences options cannot be used together" << std::endl;
+            ok = false;
+        }
+
         updateControlledJointsForEachControlBoard();
 
         //Resize everything that depends on the number of controlboards
@@ -184,11 +358,12 @@ bool yarpWholeBodyActuators::init()
         ipositionDirect.resize(controlBoardNames.size());
         iinteraction.resize(controlBoardNames.size());
         ipid.resize(controlBoardNames.size());
+        ienc.resize(controlBoardNames.size());
         dd.resize(controlBoardNames.size());
 
         //Open necessary yarp controlboard drivers
         //iterate all used body parts
-        for (int bp = 0; bp < (int)controlBoardNames.size(); bp++)
+        for (int bp = 0; ok && bp < (int)controlBoardNames.size(); bp++)
         {
             ok = openControlBoardDrivers(bp);
             if (!ok)
@@ -223,11 +398,80 @@ bool yarpWholeBodyActuators::init()
                 controlBoardReadingBuffer[ctrlBrd].resize(totalAxesInControlBoard[ctrlBrd], 0.0);
             }
         }
+
+        //start from the control modes the controlboards are actually in
+        ctrlModeMismatch.assign(jointIdList.size(), true);
+        if (ok)
+        {
+            readControlModes();
+        }
+
+        if (ok && actuators_opt_bot.check("referenceLimiter"))
+        {
+            ok = configureReferenceLimiter(actuators_opt_bot);
+        }
+
+        //the dispatch plan depends on the number of axes of the controlboards and on the deadbands
+        if (ok)
+        {
+            updateControlledJointsForEachControlBoard();
+        }
+
+        if (ok && (actuators_opt_bot.check("asyncReferences") || actuators_opt_bot.check("parallelReferences")))
+        {
+            synchronousReferenceWriters = actuators_opt_bot.check("parallelReferences");
+            ok = startReferenceWriters();
+        }
+
+        if (ok && actuators_opt_bot.check("cacheControlReferences"))
+        {
+            controlReferencesVerificationPeriod = DEFAULT_CONTROL_REFERENCES_VERIFICATION_PERIOD;
+            if (actuators_opt_bot.check("controlReferencesVerificationPeriod"))
+            {
+                controlReferencesVerificationPeriod = actuators_opt_bot.find("controlReferencesVerificationPeriod").asDouble();
+            }
+            yarpWBAReferenceShadow emptyShadow;
+            emptyShadow.references.assign(jointIdList.size(), 0.0);
+            emptyShadow.valid.assign(jointIdList.size(), false);
+            emptyShadow.lastVerificationTime = yarp::os::Time::now();
+            referenceShadows[wbi::CTRL_MODE_POS] = emptyShadow;
+            referenceShadows[wbi::CTRL_MODE_DIRECT_POSITION] = emptyShadow;
+            referenceShadows[wbi::CTRL_MODE_VEL] = emptyShadow;
+            referenceShadows[wbi::CTRL_MODE_TORQUE] = emptyShadow;
+            referenceShadows[wbi::CTRL_MODE_MOTOR_PWM] = emptyShadow;
+        }
+
+        int verificationPeriod = DEFAULT_CONTROL_MODE_VERIFICATION_PERIOD;
+        if (actuators_opt_bot.check("controlModeVerificationPeriod"))
+        {
+            verificationPeriod = actuators_opt_bot.find("controlModeVerificationPeriod").asInt();
+        }
+        if (ok && verificationPeriod > 0)
+        {
+            modeVerifier = new yarpWholeBodyActuatorsModeVerifier(verificationPeriod, this);
+            if (!modeVerifier->start())
+            {
+                std::cerr << "[WARN] yarpWholeBodyActuators: unable to start the control mode verifier, "
+                          << "the cached control modes will not be verified" << std::endl;
+                delete modeVerifier;
+                modeVerifier = 0;
+            }
+        }
     }
 
     if (!ok)
     {
-        //roll back the changes: all vectors must be sized 0
+        //roll back the changes: close the opened drivers (their ports would stay open), all vectors must be sized 0
+        stopReferenceWriters();
+        for (int bp = 0; bp < (int)dd.size(); bp++)
+        {
+            if (dd[bp] != 0)
+            {
+                dd[bp]->close();
+                delete dd[bp];
+                dd[bp] = 0;
+            }
+        }
         itrq.resize(0);
         iimp.resize(0);
         icmd.resize(0);
@@ -237,6 +481,7 @@ bool yarpWholeBodyActuators::init()
         ipositionDirect.resize(0);
         iinteraction.resize(0);
         ipid.resize(0);
+        ienc.resize(0);
         dd.resize(0);
         controlBoardAxisList.resize(0);
 
@@ -247,6 +492,424 @@ bool yarpWholeBodyActuators::init()
     return ok;
 }
 
+bool yarpWholeBodyActuators::readControlModes()
+{
+    bool ok = true;
+    controlBoardModesBuffer.resize(controlBoardNames.size());
+    for(int wbi_controlboard_id=0; wbi_controlboard_id < (int)controlBoardNames.size(); wbi_controlboard_id++ )
+    {
+        controlBoardModesBuffer[wbi_controlboard_id].assign(totalAxesInControlBoard[wbi_controlboard_id], VOCAB_CM_UNKNOWN);
+        if( totalAxesInControlBoard[wbi_controlboard_id] > 0 &&
+            !icmd[wbi_controlboard_id]->getControlModes(&(controlBoardModesBuffer[wbi_controlboard_id][0])) )
+        {
+            std::cerr << "[WARN] yarpWholeBodyActuators: unable to read the control modes of controlboard "
+                      << controlBoardNames[wbi_controlboard_id] << std::endl;
+            ok = false;
+        }
+    }
+
+    for(int wbi_jnt = 0; wbi_jnt < (int)jointIdList.size(); wbi_jnt++ )
+    {
+        int yarpCtrlMode = controlBoardModesBuffer[controlBoardAxisList[wbi_jnt].first][controlBoardAxisList[wbi_jnt].second];
+        ControlMode wbiCtrlMode = yarpToWbiCtrlMode(yarpCtrlMode);
+        // joints in a mode unknown to the wbi (e.g. idle) are assumed in position, but their mode is always set
+        ctrlModeMismatch[wbi_jnt] = (wbiCtrlMode == CTRL_MODE_UNKNOWN);
+        currentCtrlModes[wbi_jnt] = ctrlModeMismatch[wbi_jnt] ? CTRL_MODE_POS : wbiCtrlMode;
+    }
+    return ok;
+}
+
+void yarpWholeBodyActuators::verifyControlModes()
+{
+    // the controlboards are read without the lock: a mode switched in the meanwhile
+    // can be marked as mismatching, and is then just sent again by the next setControlMode
+    for(int wbi_controlboard_id=0; wbi_controlboard_id < (int)controlBoardNames.size(); wbi_controlboard_id++ )
+    {
+        if( totalAxesInControlBoard[wbi_controlboard_id] > 0 &&
+            !icmd[wbi_controlboard_id]->getControlModes(&(controlBoardModesBuffer[wbi_controlboard_id][0])) )
+        {
+            controlBoardModesBuffer[wbi_controlboard_id].assign(totalAxesInControlBoard[wbi_controlboard_id], VOCAB_CM_UNKNOWN);
+        }
+    }
+
+    ctrlModesMutex.lock();
+    for(int wbi_jnt = 0; wbi_jnt < (int)jointIdList.size(); wbi_jnt++ )
+    {
+        int yarpCtrlMode = controlBoardModesBuffer[controlBoardAxisList[wbi_jnt].first][controlBoardAxisList[wbi_jnt].second];
+        // VOCAB_CM_UNKNOWN: the controlboard could not be read
+        if( yarpCtrlMode != VOCAB_CM_UNKNOWN && yarpToWbiCtrlMode(yarpCtrlMode) != currentCtrlModes[wbi_jnt] && !ctrlModeMismatch[wbi_jnt] )
+        {
+            wbi::ID jointId;
+            jointIdList.indexToID(wbi_jnt, jointId);
+            yWarning() << "yarpWholeBodyActuators: joint " << jointId.toString() << " is not in the control mode "
+                       << currentCtrlModes[wbi_jnt] << " set by the wbi, it will be set again at the next setControlMode";
+            ctrlModeMismatch[wbi_jnt] = true;
+        }
+    }
+    ctrlModesMutex.unlock();
+}
+
+bool yarpWholeBodyActuators::configureReferenceLimiter(yarp::os::Bottle & actuators_opt_bot)
+{
+    int nrOfJoints = jointIdList.size();
+
+    //position limits of the controlboards
+    jointPositionMin.assign(nrOfJoints, -std::numeric_limits<double>::infinity());
+    jointPositionMax.assign(nrOfJoints, std::numeric_limits<double>::infinity());
+    for(int wbi_jnt = 0; wbi_jnt < nrOfJoints; wbi_jnt++ )
+    {
+        int bodyPart = controlBoardAxisList[wbi_jnt].first;
+        int controlBoardAxis = controlBoardAxisList[wbi_jnt].second;
+        yarp::dev::IControlLimits * ilim = 0;
+        double qMin = 0.0, qMax = 0.0;
+        if( !dd[bodyPart]->view(ilim) || ilim == 0 || !ilim->getLimits(controlBoardAxis, &qMin, &qMax) )
+        {
+            wbi::ID jointId;
+            jointIdList.indexToID(wbi_jnt, jointId);
+            yWarning() << "yarpWholeBodyActuators: unable to read the limits of joint " << jointId.toString()
+                       << ", its position references will not be limited";
+            continue;
+        }
+        jointPositionMin[wbi_jnt] = yarpWbi::Deg2Rad*qMin;
+        jointPositionMax[wbi_jnt] = yarpWbi::Deg2Rad*qMax;
+    }
+
+    //position limits of the configuration
+    if( actuators_opt_bot.check("referencePositionLimits") )
+    {
+        yarp::os::Bottle * limits_bot = actuators_opt_bot.find("referencePositionLimits").asList();
+        if( limits_bot == 0 )
+        {
+            std::cerr << "[ERR] yarpWholeBodyActuators: referencePositionLimits option should be a list of (jointName min max)" << std::endl;
+            return false;
+        }
+        for(int i=0; i < limits_bot->size(); i++ )
+        {
+            yarp::os::Bottle * joint_bot = limits_bot->get(i).asList();
+            int wbi_jnt = -1;
+            if( joint_bot == 0 || joint_bot->size() != 3 || !joint_bot->get(1).isDouble() || !joint_bot->get(2).isDouble() ||
+                joint_bot->get(1).asDouble() > joint_bot->get(2).asDouble() ||
+                !jointIdList.idToIndex(wbi::ID(joint_bot->get(0).asString().c_str()), wbi_jnt) )
+            {
+                std::cerr << "[ERR] yarpWholeBodyActuators: malformed element " << limits_bot->get(i).toString()
+                          << " of referencePositionLimits option, expected (jointName min max)" << std::endl;
+                return false;
+            }
+            jointPositionMin[wbi_jnt] = joint_bot->get(1).asDouble();
+            jointPositionMax[wbi_jnt] = joint_bot->get(2).asDouble();
+        }
+    }
+
+    //saturations and rate limits of the control modes
+    const char * limitNames[] = { "maxVelocityReference", "maxTorqueReference", "maxPWMReference",
+                                  "maxPositionReferenceRate", "maxVelocityReferenceRate", "maxTorqueReferenceRate", "maxPWMReferenceRate", 0 };
+    double * limitValues[] = { &maxVelocityReference, &maxTorqueReference, &maxPWMReference,
+                               &maxPositionReferenceRate, &maxVelocityReferenceRate, &maxTorqueReferenceRate, &maxPWMReferenceRate, 0 };
+    for(int i=0; limitNames[i] != 0; i++ )
+    {
+        if( !actuators_opt_bot.check(limitNames[i]) )
+        {
+            continue;
+        }
+        if( !actuators_opt_bot.find(limitNames[i]).isDouble() || actuators_opt_bot.find(limitNames[i]).asDouble() <= 0.0 )
+        {
+            std::cerr << "[ERR] yarpWholeBodyActuators: " << limitNames[i] << " option should be a positive double" << std::endl;
+            return false;
+        }
+        *(limitValues[i]) = actuators_opt_bot.find(limitNames[i]).asDouble();
+    }
+
+    limiterMin.assign(nrOfJoints, 0.0);
+    limiterMax.assign(nrOfJoints, 0.0);
+    limiterMaxRate.assign(nrOfJoints, 0.0);
+    limiterLast.assign(nrOfJoints, 0.0);
+    limiterLastTime.assign(nrOfJoints, 0.0);
+    limiterLastValid.assign(nrOfJoints, false);
+    limiterModes.assign(nrOfJoints, CTRL_MODE_UNKNOWN);
+    limitedReferences.assign(nrOfJoints, 0.0);
+    limiterSeeds.resize(controlBoardNames.size());
+    for(int wbi_controlboard_id = 0; wbi_controlboard_id < (int)controlBoardNames.size(); wbi_controlboard_id++ )
+    {
+        limiterSeeds[wbi_controlboard_id].assign(totalAxesInControlBoard[wbi_controlboard_id], 0.0);
+    }
+    ReferenceLimiterStatistics emptyStatistics = {0,0};
+    limiterStatistics.assign(nrOfJoints, emptyStatistics);
+
+    referenceLimiterEnabled = true;
+    updateReferenceLimiter();
+    return true;
+}
+
+void yarpWholeBodyActuators::updateReferenceLimiter()
+{
+    if( !referenceLimiterEnabled )
+    {
+        return;
+    }
+
+    const double inf = std::numeric_limits<double>::infinity();
+    double now = yarp::os::Time::now();
+    //the seeds of each board are read once, with a single call, for the mode of its first switched joint
+    std::vector<wbi::ControlMode> seedModes(controlBoardNames.size(), CTRL_MODE_UNKNOWN);
+    std::vector<bool> seedsRead(controlBoardNames.size(), false);
+    for(int wbi_jnt = 0; wbi_jnt < (int)jointIdList.size(); wbi_jnt++ )
+    {
+        //the limits and the last reference of the joints that did not change mode are still valid
+        if( limiterModes[wbi_jnt] == currentCtrlModes[wbi_jnt] )
+        {
+            continue;
+        }
+
+        double saturation = inf;
+        double maxRate = 0.0;
+        switch(currentCtrlModes[wbi_jnt])
+        {
+            case CTRL_MODE_POS:
+            case CTRL_MODE_DIRECT_POSITION:
+                maxRate = maxPositionReferenceRate;
+                break;
+            case CTRL_MODE_VEL:
+                saturation = maxVelocityReference > 0.0 ? maxVelocityReference : inf;
+                maxRate = maxVelocityReferenceRate;
+                break;
+            case CTRL_MODE_TORQUE:
+                saturation = maxTorqueReference > 0.0 ? maxTorqueReference : inf;
+                maxRate = maxTorqueReferenceRate;
+                break;
+            case CTRL_MODE_MOTOR_PWM:
+                saturation = maxPWMReference > 0.0 ? maxPWMReference : inf;
+                maxRate = maxPWMReferenceRate;
+                break;
+            default:
+                break;
+        }
+
+        //the last reference belongs to the previous control mode: the rate of the first reference in the new
+        //mode is limited with respect to the measured position (position modes) or the reference of the board
+        int wbi_controlboard_id = controlBoardAxisList[wbi_jnt].first;
+        double seed = 0.0;
+        bool seeded = false;
+        if( maxRate > 0.0 )
+        {
+            if( seedModes[wbi_controlboard_id] != currentCtrlModes[wbi_jnt] )
+            {
+                seedModes[wbi_controlboard_id] = currentCtrlModes[wbi_jnt];
+                seedsRead[wbi_controlboard_id] = readReferenceLimiterSeeds(wbi_controlboard_id, currentCtrlModes[wbi_jnt]);
+            }
+            seeded = seedsRead[wbi_controlboard_id];
+            seed = seeded ? limiterSeeds[wbi_controlboard_id][controlBoardAxisList[wbi_jnt].second] : 0.0;
+            if( !seeded )
+            {
+                wbi::ID jointId;
+                jointIdList.indexToID(wbi_jnt, jointId);
+                yWarning() << "yarpWholeBodyActuators: unable to read the reference of joint " << jointId.toString()
+                           << " in its new control mode, its first reference will not be rate limited";
+            }
+        }
+
+        limiterStatisticsMutex.lock();
+        if( currentCtrlModes[wbi_jnt] == CTRL_MODE_POS || currentCtrlModes[wbi_jnt] == CTRL_MODE_DIRECT_POSITION )
+        {
+            limiterMin[wbi_jnt] = jointPositionMin[wbi_jnt];
+            limiterMax[wbi_jnt] = jointPositionMax[wbi_jnt];
+        }
+        else
+        {
+            limiterMin[wbi_jnt] = -saturation;
+            limiterMax[wbi_jnt] = saturation;
+        }
+        limiterMaxRate[wbi_jnt] = maxRate;
+        limiterLast[wbi_jnt] = seed;
+        limiterLastTime[wbi_jnt] = now;
+        limiterLastValid[wbi_jnt] = seeded;
+        limiterModes[wbi_jnt] = currentCtrlModes[wbi_jnt];
+        limiterStatisticsMutex.unlock();
+    }
+}
+
+bool yarpWholeBodyActuators::readReferenceLimiterSeeds(int wbi_controlboard_id, wbi::ControlMode controlMode)
+{
+    std::vector<double> & seeds = limiterSeeds[wbi_controlboard_id];
+    if( seeds.empty() )
+    {
+        return false;
+    }
+    double * buf = &(seeds[0]);
+    bool ok = false;
+    double scale = 1.0;
+    switch(controlMode)
+    {
+        case CTRL_MODE_POS:
+        case CTRL_MODE_DIRECT_POSITION:
+            ok = ienc[wbi_controlboard_id] != 0 && ienc[wbi_controlboard_id]->getEncoders(buf);
+            scale = yarpWbi::Deg2Rad;
+            break;
+        case CTRL_MODE_VEL:
+            ok = ivel[wbi_controlboard_id]->getRefVelocities(buf);
+            scale = yarpWbi::Deg2Rad;
+            break;
+        case CTRL_MODE_TORQUE:
+            ok = itrq[wbi_controlboard_id]->getRefTorques(buf);
+            break;
+        case CTRL_MODE_MOTOR_PWM:
+#ifndef YARPWBI_YARP_HAS_LEGACY_IOPENLOOP
+            ok = ((IPWMControl*)iopl[wbi_controlboard_id])->getRefDutyCycles(buf);
+#else
+            ok = ((IOpenLoopControl*)iopl[wbi_controlboard_id])->getRefOutputs(buf);
+#endif
+            break;
+        default:
+            break;
+    }
+    for(int axis = 0; ok && axis < (int)seeds.size(); axis++ )
+    {
+        seeds[axis] *= scale;
+    }
+    return ok;
+}
+
+double * yarpWholeBodyActuators::limitReferences(double *ref, int joint, const std::vector<bool> * limitedJoints)
+{
+    if( !referenceLimiterEnabled || ref == 0 || joint >= (int)jointIdList.size() )
+    {
+        return ref;
+    }
+
+    double now = yarp::os::Time::now();
+    int firstJoint = joint >= 0 ? joint : 0;
+    int lastJoint = joint >= 0 ? joint+1 : (int)jointIdList.size();
+    limiterStatisticsMutex.lock();
+    for(int wbi_jnt = firstJoint; wbi_jnt < lastJoint; wbi_jnt++ )
+    {
+        double value = ref[wbi_jnt-firstJoint];
+        //the joints that will not receive the reference keep the state of their limiter
+        if( limitedJoints != 0 && !(*limitedJoints)[wbi_jnt] )
+        {
+            limitedReferences[wbi_jnt] = value;
+            continue;
+        }
+        double limited = value < limiterMin[wbi_jnt] ? limiterMin[wbi_jnt] : (value > limiterMax[wbi_jnt] ? limiterMax[wbi_jnt] : value);
+        if( limited != value )
+        {
+            limiterStatistics[wbi_jnt].saturations++;
+        }
+        if( limiterLastValid[wbi_jnt] && limiterMaxRate[wbi_jnt] > 0.0 )
+        {
+            double maxDelta = limiterMaxRate[wbi_jnt]*(now - limiterLastTime[wbi_jnt]);
+            double rateLimited = limited < limiterLast[wbi_jnt] - maxDelta ? limiterLast[wbi_jnt] - maxDelta :
+                                 (limited > limiterLast[wbi_jnt] + maxDelta ? limiterLast[wbi_jnt] + maxDelta : limited);
+            if( rateLimited != limited )
+            {
+                limiterStatistics[wbi_jnt].rateLimitations++;
+            }
+            limited = rateLimited;
+        }
+        limitedReferences[wbi_jnt] = limited;
+        limiterLast[wbi_jnt] = limited;
+        limiterLastTime[wbi_jnt] = now;
+        limiterLastValid[wbi_jnt] = true;
+    }
+    limiterStatisticsMutex.unlock();
+    return &(limitedReferences[firstJoint]);
+}
+
+bool yarpWholeBodyActuators::getReferenceLimiterStatistics(int joint, ReferenceLimiterStatistics & statistics)
+{
+    if( !referenceLimiterEnabled || joint < 0 || joint >= (int)limiterStatistics.size() )
+    {
+        return false;
+    }
+    limiterStatisticsMutex.lock();
+    statistics = limiterStatistics[joint];
+    limiterStatisticsMutex.unlock();
+    return true;
+}
+
+void yarpWholeBodyActuators::resetReferenceLimiterStatistics()
+{
+    ReferenceLimiterStatistics emptyStatistics = {0,0};
+    limiterStatisticsMutex.lock();
+    limiterStatistics.assign(limiterStatistics.size(), emptyStatistics);
+    limiterStatisticsMutex.unlock();
+}
+
+bool yarpWholeBodyActuators::getReferenceFilterStatistics(ReferenceFilterStatistics & statistics)
+{
+    if( !referenceFilterEnabled )
+    {
+        return false;
+    }
+    filterStatisticsMutex.lock();
+    statistics = filterStatistics;
+    filterStatisticsMutex.unlock();
+    return true;
+}
+
+void yarpWholeBodyActuators::resetReferenceFilterStatistics()
+{
+    filterStatisticsMutex.lock();
+    filterStatistics.sent = 0;
+    filterStatistics.filtered = 0;
+    filterStatisticsMutex.unlock();
+}
+
+bool yarpWholeBodyActuators::configureReferenceFilter(yarp::os::Bottle & actuators_opt_bot)
+{
+    referenceDeadbands.assign(jointIdList.size(), 0.0);
+    referenceFilterEnabled = actuators_opt_bot.check("referenceDeadband") || actuators_opt_bot.check("referenceDeadbandJoints");
+    if( !referenceFilterEnabled )
+    {
+        return true;
+    }
+
+    if( actuators_opt_bot.check("referenceDeadband") )
+    {
+        if( !actuators_opt_bot.find("referenceDeadband").isDouble() || actuators_opt_bot.find("referenceDeadband").asDouble() < 0.0 )
+        {
+            std::cerr << "[ERR] yarpWholeBodyActuators: referenceDeadband option should be a non negative double" << std::endl;
+            return false;
+        }
+        referenceDeadbands.assign(jointIdList.size(), actuators_opt_bot.find("referenceDeadband").asDouble());
+    }
+
+    if( actuators_opt_bot.check("referenceDeadbandJoints") )
+    {
+        yarp::os::Bottle * deadbands_bot = actuators_opt_bot.find("referenceDeadbandJoints").asList();
+        for(int i=0; deadbands_bot != 0 && i < deadbands_bot->size(); i++ )
+        {
+            yarp::os::Bottle * joint_bot = deadbands_bot->get(i).asList();
+            int wbi_jnt = -1;
+            if( joint_bot == 0 || joint_bot->size() != 2 || !joint_bot->get(1).isDouble() || joint_bot->get(1).asDouble() < 0.0 ||
+                !jointIdList.idToIndex(wbi::ID(joint_bot->get(0).asString().c_str()), wbi_jnt) )
+            {
+                std::cerr << "[ERR] yarpWholeBodyActuators: malformed element " << deadbands_bot->get(i).toString()
+                          << " of referenceDeadbandJoints option, expected (jointName deadband)" << std::endl;
+                return false;
+            }
+            referenceDeadbands[wbi_jnt] = joint_bot->get(1).asDouble();
+        }
+        if( deadbands_bot == 0 )
+        {
+            std::cerr << "[ERR] yarpWholeBodyActuators: referenceDeadbandJoints option should be a list of (jointName deadband) pairs" << std::endl;
+            return false;
+        }
+    }
+
+    if( actuators_opt_bot.check("referenceRefreshPeriod") )
+    {
+        if( !actuators_opt_bot.find("referenceRefreshPeriod").isDouble() || actuators_opt_bot.find("referenceRefreshPeriod").asDouble() <= 0.0
+            || actuators_opt_bot.find("referenceRefreshPeriod").asDouble() > MAX_REFERENCE_REFRESH_PERIOD )
+        {
+            std::cerr << "[ERR] yarpWholeBodyActuators: referenceRefreshPeriod option should be a positive double not greater than "
+                      << MAX_REFERENCE_REFRESH_PERIOD << " seconds" << std::endl;
+            return false;
+        }
+        referenceRefreshPeriod = actuators_opt_bot.find("referenceRefreshPeriod").asDouble();
+    }
+
+    return true;
+}
+
 bool yarpWholeBodyActuatorsControlledJoints::reset(const int nrOfControlBoards)
 {
     if( nrOfControlBoards < 0 )
@@ -263,6 +926,7 @@ bool yarpWholeBodyActuatorsControlledJoints::reset(const int nrOfControlBoards)
     torqueControlledJoints.resize(nrOfControlBoards,std::vector<yarpWBAControlledJoint>(0));
     pwmControlledJoints.clear();
     pwmControlledJoints.resize(nrOfControlBoards,std::vector<yarpWBAControlledJoint>(0));
+    dispatchPlan.clear();
     return true;
 }
 
@@ -342,14 +1006,86 @@ bool yarpWholeBodyActuators::updateControlledJointsForEachControlBoard()
     assert(total_controlled_joints == (int)this->getActuatorList().size());
     #endif
 
+    // compile the dispatch plan used by setControlReference
+    for(int wbi_ctrlBoard = 0; wbi_ctrlBoard < (int)controlBoardNames.size(); wbi_ctrlBoard++ )
+    {
+        addDispatchEntry(wbi_ctrlBoard, wbi::CTRL_MODE_POS, controlledJointsForControlBoard.positionControlledJoints[wbi_ctrlBoard]);
+        addDispatchEntry(wbi_ctrlBoard, wbi::CTRL_MODE_DIRECT_POSITION, controlledJointsForControlBoard.positionDirectedControlledJoints[wbi_ctrlBoard]);
+        addDispatchEntry(wbi_ctrlBoard, wbi::CTRL_MODE_VEL, controlledJointsForControlBoard.velocityControlledJoints[wbi_ctrlBoard]);
+        addDispatchEntry(wbi_ctrlBoard, wbi::CTRL_MODE_TORQUE, controlledJointsForControlBoard.torqueControlledJoints[wbi_ctrlBoard]);
+        addDispatchEntry(wbi_ctrlBoard, wbi::CTRL_MODE_MOTOR_PWM, controlledJointsForControlBoard.pwmControlledJoints[wbi_ctrlBoard]);
+    }
+
+    // the limits of the references depend on the control mode
+    updateReferenceLimiter();
+
     return true;
 }
 
+void yarpWholeBodyActuators::addDispatchEntry(int wbi_controlboard_id, wbi::ControlMode controlMode,
+                                              const std::vector<yarpWBAControlledJoint> & joints)
+{
+    int nrOfJoints = joints.size();
+    if( nrOfJoints == 0 )
+    {
+        return;
+    }
+
+    yarpWBADispatchEntry entry;
+    entry.wbi_controlboard_id = wbi_controlboard_id;
+    entry.controlMode = controlMode;
+    entry.allAxes = (nrOfJoints == totalAxesInControlBoard[wbi_controlboard_id]);
+    entry.scale = (controlMode == wbi::CTRL_MODE_POS ||
+                   controlMode == wbi::CTRL_MODE_DIRECT_POSITION ||
+                   controlMode == wbi::CTRL_MODE_VEL) ? yarpWbi::Rad2Deg : 1.0;
+
+    // full vector calls are indexed by controlboard axis, subset calls by position in the subset
+    bool boardIndexed = entry.allAxes;
+    entry.references.assign(boardIndexed ? totalAxesInControlBoard[wbi_controlboard_id] : nrOfJoints, 0.0);
+
+    for(int jnt = 0; jnt < nrOfJoints; jnt++ )
+    {
+        entry.wbi_ids.push_back(joints[jnt].wbi_id);
+        entry.yarp_axes.push_back(joints[jnt].yarp_controlboard_axis);
+        entry.bufferIndices.push_back(boardIndexed ? joints[jnt].yarp_controlboard_axis : jnt);
+    }
+
+    // a new entry is always sent the first time, whatever the deadband
+    // only the modes whose last reference stays valid on the board are filtered: velocity and torque
+    // references are streamed, and a board stops the joint if they are not refreshed
+    entry.filtered = referenceFilterEnabled && (int)referenceDeadbands.size() == (int)jointIdList.size()
+                     && (controlMode == wbi::CTRL_MODE_POS ||
+                         controlMode == wbi::CTRL_MODE_DIRECT_POSITION ||
+                         controlMode == wbi::CTRL_MODE_MOTOR_PWM);
+    entry.sentOnce = false;
+    entry.lastRefreshTime = 0.0;
+    entry.lastSent.assign(nrOfJoints, 0.0);
+    entry.changedJoints.assign(nrOfJoints, 0);
+    entry.changed_yarp_axes.assign(nrOfJoints, 0);
+    entry.changedReferences.assign(nrOfJoints, 0.0);
+    entry.deadbands.assign(nrOfJoints, 0.0);
+    for(int jnt = 0; entry.filtered && jnt < nrOfJoints; jnt++ )
+    {
+        entry.deadbands[jnt] = entry.scale*referenceDeadbands[joints[jnt].wbi_id];
+    }
+
+    controlledJointsForControlBoard.dispatchPlan.push_back(entry);
+}
+
 
 bool yarpWholeBodyActuators::close()
 {
+    //the writers and the verifier use the drivers, stop them first
+    stopReferenceWriters();
+    if( modeVerifier != 0 )
+    {
+        modeVerifier->stop();
+        delete modeVerifier;
+        modeVerifier = 0;
+    }
+
     bool ok = true;
-    for(int ctrlBrd=0; ctrlBrd < (int)controlBoardNames.size(); ctrlBrd++ )
+    for(int ctrlBrd=0; ctrlBrd < (int)dd.size(); ctrlBrd++ )
     {
         if( dd[ctrlBrd]!= 0 ) {
             ok = dd[ctrlBrd]->close();
@@ -392,52 +1128,202 @@ bool yarpWholeBodyActuators::setControlModeSingleJoint(ControlMode controlMode,
 {
     if (!initDone) return false;
 
+    ///< check that joint is not already in the specified control mode (the cached mode is verified by the control mode verifier)
+    if(currentCtrlModes[joint]==controlMode && !ctrlModeMismatch[joint])
+    {
+        return ref == 0 || setControlReference(ref,joint);
+    }
+
     bool ok = false;
-    ///< check that joint is not already in the specified control mode
-    // commented out for now
-    if(currentCtrlModes[joint]!=controlMode)
+    int bodyPart = controlBoardAxisList[joint].first;
+    int controlBoardJointAxis = controlBoardAxisList[joint].second;
+    switch(controlMode)
     {
-        int bodyPart = controlBoardAxisList[joint].first;
-        int controlBoardJointAxis = controlBoardAxisList[joint].second;
-        switch(controlMode)
+        case CTRL_MODE_POS:
+            ok = icmd[bodyPart]->setControlMode(controlBoardJointAxis,VOCAB_CM_POSITION);
+            ok = ok && iinteraction[bodyPart]->setInteractionMode(controlBoardJointAxis,VOCAB_IM_STIFF);
+            break;
+        case CTRL_MODE_DIRECT_POSITION:
+            ok = icmd[bodyPart]->setControlMode(controlBoardJointAxis,VOCAB_CM_POSITION_DIRECT);
+            ok = ok && iinteraction[bodyPart]->setInteractionMode(controlBoardJointAxis,VOCAB_IM_STIFF);
+            break;
+        case CTRL_MODE_VEL:
+            ok = icmd[bodyPart]->setControlMode(controlBoardJointAxis,VOCAB_CM_VELOCITY);
+            ok = ok && iinteraction[bodyPart]->setInteractionMode(controlBoardJointAxis,VOCAB_IM_STIFF);
+            break;
+        case CTRL_MODE_TORQUE:
+            ok = icmd[bodyPart]->setControlMode(controlBoardJointAxis,VOCAB_CM_TORQUE);
+            break;
+        case CTRL_MODE_MOTOR_PWM:
+            ok = icmd[bodyPart]->setControlMode(controlBoardJointAxis,VOCAB_CM_PWM);
+            break;
+        default:
+            break;
+    }
+
+    if(ok)
+    {
+        currentCtrlModes[joint] = controlMode;
+        ctrlModeMismatch[joint] = false;
+        this->updateControlledJointsForEachControlBoard();
+
+        //the reference of the switched joint is known only to the controlboard
+        std::vector<bool> switched(jointIdList.size(), false);
+        switched[joint] = true;
+        invalidateReferenceShadows(switched);
+
+        if(ref != 0)
         {
-            case CTRL_MODE_POS:
-                ok = icmd[bodyPart]->setControlMode(controlBoardJointAxis,VOCAB_CM_POSITION);
-                ok = ok && iinteraction[bodyPart]->setInteractionMode(controlBoardJointAxis,VOCAB_IM_STIFF);
-                break;
-            case CTRL_MODE_DIRECT_POSITION:
-                ok = icmd[bodyPart]->setControlMode(controlBoardJointAxis,VOCAB_CM_POSITION_DIRECT);
-                ok = ok && iinteraction[bodyPart]->setInteractionMode(controlBoardJointAxis,VOCAB_IM_STIFF);
-                break;
-            case CTRL_MODE_VEL:
-                ok = icmd[bodyPart]->setControlMode(controlBoardJointAxis,VOCAB_CM_VELOCITY);
-                ok = ok && iinteraction[bodyPart]->setInteractionMode(controlBoardJointAxis,VOCAB_IM_STIFF);
-                break;
-            case CTRL_MODE_TORQUE:
-                ok = icmd[bodyPart]->setControlMode(controlBoardJointAxis,VOCAB_CM_TORQUE);
-                if( ok && ref )
-                {
-                    itrq[bodyPart]->setRefTorque(controlBoardJointAxis, *ref);
-                }
-                break;
-            case CTRL_MODE_MOTOR_PWM:
-                ok = icmd[bodyPart]->setControlMode(controlBoardJointAxis,VOCAB_CM_PWM);
-                break;
-            default:
-                break;
+            setControlReference(ref,joint);
+        }
+    } else {
+        fprintf(stderr, "yarpWholeBodyActuators: Cannot set control mode %d on joint %d \n", controlMode, joint);
+    }
+
+    return ok;
+}
+
+int yarpWholeBodyActuators::wbiToYarpCtrlMode(ControlMode controlMode)
+{
+    switch(controlMode)
+    {
+    case CTRL_MODE_POS:             return VOCAB_CM_POSITION;
+    case CTRL_MODE_DIRECT_POSITION: return VOCAB_CM_POSITION_DIRECT;
+    case CTRL_MODE_VEL:             return VOCAB_CM_VELOCITY;
+    case CTRL_MODE_TORQUE:          return VOCAB_CM_TORQUE;
+    case CTRL_MODE_MOTOR_PWM:       return VOCAB_CM_PWM;
+    default: break;
+    }
+    return VOCAB_CM_UNKNOWN;
+}
+
+bool yarpWholeBodyActuators::setControlModeAllJoints(ControlMode controlMode, double *ref)
+{
+    int yarpCtrlMode = wbiToYarpCtrlMode(controlMode);
+    if( yarpCtrlMode == VOCAB_CM_UNKNOWN )
+    {
+        return false;
+    }
+    bool stiffInteraction = controlMode == CTRL_MODE_POS || controlMode == CTRL_MODE_DIRECT_POSITION || controlMode == CTRL_MODE_VEL;
+
+    //Buffer variables, sized for the largest controlboard
+    int maxAxes = 0;
+    for(int wbi_controlboard_id=0; wbi_controlboard_id < (int)totalAxesInControlBoard.size(); wbi_controlboard_id++ )
+    {
+        maxAxes = std::max(maxAxes, totalAxesInControlBoard[wbi_controlboard_id]);
+    }
+    std::vector<int> buf_controlledJoints(maxAxes);
+    std::vector<int> buf_modes(maxAxes);
+    std::vector<yarp::dev::InteractionModeEnum> buf_interactionModes(maxAxes);
+    std::vector<double> buf_references(maxAxes);
+    std::vector<int> buf_wbiJoints(maxAxes);
+    std::vector<bool> switched(jointIdList.size(), false);
+    std::vector<bool> boardFailed(controlBoardNames.size(), false);
+
+    bool ok = true;
+    bool modesChanged = false;
+    for(int wbi_controlboard_id=0; wbi_controlboard_id < (int)controlBoardNames.size(); wbi_controlboard_id++ )
+    {
+        ///< collect the joints of the board that are not already in the requested mode
+        int nrOfJointsToSwitch = 0;
+        for(int wbi_jnt=0; wbi_jnt < (int)jointIdList.size() && nrOfJointsToSwitch < maxAxes; wbi_jnt++ )
+        {
+            if( controlBoardAxisList[wbi_jnt].first != wbi_controlboard_id ||
+                (currentCtrlModes[wbi_jnt] == controlMode && !ctrlModeMismatch[wbi_jnt]) )
+            {
+                continue;
+            }
+            buf_controlledJoints[nrOfJointsToSwitch] = controlBoardAxisList[wbi_jnt].second;
+            buf_modes[nrOfJointsToSwitch] = yarpCtrlMode;
+            buf_interactionModes[nrOfJointsToSwitch] = VOCAB_IM_STIFF;
+            buf_wbiJoints[nrOfJointsToSwitch] = wbi_jnt;
+            nrOfJointsToSwitch++;
+        }
+        if( nrOfJointsToSwitch == 0 )
+        {
+            continue;
         }
 
-        if(ok)
+        ///< switch all the joints of the board with a single call, so the board does not pass through mixed-mode states
+        bool board_ok = icmd[wbi_controlboard_id]->setControlModes(nrOfJointsToSwitch, &(buf_controlledJoints[0]), &(buf_modes[0]));
+        if( board_ok && stiffInteraction )
         {
-            currentCtrlModes[joint] = controlMode;
-            this->updateControlledJointsForEachControlBoard();
+            board_ok = iinteraction[wbi_controlboard_id]->setInteractionModes(nrOfJointsToSwitch, &(buf_controlledJoints[0]), &(buf_interactionModes[0]));
+        }
+
+        if( !board_ok )
+        {
+            std::cerr << "[ERR] yarpWholeBodyActuators::setControlMode error: unable to set control mode " << controlMode
+                      << " for controlboard " << controlBoardNames[wbi_controlboard_id] << std::endl;
+            boardFailed[wbi_controlboard_id] = true;
+            ok = false;
+            continue;
+        }
+
+        for(int i=0; i < nrOfJointsToSwitch; i++ )
+        {
+            currentCtrlModes[buf_wbiJoints[i]] = controlMode;
+            ctrlModeMismatch[buf_wbiJoints[i]] = false;
+            switched[buf_wbiJoints[i]] = true;
+        }
+        modesChanged = true;
+    }
 
-            if(ref != 0)
+    if( modesChanged )
+    {
+        this->updateControlledJointsForEachControlBoard();
+        //the references of the switched joints are known only to the controlboards
+        invalidateReferenceShadows(switched);
+    }
+
+    if( ref == 0 )
+    {
+        return ok;
+    }
+
+    ///< send the references with one call per board to all the joints in the requested mode, also to the ones
+    ///< that were already in it: only the joints of the boards that failed to switch are left out
+    ///< they are sent directly also with asyncReferences, so they have been received when setControlMode returns
+    ///< only the references that are sent go through the limiter, the others would advance its state
+    std::vector<bool> sentJoints(jointIdList.size(), false);
+    for(int wbi_jnt=0; wbi_jnt < (int)jointIdList.size(); wbi_jnt++ )
+    {
+        sentJoints[wbi_jnt] = currentCtrlModes[wbi_jnt] == controlMode && !boardFailed[controlBoardAxisList[wbi_jnt].first];
+    }
+    ref = limitReferences(ref, -1, &sentJoints);
+    double scale = (controlMode == CTRL_MODE_MOTOR_PWM || controlMode == CTRL_MODE_TORQUE) ? 1.0 : yarpWbi::Rad2Deg;
+    for(int wbi_controlboard_id=0; wbi_controlboard_id < (int)controlBoardNames.size(); wbi_controlboard_id++ )
+    {
+        if( boardFailed[wbi_controlboard_id] )
+        {
+            continue;
+        }
+        int nrOfJoints = 0;
+        for(int wbi_jnt=0; wbi_jnt < (int)jointIdList.size() && nrOfJoints < maxAxes; wbi_jnt++ )
+        {
+            if( controlBoardAxisList[wbi_jnt].first != wbi_controlboard_id || !sentJoints[wbi_jnt] )
             {
-                setControlReference(ref,joint);
+                continue;
             }
-        } else {
-            fprintf(stderr, "yarpWholeBodyActuators: Cannot set control mode %d on joint %d \n", controlMode, joint);
+            buf_controlledJoints[nrOfJoints] = controlBoardAxisList[wbi_jnt].second;
+            buf_references[nrOfJoints] = scale*ref[wbi_jnt];
+            buf_wbiJoints[nrOfJoints] = wbi_jnt;
+            nrOfJoints++;
+        }
+        if( nrOfJoints == 0 )
+        {
+            continue;
+        }
+        if( !sendJointReferences(wbi_controlboard_id, controlMode, nrOfJoints, &(buf_controlledJoints[0]), &(buf_references[0])) )
+        {
+            std::cerr << "[ERR] yarpWholeBodyActuators::setControlMode error: unable to send the references"
+                      << " to controlboard " << controlBoardNames[wbi_controlboard_id] << std::endl;
+            ok = false;
+            continue;
+        }
+        for(int i=0; i < nrOfJoints; i++ )
+        {
+            updateReferenceShadows(&(ref[buf_wbiJoints[i]]), buf_wbiJoints[i]);
         }
     }
 
@@ -453,28 +1339,41 @@ bool yarpWholeBodyActuators::setControlMode(ControlMode controlMode, double *ref
         return false;
     }
 
+    ///< if all the joints are already in the requested mode (as cached), only send the references:
+    ///< the writers are not paused and their pending references are not discarded
+    int firstJoint = joint >= 0 ? joint : 0;
+    int lastJoint = joint >= 0 ? joint+1 : (int)jointIdList.size();
+    bool toSwitch = false;
+    ctrlModesMutex.lock();
+    for(int wbi_jnt = firstJoint; !toSwitch && wbi_jnt < lastJoint; wbi_jnt++ )
+    {
+        toSwitch = currentCtrlModes[wbi_jnt] != controlMode || ctrlModeMismatch[wbi_jnt];
+    }
+    ctrlModesMutex.unlock();
+    if( !toSwitch )
+    {
+        return ref == 0 || setControlReference(ref, joint);
+    }
+
+    //the dispatch plan is going to change: no reference must be sent in the meanwhile
+    pauseReferenceWriters();
+    ctrlModesMutex.lock();
+
     bool ok = true;
     ///< set all joints to the specified control mode
     if(joint<0)
     {
-        for(int j=0; j < (int)jointIdList.size(); j++ )
-        {
-            if(ref != 0)
-            {
-                setControlModeSingleJoint(controlMode,ref+j,j);
-            }
-            else
-            {
-                setControlModeSingleJoint(controlMode,0,j);
-            }
-        }
+        ok = setControlModeAllJoints(controlMode,ref);
     }
     else //set a single joint
     {
         assert(joint >=0 && joint < (int)jointIdList.size());
-        setControlModeSingleJoint(controlMode,ref,joint);
+        ok = setControlModeSingleJoint(controlMode,ref,joint);
     }
 
+    ctrlModesMutex.unlock();
+    resumeReferenceWriters();
+
     return ok;
 }
 
@@ -483,9 +1382,12 @@ bool yarpWholeBodyActuators::setControlReference(double *ref, int joint)
     if (!initDone) return false;
 
     //std::cout << "~~~~~~~~~~~~ setControlReference called " << std::endl;
-    if(joint> (int)jointIdList.size())
+    if(joint>=(int)jointIdList.size())
         return false;
 
+    //clamp the references to the limits of their control mode (if referenceLimiter is set)
+    ref = limitReferences(ref, joint);
+
     bool ok = true;
     if(joint>=0)    // set control reference for the specified joint
     {
@@ -506,226 +1408,301 @@ bool yarpWholeBodyActuators::setControlReference(double *ref, int joint)
                 break;
             case CTRL_MODE_TORQUE:
             {
-                ret_value = itrq[bodyPart]->setRefTorque(controlBoardAxis, *ref);
-            }
-                break;
-            case CTRL_MODE_MOTOR_PWM:
+                ret_value = itrq[bodyPart]->setRefTorque(controlBoardAxis, *ref);
+            }
+                break;
+            case CTRL_MODE_MOTOR_PWM:
+#ifndef YARPWBI_YARP_HAS_LEGACY_IOPENLOOP
+                ret_value = ((IPWMControl*)iopl[bodyPart])->setRefDutyCycle(controlBoardAxis, *ref);
+#else
+                ret_value = ((IOpenLoopControl*)iopl[bodyPart])->setRefOutput(controlBoardAxis, *ref);
+#endif
+                break;
+            default:
+                ret_value = false;
+        }
+        if( ret_value )
+        {
+            updateReferenceShadows(ref, joint);
+        }
+        return ret_value;
+    }
+
+    updateReferenceShadows(ref);
+
+    // with asyncReferences or parallelReferences, leave the references to the writer threads
+    if( !referenceWriters.empty() )
+    {
+        for(int wbi_controlboard_id = 0; wbi_controlboard_id < (int)referenceWriters.size(); wbi_controlboard_id++ )
+        {
+            referenceWriters[wbi_controlboard_id]->post(ref);
+        }
+        // with parallelReferences, wait for all the controlboards to receive them
+        for(int wbi_controlboard_id = 0; synchronousReferenceWriters && wbi_controlboard_id < (int)referenceWriters.size(); wbi_controlboard_id++ )
+        {
+            ok = referenceWriters[wbi_controlboard_id]->waitSent() && ok;
+        }
+        return ok;
+    }
+
+    // set control references for all joints, following the dispatch plan
+    std::vector<yarpWBADispatchEntry> & dispatchPlan = controlledJointsForControlBoard.dispatchPlan;
+    for(int entry = 0; entry < (int)dispatchPlan.size(); entry++ )
+    {
+        if( !sendDispatchEntry(dispatchPlan[entry], ref) )
+        {
+            return false;
+        }
+    }
+
+    return ok;
+}
+
+bool yarpWholeBodyActuators::sendControlBoardReferences(int wbi_controlboard_id, const double *ref)
+{
+    bool ok = true;
+    std::vector<yarpWBADispatchEntry> & dispatchPlan = controlledJointsForControlBoard.dispatchPlan;
+    for(int entry = 0; entry < (int)dispatchPlan.size(); entry++ )
+    {
+        if( dispatchPlan[entry].wbi_controlboard_id == wbi_controlboard_id )
+        {
+            ok = sendDispatchEntry(dispatchPlan[entry], ref) && ok;
+        }
+    }
+    return ok;
+}
+
+bool yarpWholeBodyActuators::startReferenceWriters()
+{
+    for(int wbi_controlboard_id = 0; wbi_controlboard_id < (int)controlBoardNames.size(); wbi_controlboard_id++ )
+    {
+        yarpWholeBodyActuatorsWriter * writer = new yarpWholeBodyActuatorsWriter(this, wbi_controlboard_id, jointIdList.size(), synchronousReferenceWriters);
+        if( !writer->start() )
+        {
+            std::cerr << "[ERR] yarpWholeBodyActuators: unable to start the reference writer of controlboard "
+                      << controlBoardNames[wbi_controlboard_id] << std::endl;
+            delete writer;
+            stopReferenceWriters();
+            return false;
+        }
+        referenceWriters.push_back(writer);
+    }
+    return true;
+}
+
+void yarpWholeBodyActuators::stopReferenceWriters()
+{
+    for(int wbi_controlboard_id = 0; wbi_controlboard_id < (int)referenceWriters.size(); wbi_controlboard_id++ )
+    {
+        referenceWriters[wbi_controlboard_id]->stop();
+        delete referenceWriters[wbi_controlboard_id];
+    }
+    referenceWriters.clear();
+}
+
+void yarpWholeBodyActuators::pauseReferenceWriters()
+{
+    for(int wbi_controlboard_id = 0; wbi_controlboard_id < (int)referenceWriters.size(); wbi_controlboard_id++ )
+    {
+        referenceWriters[wbi_controlboard_id]->sendMutex.lock();
+        referenceWriters[wbi_controlboard_id]->discardPending();
+    }
+}
+
+void yarpWholeBodyActuators::resumeReferenceWriters()
+{
+    for(int wbi_controlboard_id = 0; wbi_controlboard_id < (int)referenceWriters.size(); wbi_controlboard_id++ )
+    {
+        referenceWriters[wbi_controlboard_id]->sendMutex.unlock();
+    }
+}
+
+bool yarpWholeBodyActuators::getReferenceWriterStatistics(int controlBoard, ReferenceWriterStatistics & statistics)
+{
+    if( controlBoard < 0 || controlBoard >= (int)referenceWriters.size() )
+    {
+        return false;
+    }
+    referenceWriters[controlBoard]->getStatistics(statistics);
+    return true;
+}
+
+bool yarpWholeBodyActuators::sendJointReferences(int wbi_controlboard_id, wbi::ControlMode controlMode,
+                                                 int nrOfJoints, const int *axes, const double *references)
+{
+    bool ok = false;
+    switch(controlMode)
+    {
+        case CTRL_MODE_POS:
+            ok = ipos[wbi_controlboard_id]->positionMove(nrOfJoints, axes, references);
+            break;
+        case CTRL_MODE_DIRECT_POSITION:
+            ok = ipositionDirect[wbi_controlboard_id]->setPositions(nrOfJoints, axes, references);
+            break;
+        case CTRL_MODE_VEL:
+            ok = ivel[wbi_controlboard_id]->velocityMove(nrOfJoints, axes, references);
+            break;
+        case CTRL_MODE_TORQUE:
+            ok = itrq[wbi_controlboard_id]->setRefTorques(nrOfJoints, axes, references);
+            break;
+        case CTRL_MODE_MOTOR_PWM:
+            //the PWM interface has no subset call: send the references one by one,
+            //so that the axes not controlled by the wbi are never written
+            ok = true;
+            for( int jnt = 0; jnt < nrOfJoints; jnt++ )
+            {
 #ifndef YARPWBI_YARP_HAS_LEGACY_IOPENLOOP
-                ret_value = ((IPWMControl*)iopl[bodyPart])->setRefDutyCycle(controlBoardAxis, *ref);
+                ok = ((IPWMControl*)iopl[wbi_controlboard_id])->setRefDutyCycle(axes[jnt], references[jnt]) && ok;
 #else
-                ret_value = ((IOpenLoopControl*)iopl[bodyPart])->setRefOutput(controlBoardAxis, *ref);
+                ok = ((IOpenLoopControl*)iopl[wbi_controlboard_id])->setRefOutput(axes[jnt], references[jnt]) && ok;
 #endif
-                break;
-            default:
-                ret_value = false;
-        }
-        return ret_value;
+            }
+            break;
+        default:
+            break;
+    }
+    return ok;
+}
+
+bool yarpWholeBodyActuators::sendDispatchEntryChanges(yarpWBADispatchEntry & entry, const double *ref, int nrOfChangedJoints)
+{
+    for( int changed = 0; changed < nrOfChangedJoints; changed++ )
+    {
+        int jnt = entry.changedJoints[changed];
+        entry.changed_yarp_axes[changed] = entry.yarp_axes[jnt];
+        entry.changedReferences[changed] = entry.scale*ref[entry.wbi_ids[jnt]];
     }
 
-    //Buffer variables
-    double buf_references[MAX_NJ];
-    int buf_controlledJoints[MAX_NJ];
+    int wbi_controlboard_id = entry.wbi_controlboard_id;
+    bool ok = sendJointReferences(wbi_controlboard_id, entry.controlMode, nrOfChangedJoints,
+                                  &(entry.changed_yarp_axes[0]), &(entry.changedReferences[0]));
 
-    // set control references for all joints
-    for(int wbi_controlboard_id=0; wbi_controlboard_id < (int)controlBoardNames.size(); wbi_controlboard_id++ )
+    if( ok )
     {
-        ///////////////////////////////////////////////////
-        //Sending references for position controlled joints
-        ///////////////////////////////////////////////////
-        int nrOfPosControlledJointsInControlBoard = controlledJointsForControlBoard.positionControlledJoints[wbi_controlboard_id].size();
-        if( nrOfPosControlledJointsInControlBoard > 0 )
+        for( int changed = 0; changed < nrOfChangedJoints; changed++ )
         {
-             if( nrOfPosControlledJointsInControlBoard == totalAxesInControlBoard[wbi_controlboard_id] )
-             {
-                //If the wbi controls all the joint in the control board, use the usual interface setPositions
-                for( int controlBoard_jnt = 0; controlBoard_jnt < nrOfPosControlledJointsInControlBoard; controlBoard_jnt++ )
-                {
-                     int wbi_id = controlledJointsForControlBoard.positionControlledJoints[wbi_controlboard_id][controlBoard_jnt].wbi_id;
-                     int yarp_controlboard_axis =  controlledJointsForControlBoard.positionControlledJoints[wbi_controlboard_id][controlBoard_jnt].yarp_controlboard_axis;
-                     buf_references[yarp_controlboard_axis] = yarpWbi::Rad2Deg * ref[wbi_id];
-                }
-                ok = ipos[wbi_controlboard_id]->positionMove(buf_references);
-                if(!ok)
-                {
-                    std::cerr << "[ERR] yarpWholeBodyActuators::setControlReference error:"
-                              << "[ERR]  unable to setPositions for controlboard " << controlBoardNames[wbi_controlboard_id] << std::endl;
-                    return false;
-                }
-            }
-            else
-            {
-                //Otherwise send all the commands individually
-                for( int controlBoard_jnt = 0; controlBoard_jnt < nrOfPosControlledJointsInControlBoard; controlBoard_jnt++ )
-                {
-                    int wbi_id = controlledJointsForControlBoard.positionControlledJoints[wbi_controlboard_id][controlBoard_jnt].wbi_id;
-                    int yarp_controlboard_axis =  controlledJointsForControlBoard.positionControlledJoints[wbi_controlboard_id][controlBoard_jnt].yarp_controlboard_axis;
-                    ok = ipos[wbi_controlboard_id]->positionMove(yarp_controlboard_axis,yarpWbi::Rad2Deg*ref[wbi_id]);
-                }
-            }
+            entry.lastSent[entry.changedJoints[changed]] = entry.changedReferences[changed];
         }
+    }
+    else
+    {
+        std::cerr << "yarpWholeBodyActuators::setControlReference error:"
+                  << " unable to send the references of control mode " << entry.controlMode
+                  << " to controlboard " << controlBoardNames[wbi_controlboard_id] << std::endl;
+    }
+    return ok;
+}
 
-        //////////////////////////////////////////////////////////
-        //Sending references for direct position controlled joints
-        //////////////////////////////////////////////////////////
-        int nrOfPosDirectControlledJointsInControlBoard = controlledJointsForControlBoard.positionDirectedControlledJoints[wbi_controlboard_id].size();
-        if( nrOfPosDirectControlledJointsInControlBoard > 0 )
+bool yarpWholeBodyActuators::sendDispatchEntry(yarpWBADispatchEntry & entry, const double *ref)
+{
+    int nrOfJoints = entry.wbi_ids.size();
+    double * buf_references = &(entry.references[0]);
+    int * buf_controlledJoints = &(entry.yarp_axes[0]);
+    int wbi_controlboard_id = entry.wbi_controlboard_id;
+
+    // deadband filter: skip the joints whose reference did not change, unless it is time to refresh all of them
+    double now = 0.0;
+    if( entry.filtered )
+    {
+        now = yarp::os::Time::now();
+        bool refresh = !entry.sentOnce || now - entry.lastRefreshTime >= referenceRefreshPeriod;
+        int nrOfChangedJoints = 0;
+        for( int jnt = 0; !refresh && jnt < nrOfJoints; jnt++ )
         {
-            if( nrOfPosDirectControlledJointsInControlBoard == totalAxesInControlBoard[wbi_controlboard_id] )
-            {
-                //If the wbi controls all the joint in the control board, use the usual interface setPositions
-                for( int controlBoard_jnt = 0; controlBoard_jnt < nrOfPosDirectControlledJointsInControlBoard; controlBoard_jnt++ )
-                {
-                    int wbi_id = controlledJointsForControlBoard.positionDirectedControlledJoints[wbi_controlboard_id][controlBoard_jnt].wbi_id;
-                    int yarp_controlboard_axis =  controlledJointsForControlBoard.positionDirectedControlledJoints[wbi_controlboard_id][controlBoard_jnt].yarp_controlboard_axis;
-                    buf_references[yarp_controlboard_axis] = yarpWbi::Rad2Deg*ref[wbi_id];
-                }
-                ok = ipositionDirect[wbi_controlboard_id]->setPositions(buf_references);
-                if(!ok)
-                {
-                    std::cerr << "yarpWholeBodyActuators::setControlReference error:"
-                              << " unable to command position for controlboard " << controlBoardNames[wbi_controlboard_id] << std::endl;
-                    return false;
-                }
-            }
-            else
+            if( fabs(entry.scale*ref[entry.wbi_ids[jnt]] - entry.lastSent[jnt]) > entry.deadbands[jnt] )
             {
-                //Otherwise send all the commands individually
-                for( int controlBoard_jnt = 0; controlBoard_jnt < nrOfPosDirectControlledJointsInControlBoard; controlBoard_jnt++ )
-                {
-                    int wbi_id = controlledJointsForControlBoard.positionDirectedControlledJoints[wbi_controlboard_id][controlBoard_jnt].wbi_id;
-                    int yarp_controlboard_axis =  controlledJointsForControlBoard.positionDirectedControlledJoints[wbi_controlboard_id][controlBoard_jnt].yarp_controlboard_axis;
-                    ok = ipositionDirect[wbi_controlboard_id]->setPosition(yarp_controlboard_axis,yarpWbi::Rad2Deg*ref[wbi_id]);
-                }
+                entry.changedJoints[nrOfChangedJoints] = jnt;
+                nrOfChangedJoints++;
             }
         }
-
-        //////////////////////////////////////////////////////////
-        //Sending references for velocity controlled joints
-        //////////////////////////////////////////////////////////
-        int nrOfVelocityControlledJointsInControlBoard = controlledJointsForControlBoard.velocityControlledJoints[wbi_controlboard_id].size();
-        if( nrOfVelocityControlledJointsInControlBoard > 0 )
+        int nrOfSentJoints = refresh ? nrOfJoints : nrOfChangedJoints;
+        filterStatisticsMutex.lock();
+        filterStatistics.sent += nrOfSentJoints;
+        filterStatistics.filtered += nrOfJoints - nrOfSentJoints;
+        filterStatisticsMutex.unlock();
+        if( nrOfSentJoints == 0 )
+        {
+            return true;
+        }
+        if( nrOfSentJoints < nrOfJoints )
         {
-            if( nrOfVelocityControlledJointsInControlBoard == totalAxesInControlBoard[wbi_controlboard_id] )
+            return sendDispatchEntryChanges(entry, ref, nrOfChangedJoints);
+        }
+    }
+
+    bool ok = false;
+    switch(entry.controlMode)
+    {
+        case CTRL_MODE_POS:
+            for( int jnt = 0; jnt < nrOfJoints; jnt++ )
             {
-                //If the wbi controls all the joint in the control board, use the usual interface setPositions
-                for( int controlBoard_jnt = 0; controlBoard_jnt < nrOfVelocityControlledJointsInControlBoard; controlBoard_jnt++ )
-                {
-                    int wbi_id = controlledJointsForControlBoard.velocityControlledJoints[wbi_controlboard_id][controlBoard_jnt].wbi_id;
-                    int yarp_controlboard_axis =  controlledJointsForControlBoard.velocityControlledJoints[wbi_controlboard_id][controlBoard_jnt].yarp_controlboard_axis;
-                    buf_references[yarp_controlboard_axis] = yarpWbi::Rad2Deg*ref[wbi_id];
-                }
-                ok = ivel[wbi_controlboard_id]->velocityMove(buf_references);
-                if(!ok)
-                {
-                    std::cerr << "yarpWholeBodyActuators::setControlReference error:"
-                              << " unable to command velocities for controlboard " << controlBoardNames[wbi_controlboard_id] << std::endl;
-                    return false;
-                }
+                buf_references[entry.bufferIndices[jnt]] = entry.scale*ref[entry.wbi_ids[jnt]];
             }
-            else
+            ok = entry.allAxes ? ipos[wbi_controlboard_id]->positionMove(buf_references)
+                               : ipos[wbi_controlboard_id]->positionMove(nrOfJoints, buf_controlledJoints, buf_references);
+            break;
+        case CTRL_MODE_DIRECT_POSITION:
+            for( int jnt = 0; jnt < nrOfJoints; jnt++ )
             {
-                {
-                    //Otherwise send all the commands together, but packing them for iVelocityControl interface
-                    for( int controlBoard_jnt = 0; controlBoard_jnt < nrOfVelocityControlledJointsInControlBoard; controlBoard_jnt++ )
-                    {
-                        int wbi_id = controlledJointsForControlBoard.velocityControlledJoints[wbi_controlboard_id][controlBoard_jnt].wbi_id;
-                        int yarp_controlboard_axis =  controlledJointsForControlBoard.velocityControlledJoints[wbi_controlboard_id][controlBoard_jnt].yarp_controlboard_axis;
-                        buf_references[controlBoard_jnt] = yarpWbi::Rad2Deg*ref[wbi_id];
-                        buf_controlledJoints[controlBoard_jnt] = yarp_controlboard_axis;
-                    }
-                    ok = ivel[wbi_controlboard_id]->velocityMove(nrOfVelocityControlledJointsInControlBoard, buf_controlledJoints, buf_references);
-                    if(!ok)
-                    {
-                        std::cerr << "yarpWholeBodyActuators::setControlReference error:"
-                              << " unable to command velocities for controlboard " << controlBoardNames[wbi_controlboard_id] << std::endl;
-                        return false;
-                    }
-                }
-
+                buf_references[entry.bufferIndices[jnt]] = entry.scale*ref[entry.wbi_ids[jnt]];
             }
-        }
-
-        //////////////////////////////////////////////////////////
-        //Sending references for torque controlled joints
-        //////////////////////////////////////////////////////////
-        int nrOfTorqueControlledJointsInControlBoard = controlledJointsForControlBoard.torqueControlledJoints[wbi_controlboard_id].size();
-        if( nrOfTorqueControlledJointsInControlBoard > 0 )
-        {
-
-            if( nrOfTorqueControlledJointsInControlBoard == totalAxesInControlBoard[wbi_controlboard_id] )
+            ok = entry.allAxes ? ipositionDirect[wbi_controlboard_id]->setPositions(buf_references)
+                               : ipositionDirect[wbi_controlboard_id]->setPositions(nrOfJoints, buf_controlledJoints, buf_references);
+            break;
+        case CTRL_MODE_VEL:
+            for( int jnt = 0; jnt < nrOfJoints; jnt++ )
             {
-                //If the wbi controls all the joint in the control board, use the usual interface setPositions
-                for( int controlBoard_jnt = 0; controlBoard_jnt < nrOfTorqueControlledJointsInControlBoard; controlBoard_jnt++ )
-                {
-                    int wbi_id = controlledJointsForControlBoard.torqueControlledJoints[wbi_controlboard_id][controlBoard_jnt].wbi_id;
-                    int yarp_controlboard_axis =  controlledJointsForControlBoard.torqueControlledJoints[wbi_controlboard_id][controlBoard_jnt].yarp_controlboard_axis;
-                    buf_references[yarp_controlboard_axis] = ref[wbi_id];
-                }
-                    ok = itrq[wbi_controlboard_id]->setRefTorques(buf_references);
-                if(!ok)
-                {
-                    std::cerr << "yarpWholeBodyActuators::setControlReference error:"
-                              << " unable to command position for controlboard " << controlBoardNames[wbi_controlboard_id] << std::endl;
-                    return false;
-                }
+                buf_references[entry.bufferIndices[jnt]] = entry.scale*ref[entry.wbi_ids[jnt]];
             }
-            else
+            ok = entry.allAxes ? ivel[wbi_controlboard_id]->velocityMove(buf_references)
+                               : ivel[wbi_controlboard_id]->velocityMove(nrOfJoints, buf_controlledJoints, buf_references);
+            break;
+        case CTRL_MODE_TORQUE:
+            for( int jnt = 0; jnt < nrOfJoints; jnt++ )
             {
-                //Otherwise send all the commands individually
-                for( int controlBoard_jnt = 0; controlBoard_jnt < nrOfTorqueControlledJointsInControlBoard; controlBoard_jnt++ )
-                {
-                    int wbi_id = controlledJointsForControlBoard.torqueControlledJoints[wbi_controlboard_id][controlBoard_jnt].wbi_id;
-                    int yarp_controlboard_axis =  controlledJointsForControlBoard.torqueControlledJoints[wbi_controlboard_id][controlBoard_jnt].yarp_controlboard_axis;
-                    ok = itrq[wbi_controlboard_id]->setRefTorque(yarp_controlboard_axis, ref[wbi_id]);
-                }
+                buf_references[entry.bufferIndices[jnt]] = entry.scale*ref[entry.wbi_ids[jnt]];
             }
-        }
-
-        //////////////////////////////////////////////////////////
-        //Sending references for pwm controlled joints
-        //////////////////////////////////////////////////////////
-        int nrOfPWMControlledJointsInControlBoard = controlledJointsForControlBoard.pwmControlledJoints[wbi_controlboard_id].size();
-        if( nrOfPWMControlledJointsInControlBoard > 0 )
-        {
-            if( nrOfPWMControlledJointsInControlBoard == totalAxesInControlBoard[wbi_controlboard_id] )
+            ok = entry.allAxes ? itrq[wbi_controlboard_id]->setRefTorques(buf_references)
+                               : itrq[wbi_controlboard_id]->setRefTorques(nrOfJoints, buf_controlledJoints, buf_references);
+            break;
+        case CTRL_MODE_MOTOR_PWM:
+            for( int jnt = 0; jnt < nrOfJoints; jnt++ )
+            {
+                buf_references[entry.bufferIndices[jnt]] = entry.scale*ref[entry.wbi_ids[jnt]];
+            }
+            if( entry.allAxes )
             {
-                //If the wbi controls all the joint in the control board, use the usual interface setPositions
-                for( int controlBoard_jnt = 0; controlBoard_jnt < nrOfPWMControlledJointsInControlBoard; controlBoard_jnt++ )
-                {
-                    int wbi_id = controlledJointsForControlBoard.pwmControlledJoints[wbi_controlboard_id][controlBoard_jnt].wbi_id;
-                    int yarp_controlboard_axis = controlledJointsForControlBoard.pwmControlledJoints[wbi_controlboard_id][controlBoard_jnt].yarp_controlboard_axis;
-                    buf_references[yarp_controlboard_axis] = ref[wbi_id];
-                }
 #ifndef YARPWBI_YARP_HAS_LEGACY_IOPENLOOP
                 ok = ((IPWMControl*)iopl[wbi_controlboard_id])->setRefDutyCycles(buf_references);
 #else
                 ok = ((IOpenLoopControl*)iopl[wbi_controlboard_id])->setRefOutputs(buf_references);
 #endif
-                if(!ok)
-                {
-                    std::cerr << "yarpWholeBodyActuators::setControlReference error:"
-                              << " unable to command position for controlboard " << controlBoardNames[wbi_controlboard_id] << std::endl;
-                    return false;
-                }
             }
             else
             {
-                //Otherwise send all the commands individually
-                for( int controlBoard_jnt = 0; controlBoard_jnt < nrOfPWMControlledJointsInControlBoard; controlBoard_jnt++ )
-                {
-                    int wbi_id = controlledJointsForControlBoard.pwmControlledJoints[wbi_controlboard_id][controlBoard_jnt].wbi_id;
-                    int yarp_controlboard_axis =  controlledJointsForControlBoard.pwmControlledJoints[wbi_controlboard_id][controlBoard_jnt].yarp_controlboard_axis;
-#ifndef YARPWBI_YARP_HAS_LEGACY_IOPENLOOP
-                    ok = ((IPWMControl*)iopl[wbi_controlboard_id])->setRefDutyCycle(yarp_controlboard_axis,ref[wbi_id]);
-#else
-                    ok = ((IOpenLoopControl*)iopl[wbi_controlboard_id])->setRefOutput(yarp_controlboard_axis,ref[wbi_id]);
-#endif
-                }
+                //no subset call for PWM: the references are sent one by one, so that the axes not controlled by the wbi are never written
+                ok = sendJointReferences(wbi_controlboard_id, entry.controlMode, nrOfJoints, buf_controlledJoints, buf_references);
             }
-        }
-
+            break;
+        default:
+            break;
     }
 
+    if(!ok)
+    {
+        std::cerr << "yarpWholeBodyActuators::setControlReference error:"
+                  << " unable to send the references of control mode " << entry.controlMode
+                  << " to controlboard " << controlBoardNames[wbi_controlboard_id] << std::endl;
+    }
+    else if( entry.filtered )
+    {
+        for( int jnt = 0; jnt < nrOfJoints; jnt++ )
+        {
+            entry.lastSent[jnt] = entry.scale*ref[entry.wbi_ids[jnt]];
+        }
+        entry.sentOnce = true;
+        entry.lastRefreshTime = now;
+    }
     return ok;
 }
 
@@ -777,6 +1754,7 @@ ControlMode yarpWholeBodyActuators::yarpToWbiCtrlMode(int yarpCtrlMode)
     {
     case VOCAB_CM_TORQUE:   return CTRL_MODE_TORQUE;
     case VOCAB_CM_POSITION: return CTRL_MODE_POS;
+    case VOCAB_CM_POSITION_DIRECT: return CTRL_MODE_DIRECT_POSITION;
     case VOCAB_CM_VELOCITY: return CTRL_MODE_VEL;
     case VOCAB_CM_PWM: return CTRL_MODE_MOTOR_PWM;
     }
@@ -790,28 +1768,22 @@ bool yarpWholeBodyActuators::setPIDGains(const double *pValue, const double *dVa
     //The FOR_ALL atomicity is debated in github.. currently do the same as the rest of the library
     bool result = true;
     if (joint < 0) {
-        return false;
-//        FOR_ALL(itBp, itJ) {
-//            switch (currentCtrlModes[ID(itBp->first,*itJ)]) {
-//                case wbi::CTRL_MODE_TORQUE:
-//                {
-//                    //this is wrong...
-////                    Pid currentPid;
-////                    result = itrq[itBp->first]->getTorquePid(joint, &currentPid);
-////                    if (!result) break;
-////                    if (pValue != NULL)
-////                        currentPid.kp = *pValue;
-////                    if (dValue != NULL)
-////                        currentPid.kd = *dValue;
-////                    if (iValue != NULL)
-////                        currentPid.ki = *iValue;
-////                    result = itrq[itBp->first]->setTorquePid(joint, currentPid);
-////                    break;
-//                }
-//                default:
-//                    break;
-//            }
-//        }
+        //read the torque pids of all the joints (one call for each controlboard), change the gains of the joints
+        //controlled in torque and send them back
+        std::vector<Pid> currentPids(jointIdList.size());
+        if (currentPids.empty()) return true;
+        result = getPIDsAllJoints(VOCAB_PIDTYPE_TORQUE, &(currentPids[0]));
+        if (!result) return false;
+        for (int wbi_jnt = 0; wbi_jnt < (int)jointIdList.size(); wbi_jnt++) {
+            if (currentCtrlModes[wbi_jnt] != wbi::CTRL_MODE_TORQUE) continue;
+            if (pValue != NULL)
+                currentPids[wbi_jnt].kp = pValue[wbi_jnt];
+            if (dValue != NULL)
+                currentPids[wbi_jnt].kd = dValue[wbi_jnt];
+            if (iValue != NULL)
+                currentPids[wbi_jnt].ki = iValue[wbi_jnt];
+        }
+        result = setPIDsAllJoints(VOCAB_PIDTYPE_TORQUE, &(currentPids[0]));
     }
     else {
         int bodyPart = controlBoardAxisList[joint].first;
@@ -838,68 +1810,151 @@ bool yarpWholeBodyActuators::setPIDGains(const double *pValue, const double *dVa
     return result;
 }
 
+bool yarpWholeBodyActuators::wbiToYarpPidType(wbi::ControlMode controlMode, yarp::dev::PidControlTypeEnum & pidType)
+{
+    switch (controlMode) {
+        case wbi::CTRL_MODE_POS:
+        case wbi::CTRL_MODE_DIRECT_POSITION:
+            pidType = VOCAB_PIDTYPE_POSITION;
+            return true;
+        case wbi::CTRL_MODE_VEL:
+            pidType = VOCAB_PIDTYPE_VELOCITY;
+            return true;
+        case wbi::CTRL_MODE_TORQUE:
+            pidType = VOCAB_PIDTYPE_TORQUE;
+            return true;
+        default:
+            break;
+    }
+    return false;
+}
+
 bool yarpWholeBodyActuators::setPIDGains(yarp::dev::Pid *pids, wbi::ControlMode controlMode, int joint)
+{
+    if (!initDone || joint >= (int)jointIdList.size()) return false;
+    yarp::dev::PidControlTypeEnum pidType;
+    if (!wbiToYarpPidType(controlMode, pidType)) {
+        yError("yarpWholeBodyActuators::setPIDGains: control mode %d has no pids", (int)controlMode);
+        return false;
+    }
+    if (joint < 0) {
+        return setPIDsAllJoints(pidType, pids);
+    }
+    int bodyPart = controlBoardAxisList[joint].first;
+    int controlBoardJointAxis = controlBoardAxisList[joint].second;
+    return ipid[bodyPart]->setPid(pidType, controlBoardJointAxis, *pids);
+}
+
+bool yarpWholeBodyActuators::getPIDGains(yarp::dev::Pid *pids, wbi::ControlMode controlMode, int joint)
+{
+    if (!initDone || joint >= (int)jointIdList.size()) return false;
+    yarp::dev::PidControlTypeEnum pidType;
+    if (!wbiToYarpPidType(controlMode, pidType)) {
+        yError("yarpWholeBodyActuators::getPIDGains: control mode %d has no pids", (int)controlMode);
+        return false;
+    }
+    if (joint < 0) {
+        return getPIDsAllJoints(pidType, pids);
+    }
+    int bodyPart = controlBoardAxisList[joint].first;
+    int controlBoardJointAxis = controlBoardAxisList[joint].second;
+    return ipid[bodyPart]->getPid(pidType, controlBoardJointAxis, pids);
+}
+
+bool yarpWholeBodyActuators::setPIDGains(const PIDList &pids, wbi::ControlMode controlMode)
+{
+    if (!initDone) return false;
+    if (pids.size() != jointIdList.size()) {
+        yError("yarpWholeBodyActuators::setPIDGains: the PIDList has %d elements, but the actuators are %d", (int)pids.size(), (int)jointIdList.size());
+        return false;
+    }
+    return setPIDGains(pids.pidList(), controlMode);
+}
+
+bool yarpWholeBodyActuators::getPIDGains(PIDList &pids, wbi::ControlMode controlMode)
 {
     if (!initDone) return false;
+    if (pids.size() != jointIdList.size()) {
+        yError("yarpWholeBodyActuators::getPIDGains: the PIDList has %d elements, but the actuators are %d", (int)pids.size(), (int)jointIdList.size());
+        return false;
+    }
+    return getPIDGains(pids.pidList(), controlMode);
+}
+
+bool yarpWholeBodyActuators::setPIDsAllJoints(yarp::dev::PidControlTypeEnum pidType, const yarp::dev::Pid *pids)
+{
     bool result = true;
-    if (joint < 0) {
-        int i = 0;
-        switch (controlMode) {
-            case wbi::CTRL_MODE_TORQUE:
-                for (std::vector< std::pair<int,int> >::const_iterator jointPair = controlBoardAxisList.begin();
-                     jointPair != controlBoardAxisList.end(); ++jointPair) {
-                    result = result && ipid[jointPair->first]->setPid(VOCAB_PIDTYPE_TORQUE, jointPair->second, pids[i++]);
-                }
-                break;
-            default:
-                break;
+    std::vector<Pid> boardPids;
+    for (int wbi_controlboard_id = 0; wbi_controlboard_id < (int)controlBoardNames.size(); wbi_controlboard_id++) {
+        if (totalControlledAxesInControlBoard[wbi_controlboard_id] == 0) continue;
+
+        //setPids sends the pids of all the axes: if the wbi does not control all of them, read the others first
+        boardPids.resize(totalAxesInControlBoard[wbi_controlboard_id]);
+        bool board_ok = totalControlledAxesInControlBoard[wbi_controlboard_id] == totalAxesInControlBoard[wbi_controlboard_id]
+                        || ipid[wbi_controlboard_id]->getPids(pidType, &(boardPids[0]));
+        for (int wbi_jnt = 0; board_ok && wbi_jnt < (int)jointIdList.size(); wbi_jnt++) {
+            if (controlBoardAxisList[wbi_jnt].first != wbi_controlboard_id) continue;
+            boardPids[controlBoardAxisList[wbi_jnt].second] = pids[wbi_jnt];
         }
-    } else {
-        int bodyPart = controlBoardAxisList[joint].first;
-        int controlBoardJointAxis = controlBoardAxisList[joint].second;
-        switch (controlMode) {
-            case wbi::CTRL_MODE_TORQUE:
-            {
-                result = ipid[bodyPart]->setPid(VOCAB_PIDTYPE_TORQUE, controlBoardJointAxis, *pids);
-                break;
-            }
-            default:
-                break;
+        board_ok = board_ok && ipid[wbi_controlboard_id]->setPids(pidType, &(boardPids[0]));
+        if (!board_ok) {
+            yError("yarpWholeBodyActuators: unable to set the pids of controlboard %s", controlBoardNames[wbi_controlboard_id].c_str());
+            result = false;
         }
     }
     return result;
 }
 
-bool yarpWholeBodyActuators::getPIDGains(yarp::dev::Pid *pids, wbi::ControlMode controlMode, int joint)
+bool yarpWholeBodyActuators::getPIDsAllJoints(yarp::dev::PidControlTypeEnum pidType, yarp::dev::Pid *pids)
 {
-    if (!initDone) return false;
     bool result = true;
-    if (joint < 0) {
-        int i = 0;
-        switch (controlMode) {
-            case wbi::CTRL_MODE_TORQUE:
-                for (std::vector< std::pair<int,int> >::const_iterator jointPair = controlBoardAxisList.begin();
-                     jointPair != controlBoardAxisList.end(); ++jointPair) {
-                    result = result && ipid[jointPair->first]->getPid(VOCAB_PIDTYPE_TORQUE, jointPair->second, &pids[i++]);
-                }
-                break;
-            default:
-                break;
-
+    std::vector<Pid> boardPids;
+    for (int wbi_controlboard_id = 0; wbi_controlboard_id < (int)controlBoardNames.size(); wbi_controlboard_id++) {
+        if (totalControlledAxesInControlBoard[wbi_controlboard_id] == 0) continue;
+
+        boardPids.resize(totalAxesInControlBoard[wbi_controlboard_id]);
+        if (!ipid[wbi_controlboard_id]->getPids(pidType, &(boardPids[0]))) {
+            yError("yarpWholeBodyActuators: unable to get the pids of controlboard %s", controlBoardNames[wbi_controlboard_id].c_str());
+            result = false;
+            continue;
         }
-    } else {
-        int bodyPart = controlBoardAxisList[joint].first;
-        int controlBoardJointAxis = controlBoardAxisList[joint].second;
-        switch (controlMode) {
-            case wbi::CTRL_MODE_TORQUE:
-            {
-                result = ipid[bodyPart]->getPid(VOCAB_PIDTYPE_TORQUE, controlBoardJointAxis, pids);
-                break;
-            }
-            default:
-                break;
+        for (int wbi_jnt = 0; wbi_jnt < (int)jointIdList.size(); wbi_jnt++) {
+            if (controlBoardAxisList[wbi_jnt].first != wbi_controlboard_id) continue;
+            pids[wbi_jnt] = boardPids[controlBoardAxisList[wbi_jnt].second];
+        }
+    }
+    return result;
+}
+
+bool yarpWholeBodyActuators::setFullImpedances(const double *stiffness, const double *damping, wbi::Error *error)
+{
+    if (!initDone || !stiffness || !damping) return false;
+
+    //IImpedanceControl has no call for all the axes of a controlboard: one call for each joint, but without reading the old values
+    bool result = true;
+    for (int wbi_jnt = 0; wbi_jnt < (int)jointIdList.size(); wbi_jnt++) {
+        int bodyPart = controlBoardAxisList[wbi_jnt].first;
+        int controlBoardAxis = controlBoardAxisList[wbi_jnt].second;
+        if (!iimp[bodyPart]->setImpedance(controlBoardAxis, stiffness[wbi_jnt], damping[wbi_jnt])) {
+            result = false;
         }
     }
+    if (!result && error) {
+        error->setError(ErrorDomain, ErrorCodeGeneric, "Unable to set the impedance of some joints");
+    }
+    return result;
+}
+
+bool yarpWholeBodyActuators::getFullImpedances(double *stiffness, double *damping)
+{
+    if (!initDone || !stiffness || !damping) return false;
+
+    bool result = true;
+    for (int wbi_jnt = 0; wbi_jnt < (int)jointIdList.size(); wbi_jnt++) {
+        int bodyPart = controlBoardAxisList[wbi_jnt].first;
+        int controlBoardAxis = controlBoardAxisList[wbi_jnt].second;
+        result = iimp[bodyPart]->getImpedance(controlBoardAxis, &(stiffness[wbi_jnt]), &(damping[wbi_jnt])) && result;
+    }
     return result;
 }
 
@@ -1026,7 +2081,7 @@ bool yarpWholeBodyActuators::getControlProperty(std::string key, std::string &va
 {
     if (key == YarpWholeBodyActuatorsPropertyImpedanceStiffnessKey
         || key == YarpWholeBodyActuatorsPropertyImpedanceDampingKey) {
-        if (joint > (int)jointIdList.size())
+        if (joint >= (int)jointIdList.size())
         {
             if (error)
             {
@@ -1071,7 +2126,7 @@ bool yarpWholeBodyActuators::getControlProperty(std::string key, std::string &va
 
 bool yarpWholeBodyActuators::setInteractionModeSingleJoint(yarp::dev::InteractionModeEnum mode, int joint, ::wbi::Error *error)
 {
-    if (joint > (int)jointIdList.size())
+    if (joint >= (int)jointIdList.size())
     {
         if (error)
         {
@@ -1102,7 +2157,7 @@ bool yarpWholeBodyActuators::setInteractionModeSingleJoint(yarp::dev::Interactio
 
 bool yarpWholeBodyActuators::setImpedanceStiffness(double stiffness, int joint, wbi::Error *error)
 {
-    if (joint > (int)jointIdList.size())
+    if (joint >= (int)jointIdList.size())
     {
         if (error)
         {
@@ -1134,7 +2189,7 @@ bool yarpWholeBodyActuators::setImpedanceStiffness(double stiffness, int joint,
 
 bool yarpWholeBodyActuators::setImpedanceDamping(double damping, int joint, wbi::Error *error)
 {
-    if (joint > (int)jointIdList.size())
+    if (joint >= (int)jointIdList.size())
     {
         if (error)
         {
@@ -1166,7 +2221,7 @@ bool yarpWholeBodyActuators::setImpedanceDamping(double damping, int joint, wbi:
 
 bool yarpWholeBodyActuators::setFullImpedance(double stiffness, double damping, int joint, wbi::Error *error)
 {
-    if (joint > (int)jointIdList.size())
+    if (joint >= (int)jointIdList.size())
     {
         if (error)
         {
@@ -1197,8 +2252,110 @@ bool yarpWholeBodyActuators::getControlReferences(wbi::ControlMode controlMode,
 {
     if (!initDone) return false;
 
+    if(joint>=(int)jointIdList.size())
+        return false;
+
+    std::map<wbi::ControlMode, yarpWBAReferenceShadow>::iterator shadow = referenceShadows.find(controlMode);
+    if( shadow == referenceShadows.end() )
+    {
+        return getControlReferencesFromControlBoards(controlMode, ref, joint);
+    }
+
+    //serve the request from the cache, if all the requested references are known and the cache does not need to be verified
+    double now = yarp::os::Time::now();
+    referenceShadowsMutex.lock();
+    bool verificationDue = joint < 0 && controlReferencesVerificationPeriod > 0.0 &&
+                           now - shadow->second.lastVerificationTime >= controlReferencesVerificationPeriod;
+    bool cached = !verificationDue;
+    int firstJoint = joint >= 0 ? joint : 0;
+    int lastJoint = joint >= 0 ? joint+1 : (int)jointIdList.size();
+    for(int wbi_jnt = firstJoint; cached && wbi_jnt < lastJoint; wbi_jnt++ )
+    {
+        cached = shadow->second.valid[wbi_jnt];
+    }
+    for(int wbi_jnt = firstJoint; cached && wbi_jnt < lastJoint; wbi_jnt++ )
+    {
+        ref[wbi_jnt-firstJoint] = shadow->second.references[wbi_jnt];
+    }
+    referenceShadowsMutex.unlock();
+    if( cached )
+    {
+        return true;
+    }
+
+    bool ok = getControlReferencesFromControlBoards(controlMode, ref, joint);
+    if( ok )
+    {
+        referenceShadowsMutex.lock();
+        for(int wbi_jnt = firstJoint; wbi_jnt < lastJoint; wbi_jnt++ )
+        {
+            shadow->second.references[wbi_jnt] = ref[wbi_jnt-firstJoint];
+            shadow->second.valid[wbi_jnt] = true;
+        }
+        if( joint < 0 )
+        {
+            shadow->second.lastVerificationTime = now;
+        }
+        referenceShadowsMutex.unlock();
+    }
+    return ok;
+}
+
+void yarpWholeBodyActuators::updateReferenceShadows(const double *ref, int joint)
+{
+    if( referenceShadows.empty() )
+    {
+        return;
+    }
+
+    referenceShadowsMutex.lock();
+    if( joint >= 0 )
+    {
+        std::map<wbi::ControlMode, yarpWBAReferenceShadow>::iterator shadow = referenceShadows.find(currentCtrlModes[joint]);
+        if( shadow != referenceShadows.end() )
+        {
+            shadow->second.references[joint] = *ref;
+            shadow->second.valid[joint] = true;
+        }
+    }
+    else
+    {
+        //the dispatch plan has the joints grouped by control mode
+        std::vector<yarpWBADispatchEntry> & dispatchPlan = controlledJointsForControlBoard.dispatchPlan;
+        for(int entry = 0; entry < (int)dispatchPlan.size(); entry++ )
+        {
+            yarpWBAReferenceShadow & shadow = referenceShadows[dispatchPlan[entry].controlMode];
+            for(int jnt = 0; jnt < (int)dispatchPlan[entry].wbi_ids.size(); jnt++ )
+            {
+                int wbi_id = dispatchPlan[entry].wbi_ids[jnt];
+                shadow.references[wbi_id] = ref[wbi_id];
+                shadow.valid[wbi_id] = true;
+            }
+        }
+    }
+    referenceShadowsMutex.unlock();
+}
+
+void yarpWholeBodyActuators::invalidateReferenceShadows(const std::vector<bool> & joints)
+{
+    referenceShadowsMutex.lock();
+    for(std::map<wbi::ControlMode, yarpWBAReferenceShadow>::iterator shadow = referenceShadows.begin();
+        shadow != referenceShadows.end(); ++shadow)
+    {
+        for(int wbi_jnt = 0; wbi_jnt < (int)joints.size() && wbi_jnt < (int)shadow->second.valid.size(); wbi_jnt++ )
+        {
+            if( joints[wbi_jnt] ) shadow->second.valid[wbi_jnt] = false;
+        }
+    }
+    referenceShadowsMutex.unlock();
+}
+
+bool yarpWholeBodyActuators::getControlReferencesFromControlBoards(wbi::ControlMode controlMode, double *ref, int joint)
+{
+    if (!initDone) return false;
+
     //std::cout << "~~~~~~~~~~~~ getControlReferences called " << std::endl;
-    if(joint> (int)jointIdList.size())
+    if(joint>=(int)jointIdList.size())
         return false;
 
     bool ok = true;
@@ -1244,6 +2401,12 @@ bool yarpWholeBodyActuators::getControlReferences(wbi::ControlMode controlMode,
     {
         controlBoardReadingBuffer[wbi_controlboard_id].zero();
 
+        //no need to query the controlboards without joints controlled by the wbi
+        if( totalControlledAxesInControlBoard[wbi_controlboard_id] == 0 )
+        {
+            continue;
+        }
+
         switch(controlMode)
         {
             case CTRL_MODE_POS:
@@ -23,8 +23,13 @@
 #include <string>
 #include <sstream>
 #include <cassert>
+#include <cstring>
+#include <algorithm>
 
 #include <yarp/os/Log.h>
+#include <yarp/os/LogStream.h>
+
+#include <Eigen/Core>
 
 using namespace std;
 using namespace wbi;
@@ -35,19 +40,56 @@ using namespace yarp::sig;
 using namespace iCub::skinDynLib;
 using namespace iCub::ctrl;
 
-#define MAX_NJ 20 ///< Maximum number of joints for body part (used for buffers to avoid dynamic memory allocation)
 #define WAIT_TIME 0.001
 #define BLOCKING_SENSOR_TIMEOUT 0.1
 #define INITIAL_TIMESTAMP -1000.0
 
+/** Map each joint of jointIdList to the pair (0,axis of the remapper device). */
+static void getRemappedAxisList(const IDList & remappedAxesList,
+                                const IDList & jointIdList,
+                                std::vector< std::pair<int,int> > & controlBoardAxisList)
+{
+    controlBoardAxisList.resize(jointIdList.size());
+    for(int jnt=0; jnt < (int)jointIdList.size(); jnt++ )
+    {
+        wbi::ID jnt_name;
+        jointIdList.indexToID(jnt,jnt_name);
+        int remappedAxis = -1;
+        remappedAxesList.idToIndex(jnt_name,remappedAxis);
+        controlBoardAxisList[jnt] = std::pair<int,int>(0,remappedAxis);
+    }
+}
+
 // *********************************************************************************************************************
 // *********************************************************************************************************************
 //                                          YARP WHOLE BODY SENSORS
 // *********************************************************************************************************************
 // *********************************************************************************************************************
 yarpWholeBodySensors::yarpWholeBodySensors(const char* _name, const yarp::os::Property & opt):
-initDone(false), name(_name), wbi_yarp_properties(opt), sensorIdList(wbi::SENSOR_TYPE_SIZE)
+initDone(false), name(_name), wbi_yarp_properties(opt), sensorIdList(wbi::SENSOR_TYPE_SIZE),
+readCacheEnabled(false), readEpoch(0), useControlBoardRemapper(false), timestampAlignment(TIMESTAMP_ALIGNMENT_NONE),
+alignmentHistoryLength(4), sensorPortProbeTimeout(0.0), sensorsLog(0), telemetry(0), sensorTablesLock(0),
+sensorTablesGeneration(0)
+{
+}
+
+void yarpWholeBodySensors::advanceReadEpoch()
+{
+    readEpochMutex.lock();
+    readEpoch++;
+    // skip 0 on wraparound, as it means that no epoch has been started
+    if( readEpoch == 0 ) readEpoch++;
+    readEpochMutex.unlock();
+}
+
+void yarpWholeBodySensors::setReadCacheEnabled(bool enabled)
 {
+    readCacheEnabled = enabled;
+}
+
+bool yarpWholeBodySensors::isReadCacheEnabled() const
+{
+    return readCacheEnabled;
 }
 
 bool yarpWholeBodySensors::setYarpWbiProperties(const yarp::os::Property & yarp_wbi_properties)
@@ -92,6 +134,63 @@ bool yarpWholeBodySensors::init()
         return false;
     }
 
+    if( wbi_yarp_properties.findGroup("WBI_SENSORS_OPTIONS").check("readCache") )
+    {
+        yInfo() << "yarpWholeBodySensors : readCache option found, enabling per-controlboard read cache";
+        yInfo() << "yarpWholeBodySensors : the cache is used only after the first advanceReadEpoch()";
+        readCacheEnabled = true;
+    }
+
+    if( wbi_yarp_properties.findGroup("WBI_SENSORS_OPTIONS").check("sensorPortProbeTimeout") )
+    {
+        sensorPortProbeTimeout = wbi_yarp_properties.findGroup("WBI_SENSORS_OPTIONS").find("sensorPortProbeTimeout").asDouble();
+    }
+
+    if( wbi_yarp_properties.findGroup("WBI_SENSORS_OPTIONS").check("controlBoardBackend") )
+    {
+        std::string backend = wbi_yarp_properties.findGroup("WBI_SENSORS_OPTIONS").find("controlBoardBackend").asString().c_str();
+        if( backend == "remapper" )
+        {
+            yInfo() << "yarpWholeBodySensors : using a single remotecontrolboardremapper for all the controlboard sensors";
+            useControlBoardRemapper = true;
+        }
+        else if( backend != "remote_controlboard" )
+        {
+            yError() << "yarpWholeBodySensors : unknown controlBoardBackend " << backend << ", available backends are remote_controlboard and remapper";
+            return false;
+        }
+    }
+
+    if( wbi_yarp_properties.findGroup("WBI_SENSORS_OPTIONS").check("timestampAlignment") )
+    {
+        std::string alignment = wbi_yarp_properties.findGroup("WBI_SENSORS_OPTIONS").find("timestampAlignment").asString().c_str();
+        if( alignment == "linear" )
+        {
+            timestampAlignment = TIMESTAMP_ALIGNMENT_LINEAR;
+        }
+        else if( alignment == "hermite" )
+        {
+            timestampAlignment = TIMESTAMP_ALIGNMENT_HERMITE;
+        }
+        else
+        {
+            yError() << "yarpWholeBodySensors : unknown timestampAlignment " << alignment << ", available alignments are linear and hermite";
+            return false;
+        }
+
+        if( wbi_yarp_properties.findGroup("WBI_SENSORS_OPTIONS").check("alignmentHistoryLength") )
+        {
+            alignmentHistoryLength = wbi_yarp_properties.findGroup("WBI_SENSORS_OPTIONS").find("alignmentHistoryLength").asInt();
+        }
+        if( alignmentHistoryLength < 2 )
+        {
+            yError() << "yarpWholeBodySensors : alignmentHistoryLength must be at least 2";
+            return false;
+        }
+        yInfo() << "yarpWholeBodySensors : aligning controlboard readings with " << alignment << " interpolation over "
+                << alignmentHistoryLength << " readings";
+    }
+
     yarp::os::Bottle & joints_config = getWBIYarpJointsOptions(wbi_yarp_properties);
     controlBoardNames.clear();
     initDone = appendNewControlBoardsToVector(joints_config,sensorIdList[wbi::SENSOR_ENCODER_POS],controlBoardNames);
@@ -102,22 +201,47 @@ bool yarpWholeBodySensors::init()
         return false;
     }
 
+    if( useControlBoardRemapper )
+    {
+        //All the controlboard related sensors are read from a single virtual
+        //controlboard, whose axes are the union of the encoders, pwm and torque sensors
+        remappedControlBoardNames = controlBoardNames;
+        remappedAxesList = wbi::IDList();
+        remappedAxesList.addIDList(sensorIdList[wbi::SENSOR_ENCODER_POS]);
+        remappedAxesList.addIDList(sensorIdList[wbi::SENSOR_PWM]);
+        remappedAxesList.addIDList(sensorIdList[wbi::SENSOR_TORQUE]);
+        controlBoardNames.assign(1,"remapper");
+    }
+
     //Resize all the data structure that depend on the number of controlboards
     int nrOfControlBoards = controlBoardNames.size();
     ienc.resize(nrOfControlBoards);
     iopl.resize(nrOfControlBoards);
     dd.resize(nrOfControlBoards);
     itrq.resize(nrOfControlBoards);
+    itrqTimed.resize(nrOfControlBoards);
+
+    controlBoardAxes.assign(nrOfControlBoards,0);
+    controlBoardTelemetrySource.assign(nrOfControlBoards,-1);
 
-    controlBoardAxes.resize(nrOfControlBoards);
-    qLastRead.resize(nrOfControlBoards);
-    qStampLastRead.resize(nrOfControlBoards);
-    pwmLastRead.resize(nrOfControlBoards);
-    torqueSensorsLastRead.resize(nrOfControlBoards);
+    controlBoardReadEpoch.resize(CONTROLBOARD_READING_TYPE_SIZE);
+    for(int type=0; type < CONTROLBOARD_READING_TYPE_SIZE; type++ )
+    {
+        controlBoardReadEpoch[type].assign(nrOfControlBoards,0);
+    }
 
-    getControlBoardAxisList(joints_config,sensorIdList[wbi::SENSOR_ENCODER_POS],controlBoardNames,encoderControlBoardAxisList);
-    getControlBoardAxisList(joints_config,sensorIdList[wbi::SENSOR_PWM],controlBoardNames,pwmControlBoardAxisList);
-    getControlBoardAxisList(joints_config,sensorIdList[wbi::SENSOR_TORQUE],controlBoardNames,torqueControlBoardAxisList);
+    if( useControlBoardRemapper )
+    {
+        getRemappedAxisList(remappedAxesList,sensorIdList[wbi::SENSOR_ENCODER_POS],encoderControlBoardAxisList);
+        getRemappedAxisList(remappedAxesList,sensorIdList[wbi::SENSOR_PWM],pwmControlBoardAxisList);
+        getRemappedAxisList(remappedAxesList,sensorIdList[wbi::SENSOR_TORQUE],torqueControlBoardAxisList);
+    }
+    else
+    {
+        getControlBoardAxisList(joints_config,sensorIdList[wbi::SENSOR_ENCODER_POS],controlBoardNames,encoderControlBoardAxisList);
+        getControlBoardAxisList(joints_config,sensorIdList[wbi::SENSOR_PWM],controlBoardNames,pwmControlBoardAxisList);
+        getControlBoardAxisList(joints_config,sensorIdList[wbi::SENSOR_TORQUE],controlBoardNames,torqueControlBoardAxisList);
+    }
 
     encoderControlBoardList = getControlBoardList(encoderControlBoardAxisList);
     pwmControlBoardList     = getControlBoardList(pwmControlBoardAxisList);
@@ -158,6 +282,9 @@ bool yarpWholeBodySensors::init()
         return false;
     }
 
+    //Allocate the last read data of all the opened controlboards
+    buildControlBoardArenas();
+
     //Load accelerometers information: this is tricky
     //as depending on the accelerometer type we have to add some IMU to the system
     std::vector< AccelerometerConfigurationInfo > acc_infos;
@@ -178,9 +305,9 @@ bool yarpWholeBodySensors::init()
     }
 
     //Load imu and ft sensors information
-    std::vector<string> imu_ports, ft_ports;
-    ret = loadFTSensorPortsFromConfig(wbi_yarp_properties,sensorIdList[wbi::SENSOR_FORCE_TORQUE],ft_ports);
-    ret = ret && loadIMUSensorPortsFromConfig(wbi_yarp_properties,sensorIdList[wbi::SENSOR_IMU],imu_ports);
+    std::vector<string> imu_ports, ft_ports, imu_carriers, ft_carriers;
+    ret = loadFTSensorPortsFromConfig(wbi_yarp_properties,sensorIdList[wbi::SENSOR_FORCE_TORQUE],ft_ports,ft_carriers);
+    ret = ret && loadIMUSensorPortsFromConfig(wbi_yarp_properties,sensorIdList[wbi::SENSOR_IMU],imu_ports,imu_carriers);
     if( ! ret )
     {
         std::cerr << "[ERR] yarpWholeBodySensors::init() error: failing in loading configuration of IMU and FT sensors." << std::endl;
@@ -200,7 +327,22 @@ bool yarpWholeBodySensors::init()
     ftStampSensLastRead.resize(nrOfFtSensors);
     portsFTsens.resize(nrOfFtSensors);
 
+    ftLastSequence.assign(nrOfFtSensors,-1);
+    ftTelemetrySources.assign(nrOfFtSensors,-1);
+    ftCalibration.resize(nrOfFtSensors);
+    for(int ft_numeric_id = 0; ft_numeric_id < nrOfFtSensors; ft_numeric_id++)
+    {
+        wbi::ID ftId;
+        sensorIdList[wbi::SENSOR_FORCE_TORQUE].indexToID(ft_numeric_id,ftId);
+        if( !loadFTSensorCalibration(ftId,ftCalibration[ft_numeric_id]) )
+        {
+            return false;
+        }
+    }
+
     int nrOfImuSensors = sensorIdList[wbi::SENSOR_IMU].size();
+    imuLastSequence.assign(nrOfImuSensors,-1);
+    imuTelemetrySources.assign(nrOfImuSensors,-1);
     imuLastRead.resize(nrOfImuSensors);
     imuStampLastRead.resize(nrOfImuSensors);
     portsIMU.resize(nrOfImuSensors);
@@ -208,7 +350,7 @@ bool yarpWholeBodySensors::init()
 
     for(int ft_numeric_id = 0; ft_numeric_id < (int)sensorIdList[wbi::SENSOR_FORCE_TORQUE].size(); ft_numeric_id++)
     {
-            initDone = initDone && openFTsens(ft_numeric_id,ft_ports[ft_numeric_id]);
+            initDone = initDone && openFTsens(ft_numeric_id,ft_ports[ft_numeric_id],ft_carriers[ft_numeric_id]);
     }
 
     if( !initDone )
@@ -219,7 +361,7 @@ bool yarpWholeBodySensors::init()
 
     for(int imu_numeric_id = 0; imu_numeric_id < (int)sensorIdList[wbi::SENSOR_IMU].size(); imu_numeric_id++)
     {
-            initDone = initDone && openImu(imu_numeric_id,imu_ports[imu_numeric_id]);
+            initDone = initDone && openImu(imu_numeric_id,imu_ports[imu_numeric_id],imu_carriers[imu_numeric_id]);
     }
 
     if( !initDone )
@@ -244,37 +386,18 @@ bool yarpWholeBodySensors::init()
         return false;
     }
 
+    initDone = initDone && openTelemetry();
+    initDone = initDone && openSensorsLog();
+
     return initDone;
 }
 
 bool yarpWholeBodySensors::close()
 {
     bool ok = true;
-    for(int i=0; i < (int)encoderControlBoardList.size(); i++ )
-    {
-        int ctrlBoard = encoderControlBoardList[i];
-        if(dd[ctrlBoard])
-        {
-            ok = ok && dd[ctrlBoard]->close();
-            delete dd[ctrlBoard];
-            dd[ctrlBoard] = 0;
-        }
-    }
-
-    for(int i=0; i < (int)pwmControlBoardList.size(); i++ )
-    {
-        int ctrlBoard = pwmControlBoardList[i];
-        if(dd[ctrlBoard])
-        {
-            ok = ok && dd[ctrlBoard]->close();
-            delete dd[ctrlBoard];
-            dd[ctrlBoard] = 0;
-        }
-    }
-
-    for(int i=0; i < (int)torqueControlBoardList.size(); i++ )
+    //Close the drivers of all the controlboards (including the ones opened by sensors added after init)
+    for(int ctrlBoard=0; ctrlBoard < (int)dd.size(); ctrlBoard++ )
     {
-        int ctrlBoard = torqueControlBoardList[i];
         if(dd[ctrlBoard])
         {
             ok = ok && dd[ctrlBoard]->close();
@@ -301,6 +424,20 @@ bool yarpWholeBodySensors::close()
         }
     }
 
+    if( telemetry != 0 )
+    {
+        telemetry->stopPublishing();
+        delete telemetry;
+        telemetry = 0;
+    }
+
+    if( sensorsLog != 0 )
+    {
+        ok = sensorsLog->close() && ok;
+        delete sensorsLog;
+        sensorsLog = 0;
+    }
+
     return ok;
 }
 
@@ -308,7 +445,7 @@ bool yarpWholeBodySensors::addSensor(const SensorType st, const ID &sid)
 {
     if( initDone )
     {
-        return false;
+        return addSensorAfterInit(st, sid);
     }
 
     if( st >= 0 && st < wbi::SENSOR_TYPE_SIZE )
@@ -325,7 +462,14 @@ int yarpWholeBodySensors::addSensors(const SensorType st, const IDList &sids)
 {
     if( initDone )
     {
-        return 0;
+        int addedSensors = 0;
+        for(int i=0; i < (int)sids.size(); i++ )
+        {
+            wbi::ID sid;
+            sids.indexToID(i,sid);
+            if( addSensorAfterInit(st, sid) ) addedSensors++;
+        }
+        return addedSensors;
     }
 
     if( st >= 0 && st < wbi::SENSOR_TYPE_SIZE )
@@ -340,7 +484,73 @@ int yarpWholeBodySensors::addSensors(const SensorType st, const IDList &sids)
 
 bool yarpWholeBodySensors::removeSensor(const SensorType st, const ID &sid)
 {
-    return false;
+    if( st < 0 || st >= wbi::SENSOR_TYPE_SIZE )
+    {
+        return false;
+    }
+
+    if( initDone )
+    {
+        return removeSensorAfterInit(st, sid);
+    }
+
+    return sensorIdList[st].removeID(sid);
+}
+
+void yarpWholeBodySensors::setSensorTablesLock(yarp::os::Semaphore * lock)
+{
+    sensorTablesLock = lock;
+}
+
+unsigned long yarpWholeBodySensors::getSensorTablesGeneration() const
+{
+    return sensorTablesGeneration;
+}
+
+bool yarpWholeBodySensors::requestFTsensorRezero(const int ft_sensor_numeric_id, const int nrOfSamples)
+{
+    if( nrOfSamples <= 0 || ft_sensor_numeric_id < -1 )
+    {
+        return false;
+    }
+
+    ftCalibrationMutex.lock();
+    if( ft_sensor_numeric_id >= (int)ftCalibration.size() )
+    {
+        ftCalibrationMutex.unlock();
+        return false;
+    }
+    for(int ft=0; ft < (int)ftCalibration.size(); ft++ )
+    {
+        if( ft_sensor_numeric_id != -1 && ft != ft_sensor_numeric_id ) continue;
+        ftCalibration[ft].rezeroSamplesRequested = nrOfSamples;
+        ftCalibration[ft].rezeroSamplesCollected = 0;
+        std::fill(ftCalibration[ft].rezeroSum, ftCalibration[ft].rezeroSum+6, 0.0);
+    }
+    ftCalibrationMutex.unlock();
+    return true;
+}
+
+bool yarpWholeBodySensors::isFTsensorRezeroPending(const int ft_sensor_numeric_id)
+{
+    ftCalibrationMutex.lock();
+    bool pending = ft_sensor_numeric_id >= 0 && ft_sensor_numeric_id < (int)ftCalibration.size()
+                   && ftCalibration[ft_sensor_numeric_id].rezeroSamplesRequested > 0;
+    ftCalibrationMutex.unlock();
+    return pending;
+}
+
+bool yarpWholeBodySensors::getFTsensorOffset(const int ft_sensor_numeric_id, double * offset)
+{
+    ftCalibrationMutex.lock();
+    if( ft_sensor_numeric_id < 0 || ft_sensor_numeric_id >= (int)ftCalibration.size() )
+    {
+        ftCalibrationMutex.unlock();
+        return false;
+    }
+    memcpy(offset, ftCalibration[ft_sensor_numeric_id].offset, 6*sizeof(double));
+    ftCalibrationMutex.unlock();
+    return true;
 }
 
 const IDList& yarpWholeBodySensors::getSensorList(const SensorType st)
@@ -369,144 +579,822 @@ int yarpWholeBodySensors::getSensorNumber(const SensorType st)
 
 bool yarpWholeBodySensors::readSensor(const SensorType st, const int sid, double *data, double *stamps, bool blocking)
 {
+    //When the log is open the timestamps are always read, to be recorded
+    //(pwm readings do not support timestamps, the logging time is recorded instead)
+    double * readStamps = stamps;
+    if( sensorsLog != 0 && stamps == 0 && st != SENSOR_PWM )
+    {
+        readStamps = logStamps.data();
+    }
+
+    bool ret = false;
     switch(st)
     {
-    case SENSOR_ENCODER_POS:           return readEncoder(ENCODER_POS, sid, data, stamps, blocking);
-    case SENSOR_ENCODER_SPEED:         return readEncoder(ENCODER_SPEED, sid, data, stamps, blocking);
-    case SENSOR_ENCODER_ACCELERATION:  return readEncoder(ENCODER_ACCELERATION, sid, data, stamps, blocking);
-    case SENSOR_PWM:            return readPwm(sid, data, stamps, blocking);
-    case SENSOR_IMU:            return readIMU(sid, data, stamps, blocking);
-    case SENSOR_FORCE_TORQUE:   return readFTsensor(sid, data, stamps, blocking);
-    case SENSOR_TORQUE:         return readTorqueSensor(sid, data, stamps, blocking);
-    case SENSOR_ACCELEROMETER:  return readAccelerometer(sid, data, stamps, blocking);
+    case SENSOR_ENCODER_POS:           ret = readEncoder(ENCODER_POS, sid, data, readStamps, blocking); break;
+    case SENSOR_ENCODER_SPEED:         ret = readEncoder(ENCODER_SPEED, sid, data, readStamps, blocking); break;
+    case SENSOR_ENCODER_ACCELERATION:  ret = readEncoder(ENCODER_ACCELERATION, sid, data, readStamps, blocking); break;
+    case SENSOR_PWM:            ret = readPwm(sid, data, readStamps, blocking); break;
+    case SENSOR_IMU:            ret = readIMU(sid, data, readStamps, blocking); break;
+    case SENSOR_FORCE_TORQUE:   ret = readFTsensor(sid, data, readStamps, blocking); break;
+    case SENSOR_TORQUE:         ret = readTorqueSensor(sid, data, readStamps, blocking); break;
+    case SENSOR_ACCELEROMETER:  ret = readAccelerometer(sid, data, readStamps, blocking); break;
     default: break;
     }
-    return false;
+
+    //FT readings are logged by readFTsensor, before the calibration
+    if( ret && sensorsLog != 0 && st != SENSOR_FORCE_TORQUE )
+    {
+        sensorsLog->logSensor(st, sid, data, readStamps);
+    }
+
+    return ret;
 }
 
 bool yarpWholeBodySensors::readSensors(const SensorType st, double *data, double *stamps, bool blocking)
 {
+    //When the log is open the timestamps are always read, to be recorded
+    //(pwm readings do not support timestamps, the logging time is recorded instead)
+    double * readStamps = stamps;
+    if( sensorsLog != 0 && stamps == 0 && st != SENSOR_PWM )
+    {
+        readStamps = logStamps.data();
+    }
+
+    bool ret = false;
     switch(st)
     {
-    case SENSOR_ENCODER_POS:           return readEncoders(ENCODER_POS, data, stamps, blocking);
-    case SENSOR_ENCODER_SPEED:         return readEncoders(ENCODER_SPEED, data, stamps, blocking);
-    case SENSOR_ENCODER_ACCELERATION:  return readEncoders(ENCODER_ACCELERATION, data, stamps, blocking);
-    case SENSOR_PWM:            return readPwms(data, stamps, blocking);
-    case SENSOR_IMU:            return readIMUs(data, stamps, blocking);
-    case SENSOR_FORCE_TORQUE:   return readFTsensors(data, stamps, blocking);
-    case SENSOR_TORQUE:         return readTorqueSensors(data, stamps, blocking);
-    case SENSOR_ACCELEROMETER:  return readAccelerometers(data, stamps, blocking);
+    case SENSOR_ENCODER_POS:           ret = readEncoders(ENCODER_POS, data, readStamps, blocking); break;
+    case SENSOR_ENCODER_SPEED:         ret = readEncoders(ENCODER_SPEED, data, readStamps, blocking); break;
+    case SENSOR_ENCODER_ACCELERATION:  ret = readEncoders(ENCODER_ACCELERATION, data, readStamps, blocking); break;
+    case SENSOR_PWM:            ret = readPwms(data, readStamps, blocking); break;
+    case SENSOR_IMU:            ret = readIMUs(data, readStamps, blocking); break;
+    case SENSOR_FORCE_TORQUE:   ret = readFTsensors(data, readStamps, blocking); break;
+    case SENSOR_TORQUE:         ret = readTorqueSensors(data, readStamps, blocking); break;
+    case SENSOR_ACCELEROMETER:  ret = readAccelerometers(data, readStamps, blocking); break;
     default: break;
     }
-    return false;
+
+    //FT readings are logged by readFTsensors, before the calibration
+    if( ret && sensorsLog != 0 && st != SENSOR_FORCE_TORQUE )
+    {
+        sensorsLog->log(st, data, readStamps);
+    }
+
+    return ret;
 }
 
 /********************************************************************************************************************************************/
 /**************************************************** PRIVATE METHODS ***********************************************************************/
 /********************************************************************************************************************************************/
 
-bool yarpWholeBodySensors::openEncoder(const int bp)
+bool yarpWholeBodySensors::loadFTSensorCalibration(const ID & sid, FTSensorCalibration & calibration)
 {
-    // check whether the encoder interface is already open
-    if(ienc[bp]!=0) return true;
-    // check whether the poly driver is already open (here I assume the elements of dd are initialized to 0)
-    if(dd[bp]==0 && !openPolyDriver(name, robot, dd[bp], controlBoardNames[bp])) return false;
-    // open the encoder interface
-    if(!dd[bp]->view(ienc[bp]))
+    //Default: no calibration (zero offset, identity matrix)
+    calibration.enabled = false;
+    std::fill(calibration.offset, calibration.offset+6, 0.0);
+    std::fill(calibration.matrix, calibration.matrix+36, 0.0);
+    for(int i=0; i < 6; i++ ) calibration.matrix[i*6+i] = 1.0;
+    calibration.rezeroSamplesRequested = 0;
+    calibration.rezeroSamplesCollected = 0;
+    std::fill(calibration.rezeroSum, calibration.rezeroSum+6, 0.0);
+
+    yarp::os::Bottle & calibration_group = wbi_yarp_properties.findGroup("WBI_YARP_FT_CALIBRATION");
+    if( calibration_group.isNull() )
     {
-        fprintf(stderr, "Problem initializing drivers of %s\n", controlBoardNames[bp].c_str());
-        return false;
+        return true;
+    }
+    yarp::os::Bottle & sensor_calibration = calibration_group.findGroup(sid.toString());
+    if( sensor_calibration.isNull() )
+    {
+        return true;
     }
-    ///< store the number of joints in this body part
-    int nj=0;
-    ienc[bp]->getAxes(&nj);
-    controlBoardAxes[bp] = nj;
 
-    //allocate lastRead variables
-    qLastRead[bp].resize(nj);
-    qStampLastRead[bp].resize(nj);
-    pwmLastRead[bp].resize(nj);
-    torqueSensorsLastRead[bp].resize(nj);
+    yarp::os::Bottle & offset = sensor_calibration.findGroup("offset");
+    if( !offset.isNull() )
+    {
+        if( offset.size() != 7 )
+        {
+            yError() << "yarpWholeBodySensors: the offset of FT sensor " << sid.toString() << " must have 6 elements";
+            return false;
+        }
+        for(int i=0; i < 6; i++ ) calibration.offset[i] = offset.get(i+1).asDouble();
+    }
 
+    yarp::os::Bottle & matrix = sensor_calibration.findGroup("matrix");
+    if( !matrix.isNull() )
+    {
+        if( matrix.size() != 37 )
+        {
+            yError() << "yarpWholeBodySensors: the calibration matrix of FT sensor " << sid.toString() << " must have 36 elements";
+            return false;
+        }
+        for(int i=0; i < 36; i++ ) calibration.matrix[i] = matrix.get(i+1).asDouble();
+    }
+
+    calibration.enabled = true;
+    yInfo() << "yarpWholeBodySensors: calibration found for FT sensor " << sid.toString();
     return true;
 }
 
-bool yarpWholeBodySensors::openPwm(const int bp)
+void yarpWholeBodySensors::calibrateFTsensor(const int ft_sensor_numeric_id, double * wrench, bool newSample)
 {
-    ///< check whether the motor PWM interface is already open
-    if(iopl[bp]!=0)             return true;
+    FTSensorCalibration & calibration = ftCalibration[ft_sensor_numeric_id];
 
-    ///< if necessary open the poly driver
-    if(dd[bp]==0 && !openPolyDriver(name, robot, dd[bp], controlBoardNames[bp]))
+    //Re-zeroing: average the raw new samples
+    if( calibration.rezeroSamplesRequested > 0 && newSample )
     {
-        return false;
+        for(int i=0; i < 6; i++ ) calibration.rezeroSum[i] += wrench[i];
+        calibration.rezeroSamplesCollected++;
+        if( calibration.rezeroSamplesCollected >= calibration.rezeroSamplesRequested )
+        {
+            for(int i=0; i < 6; i++ ) calibration.offset[i] = calibration.rezeroSum[i]/calibration.rezeroSamplesCollected;
+            calibration.rezeroSamplesRequested = 0;
+            calibration.enabled = true;
+            yInfo() << "yarpWholeBodySensors: FT sensor " << ft_sensor_numeric_id << " re-zeroed over "
+                    << calibration.rezeroSamplesCollected << " samples";
+        }
     }
 
-    // Conditional definition of open loop for compatibility with both YARP master and devel:
-    // The iopl pointer is passed to the device driver that implements the interface. The view
-    // function is using a dynamic cast which doesn't work properly on a (void*), so we use a
-    // proper type here (IPWMControl*) or (IOpenLoopControl*).
-#ifndef YARPWBI_YARP_HAS_LEGACY_IOPENLOOP
-    IPWMControl * typed_iopl = 0;
-#else
-    IOpenLoopControl * typed_iopl = 0;
-#endif
-
-    if(!dd[bp]->view(typed_iopl))
+    if( !calibration.enabled )
     {
-        fprintf(stderr, "Problem initializing drivers of %s\n", controlBoardNames[bp].c_str());
-        return false;
+        return;
     }
-    iopl[bp] = typed_iopl; // copy to iopl which is a (void*)
 
-    //allocate lastRead variables
-    qLastRead[bp].resize(controlBoardAxes[bp]);
-    qStampLastRead[bp].resize(controlBoardAxes[bp]);
-    pwmLastRead[bp].resize(controlBoardAxes[bp]);
-    torqueSensorsLastRead[bp].resize(controlBoardAxes[bp]);
+    Eigen::Map< Eigen::Matrix<double,6,1> > w(wrench);
+    Eigen::Map< const Eigen::Matrix<double,6,1> > offset(calibration.offset);
+    Eigen::Map< const Eigen::Matrix<double,6,6,Eigen::RowMajor> > matrix(calibration.matrix);
+    Eigen::Matrix<double,6,1> unbiased = w - offset;
+    w.noalias() = matrix*unbiased;
+}
 
-    return true;
+void yarpWholeBodySensors::lockSensorTables()
+{
+    if( sensorTablesLock != 0 ) sensorTablesLock->wait();
 }
 
-bool yarpWholeBodySensors::loadAccelerometerInfoFromConfig(const Searchable& opts, const IDList& list, vector< AccelerometerConfigurationInfo >& infos)
+void yarpWholeBodySensors::unlockSensorTables()
 {
-    std::string accelerometers_info_group_name = "WBI_YARP_ACCELEROMETERS";
-    yarp::os::Bottle info_lists = wbi_yarp_properties.findGroup(accelerometers_info_group_name);
-    if( info_lists.isNull() || info_lists.size() == 0 ) {
-        if( list.size() == 0 )
-        {
-            infos.resize(0);
-            return true;
-        }
-        else
-        {
-            std::cout << "[ERR] yarpWbi::loadAccelerometerInfoFromConfig error: group "
-                      << accelerometers_info_group_name << " not found in yarpWholeBodyInterface configuration file."  << std::endl;
+    if( sensorTablesLock != 0 ) sensorTablesLock->post();
+}
+
+bool yarpWholeBodySensors::addSensorAfterInit(const SensorType st, const ID & sid)
+{
+    int index;
+    if( st < 0 || st >= wbi::SENSOR_TYPE_SIZE || sensorIdList[st].idToIndex(sid,index) )
+    {
+        return false;
+    }
+
+    switch(st)
+    {
+        case SENSOR_FORCE_TORQUE:
+        case SENSOR_IMU:
+            return addPortSensorAfterInit(st, sid);
+        case SENSOR_ENCODER_POS:
+        case SENSOR_ENCODER_SPEED:
+        case SENSOR_ENCODER_ACCELERATION:
+        case SENSOR_PWM:
+        case SENSOR_TORQUE:
+            return addControlBoardSensorAfterInit(st, sid);
+        default:
+            yError() << "yarpWholeBodySensors: sensors of type " << st << " can not be added after init";
             return false;
-        }
     }
+}
 
-    infos.resize(list.size());
+bool yarpWholeBodySensors::removeSensorAfterInit(const SensorType st, const ID & sid)
+{
+    int index;
+    if( !sensorIdList[st].idToIndex(sid,index) )
+    {
+        return false;
+    }
 
-    for(int acc_index = 0; acc_index < (int)list.size(); acc_index++ )
+    switch(st)
     {
-        wbi::ID acc_ID;
-        list.indexToID(acc_index,acc_ID);
-        yarp::os::Bottle * port = info_lists.find(acc_ID.toString()).asList();
-        //std::cout << port->toString() << std::endl;
-        if( port == NULL
-            || port->size() != 2
-            || !(port->get(0).isString())
-            || !(port->get(1).isString()) )
-        {
-            std::cout << "yarpWbi::loadAccelerometerInfoFromConfig error: " << info_lists.toString() << " has a malformed element" << std::endl;
+        case SENSOR_FORCE_TORQUE:
+        case SENSOR_IMU:
+            return removePortSensorAfterInit(st, sid, index);
+        case SENSOR_ENCODER_POS:
+        case SENSOR_ENCODER_SPEED:
+        case SENSOR_ENCODER_ACCELERATION:
+        case SENSOR_PWM:
+        case SENSOR_TORQUE:
+            return removeControlBoardSensorAfterInit(st, sid);
+        default:
+            yError() << "yarpWholeBodySensors: sensors of type " << st << " can not be removed after init";
             return false;
-        }
-        std::string accelerometer_type = port->get(0).asString();
-        std::string accelerometer_type_option = port->get(1).asString();
-        if( accelerometer_type == "imu" )
-        {
-            infos[acc_index].type = IMU_STYLE;
+    }
+}
+
+bool yarpWholeBodySensors::addPortSensorAfterInit(const SensorType st, const ID & sid)
+{
+    bool isFT = (st == SENSOR_FORCE_TORQUE);
+
+    //Load the port of the new sensor
+    wbi::IDList newSensorList;
+    newSensorList.addID(sid);
+    std::vector<std::string> ports, carriers;
+    if( !loadSensorPortsFromConfig(wbi_yarp_properties, newSensorList, ports, carriers, isFT ? "WBI_YARP_FT_PORTS" : "WBI_YARP_IMU_PORTS")
+        || ports.size() != 1 )
+    {
+        yError() << "yarpWholeBodySensors: port of sensor " << sid.toString() << " not found";
+        return false;
+    }
+
+    //Open the port without touching the tables, as the sensors can be read meanwhile
+    BufferedPort<Vector> * port = 0;
+    Vector lastRead;
+    double lastStamp;
+    std::string localPort = "/" + name + (isFT ? "/ftSens/" : "/imu/") + sid.toString() + ":i";
+    if( !openSensorPort(localPort, ports[0], carriers[0], sensorTypeDescriptions[st].dataSize, port, lastRead, lastStamp) )
+    {
+        return false;
+    }
+    FTSensorCalibration calibration;
+    if( isFT && !loadFTSensorCalibration(sid, calibration) )
+    {
+        port->close();
+        delete port;
+        return false;
+    }
+    int telemetrySource = (telemetry != 0) ? telemetry->addSource(sid.toString()) : -1;
+
+    //Swap in the new tables
+    lockSensorTables();
+    closeSensorsLogOnSensorChange();
+    sensorTablesGeneration++;
+    sensorIdList[st].addID(sid);
+    if( isFT )
+    {
+        portsFTsens.push_back(port);
+        ftSensLastRead.push_back(lastRead);
+        ftStampSensLastRead.push_back(lastStamp);
+        ftLastSequence.push_back(-1);
+        ftTelemetrySources.push_back(telemetrySource);
+        ftCalibrationMutex.lock();
+        ftCalibration.push_back(calibration);
+        ftCalibrationMutex.unlock();
+    }
+    else
+    {
+        portsIMU.push_back(port);
+        imuLastRead.push_back(lastRead);
+        imuStampLastRead.push_back(lastStamp);
+        imuLastSequence.push_back(-1);
+        imuTelemetrySources.push_back(telemetrySource);
+    }
+    unlockSensorTables();
+
+    yInfo() << "yarpWholeBodySensors: added sensor " << sid.toString();
+    return true;
+}
+
+bool yarpWholeBodySensors::removePortSensorAfterInit(const SensorType st, const ID & sid, const int index)
+{
+    bool isFT = (st == SENSOR_FORCE_TORQUE);
+
+    if( !isFT )
+    {
+        for(int acc=0; acc < (int)accelerometersReferenceIndeces.size(); acc++ )
+        {
+            if( accelerometersReferenceIndeces[acc].type == IMU_STYLE
+                && accelerometersReferenceIndeces[acc].type_reference_index == index )
+            {
+                yError() << "yarpWholeBodySensors: IMU " << sid.toString() << " can not be removed, it is used by an accelerometer";
+                return false;
+            }
+        }
+    }
+
+    //Swap in the new tables
+    BufferedPort<Vector> * port = 0;
+    lockSensorTables();
+    closeSensorsLogOnSensorChange();
+    sensorTablesGeneration++;
+    sensorIdList[st].removeID(sid);
+    if( isFT )
+    {
+        port = portsFTsens[index];
+        portsFTsens.erase(portsFTsens.begin()+index);
+        ftSensLastRead.erase(ftSensLastRead.begin()+index);
+        ftStampSensLastRead.erase(ftStampSensLastRead.begin()+index);
+        ftLastSequence.erase(ftLastSequence.begin()+index);
+        ftTelemetrySources.erase(ftTelemetrySources.begin()+index);
+        ftCalibrationMutex.lock();
+        ftCalibration.erase(ftCalibration.begin()+index);
+        ftCalibrationMutex.unlock();
+    }
+    else
+    {
+        port = portsIMU[index];
+        portsIMU.erase(portsIMU.begin()+index);
+        imuLastRead.erase(imuLastRead.begin()+index);
+        imuStampLastRead.erase(imuStampLastRead.begin()+index);
+        imuLastSequence.erase(imuLastSequence.begin()+index);
+        imuTelemetrySources.erase(imuTelemetrySources.begin()+index);
+        for(int acc=0; acc < (int)accelerometersReferenceIndeces.size(); acc++ )
+        {
+            if( accelerometersReferenceIndeces[acc].type == IMU_STYLE
+                && accelerometersReferenceIndeces[acc].type_reference_index > index )
+            {
+                accelerometersReferenceIndeces[acc].type_reference_index--;
+            }
+        }
+    }
+    unlockSensorTables();
+
+    //Close the port once it can not be read anymore
+    if( port != 0 )
+    {
+        port->close();
+        delete port;
+    }
+
+    yInfo() << "yarpWholeBodySensors: removed sensor " << sid.toString();
+    return true;
+}
+
+bool yarpWholeBodySensors::addControlBoardSensorAfterInit(const SensorType st, const ID & sid)
+{
+    if( useControlBoardRemapper )
+    {
+        yError() << "yarpWholeBodySensors: controlboard sensors can not be added after init with the remapper backend";
+        return false;
+    }
+
+    //Find the controlboard of the new sensor
+    yarp::os::Bottle & joints_config = getWBIYarpJointsOptions(wbi_yarp_properties);
+    wbi::IDList newSensorList;
+    newSensorList.addID(sid);
+    std::vector<std::string> newControlBoardNames = controlBoardNames;
+    std::vector< std::pair<int,int> > newSensorAxis;
+    if( !appendNewControlBoardsToVector(joints_config, newSensorList, newControlBoardNames)
+        || !getControlBoardAxisList(joints_config, newSensorList, newControlBoardNames, newSensorAxis) )
+    {
+        return false;
+    }
+    int ctrlBoard = newSensorAxis[0].first;
+    bool newControlBoard = ctrlBoard >= (int)controlBoardNames.size();
+
+    //Open the driver of the controlboard (if it is not already open) without touching the tables,
+    //as the sensors can be read meanwhile
+    PolyDriver * newDriver = 0;
+    if( newControlBoard || dd[ctrlBoard] == 0 )
+    {
+        if( !openPolyDriver(name, robot, newDriver, newControlBoardNames[ctrlBoard]) )
+        {
+            return false;
+        }
+    }
+
+    //View the interfaces of the sensor and read the number of axes of the controlboard (an RPC to the robot)
+    //before taking the lock as well, so that the readings are not blocked by the driver
+    PolyDriver * driver = (newDriver != 0) ? newDriver : dd[ctrlBoard];
+    IEncodersTimed * newIenc = 0;
+    void * newIopl = 0;
+    ITorqueControl * newItrq = 0;
+    IPreciselyTimed * newItrqTimed = 0;
+    int nj = newControlBoard ? 0 : (int)controlBoardAxes[ctrlBoard];
+    bool ok = true;
+    switch(st)
+    {
+        case SENSOR_PWM:
+            if( newControlBoard || iopl[ctrlBoard] == 0 )
+            {
+#ifndef YARPWBI_YARP_HAS_LEGACY_IOPENLOOP
+                IPWMControl * typed_iopl = 0;
+#else
+                IOpenLoopControl * typed_iopl = 0;
+#endif
+                ok = driver->view(typed_iopl);
+                newIopl = typed_iopl;
+            }
+            break;
+        case SENSOR_TORQUE:
+            if( newControlBoard || itrq[ctrlBoard] == 0 )
+            {
+                ok = driver->view(newItrq);
+                ///< the acquisition time of joint torques is optional: if not available the reading time is used
+                if( ok && !driver->view(newItrqTimed) )
+                {
+                    newItrqTimed = 0;
+                    yWarning("yarpWholeBodySensors: acquisition time of joint torques of %s not available, using reading time", newControlBoardNames[ctrlBoard].c_str());
+                }
+            }
+            break;
+        default:
+            if( newControlBoard || ienc[ctrlBoard] == 0 )
+            {
+                ok = driver->view(newIenc);
+            }
+            break;
+    }
+    if( !ok )
+    {
+        yError("yarpWholeBodySensors: problem initializing drivers of %s", newControlBoardNames[ctrlBoard].c_str());
+    }
+    if( ok && nj == 0 )
+    {
+        IEncoders * axesInfo = 0;
+        if( !driver->view(axesInfo) || !axesInfo->getAxes(&nj) || nj <= 0 )
+        {
+            yError("yarpWholeBodySensors: impossible to get the number of axes of %s", newControlBoardNames[ctrlBoard].c_str());
+            ok = false;
+        }
+    }
+    if( !ok )
+    {
+        if( newDriver != 0 ) closePolyDriver(newDriver);
+        return false;
+    }
+    int telemetrySource = (telemetry != 0 && newControlBoard) ? telemetry->addSource(newControlBoardNames[ctrlBoard]) : -1;
+
+    //Swap in the new tables
+    std::vector<PolyDriver*> unusedDrivers;
+    lockSensorTables();
+    closeSensorsLogOnSensorChange();
+    sensorTablesGeneration++;
+    if( newControlBoard )
+    {
+        controlBoardNames.push_back(newControlBoardNames[ctrlBoard]);
+        controlBoardAxes.push_back(0);
+        controlBoardTelemetrySource.push_back(telemetrySource);
+        ienc.push_back(0);
+        iopl.push_back(0);
+        dd.push_back(0);
+        itrq.push_back(0);
+        itrqTimed.push_back(0);
+    }
+    if( newDriver != 0 )    dd[ctrlBoard] = newDriver;
+    if( newIenc != 0 )      ienc[ctrlBoard] = newIenc;
+    if( newIopl != 0 )      iopl[ctrlBoard] = newIopl;
+    if( newItrq != 0 )
+    {
+        itrq[ctrlBoard] = newItrq;
+        itrqTimed[ctrlBoard] = newItrqTimed;
+    }
+    controlBoardAxes[ctrlBoard] = nj;
+    sensorIdList[st].addID(sid);
+    ok = updateControlBoardTables(unusedDrivers);
+    unlockSensorTables();
+
+    //Close the drivers of the controlboards that are not used anymore, once they can not be read
+    for(int i=0; i < (int)unusedDrivers.size(); i++ )
+    {
+        closePolyDriver(unusedDrivers[i]);
+    }
+
+    if( ok ) yInfo() << "yarpWholeBodySensors: added sensor " << sid.toString();
+    return ok;
+}
+
+bool yarpWholeBodySensors::removeControlBoardSensorAfterInit(const SensorType st, const ID & sid)
+{
+    if( useControlBoardRemapper )
+    {
+        yError() << "yarpWholeBodySensors: controlboard sensors can not be removed after init with the remapper backend";
+        return false;
+    }
+
+    //Swap in the new tables
+    std::vector<PolyDriver*> unusedDrivers;
+    lockSensorTables();
+    closeSensorsLogOnSensorChange();
+    sensorTablesGeneration++;
+    sensorIdList[st].removeID(sid);
+    bool ok = updateControlBoardTables(unusedDrivers);
+    unlockSensorTables();
+
+    //Close the drivers of the controlboards that are not used anymore, once they can not be read
+    for(int i=0; i < (int)unusedDrivers.size(); i++ )
+    {
+        closePolyDriver(unusedDrivers[i]);
+    }
+
+    if( ok ) yInfo() << "yarpWholeBodySensors: removed sensor " << sid.toString();
+    return ok;
+}
+
+bool yarpWholeBodySensors::updateControlBoardTables(std::vector<PolyDriver*> & unusedDrivers)
+{
+    yarp::os::Bottle & joints_config = getWBIYarpJointsOptions(wbi_yarp_properties);
+    bool ok = getControlBoardAxisList(joints_config,sensorIdList[wbi::SENSOR_ENCODER_POS],controlBoardNames,encoderControlBoardAxisList);
+    ok = getControlBoardAxisList(joints_config,sensorIdList[wbi::SENSOR_PWM],controlBoardNames,pwmControlBoardAxisList) && ok;
+    ok = getControlBoardAxisList(joints_config,sensorIdList[wbi::SENSOR_TORQUE],controlBoardNames,torqueControlBoardAxisList) && ok;
+
+    encoderControlBoardList = getControlBoardList(encoderControlBoardAxisList);
+    pwmControlBoardList     = getControlBoardList(pwmControlBoardAxisList);
+    torqueControlBoardList  = getControlBoardList(torqueControlBoardAxisList);
+
+    //Detach the controlboards that are not used anymore by any sensor (their drivers are closed by the caller)
+    for(int ctrlBoard=0; ctrlBoard < (int)controlBoardNames.size(); ctrlBoard++ )
+    {
+        if( dd[ctrlBoard] == 0
+            || std::find(encoderControlBoardList.begin(),encoderControlBoardList.end(),ctrlBoard) != encoderControlBoardList.end()
+            || std::find(pwmControlBoardList.begin(),pwmControlBoardList.end(),ctrlBoard) != pwmControlBoardList.end()
+            || std::find(torqueControlBoardList.begin(),torqueControlBoardList.end(),ctrlBoard) != torqueControlBoardList.end() )
+        {
+            continue;
+        }
+        unusedDrivers.push_back(dd[ctrlBoard]);
+        dd[ctrlBoard] = 0;
+        ienc[ctrlBoard] = 0;
+        iopl[ctrlBoard] = 0;
+        itrq[ctrlBoard] = 0;
+        itrqTimed[ctrlBoard] = 0;
+        controlBoardAxes[ctrlBoard] = 0;
+    }
+
+    buildControlBoardArenas();
+
+    //The readings acquired before the change are in the old layout of the arenas
+    for(int type=0; type < CONTROLBOARD_READING_TYPE_SIZE; type++ )
+    {
+        controlBoardReadEpoch[type].assign(controlBoardNames.size(),0);
+    }
+
+    return ok;
+}
+
+void yarpWholeBodySensors::closeSensorsLogOnSensorChange()
+{
+    if( sensorsLog == 0 )
+    {
+        return;
+    }
+
+    //The layout of the records is fixed when the log is opened
+    yWarning() << "yarpWholeBodySensors: the set of sensors changed, closing the sensor log";
+    sensorsLog->close();
+    delete sensorsLog;
+    sensorsLog = 0;
+}
+
+bool yarpWholeBodySensors::openTelemetry()
+{
+    yarp::os::Bottle & sensors_options = wbi_yarp_properties.findGroup("WBI_SENSORS_OPTIONS");
+    if( !sensors_options.check("telemetry") )
+    {
+        return true;
+    }
+
+    //The telemetry sources are the controlboards, the FT sensors and the IMUs
+    telemetry = new yarpWholeBodySensorsTelemetry();
+    for(int ctrlBoard=0; ctrlBoard < (int)controlBoardNames.size(); ctrlBoard++ )
+    {
+        controlBoardTelemetrySource[ctrlBoard] = telemetry->addSource(controlBoardNames[ctrlBoard]);
+    }
+
+    for(int ft=0; ft < (int)sensorIdList[wbi::SENSOR_FORCE_TORQUE].size(); ft++ )
+    {
+        wbi::ID ftId;
+        sensorIdList[wbi::SENSOR_FORCE_TORQUE].indexToID(ft,ftId);
+        ftTelemetrySources[ft] = telemetry->addSource(ftId.toString());
+    }
+
+    for(int imu=0; imu < (int)sensorIdList[wbi::SENSOR_IMU].size(); imu++ )
+    {
+        wbi::ID imuId;
+        sensorIdList[wbi::SENSOR_IMU].indexToID(imu,imuId);
+        imuTelemetrySources[imu] = telemetry->addSource(imuId.toString());
+    }
+
+    if( sensors_options.check("telemetryPeriod") )
+    {
+        std::string portName = "/" + name + "/sensors/telemetry:o";
+        if( !telemetry->startPublishing(portName, sensors_options.find("telemetryPeriod").asInt()) )
+        {
+            return false;
+        }
+        yInfo() << "yarpWholeBodySensors : publishing sensor telemetry on " << portName;
+    }
+
+    return true;
+}
+
+yarpWholeBodySensorsTelemetry * yarpWholeBodySensors::getTelemetry()
+{
+    return telemetry;
+}
+
+bool yarpWholeBodySensors::openSensorsLog()
+{
+    yarp::os::Bottle & sensors_options = wbi_yarp_properties.findGroup("WBI_SENSORS_OPTIONS");
+    if( !sensors_options.check("logFile") )
+    {
+        return true;
+    }
+
+    std::string logFile = sensors_options.find("logFile").asString().c_str();
+    int logFileSizeInMB = sensors_options.check("logFileSize") ? sensors_options.find("logFileSize").asInt() : 256;
+    int logFlushPeriod  = sensors_options.check("logFlushPeriod") ? sensors_options.find("logFlushPeriod").asInt() : 100;
+
+    unsigned int maxNrOfSensors = 0;
+    for(int st=0; st < wbi::SENSOR_TYPE_SIZE; st++ )
+    {
+        maxNrOfSensors = std::max(maxNrOfSensors,(unsigned int)sensorIdList[st].size());
+    }
+    logStamps.resize(maxNrOfSensors,0.0);
+
+    sensorsLog = new yarpWholeBodySensorsLog();
+    if( !sensorsLog->open(logFile, ((uint64_t)logFileSizeInMB)*1024*1024, sensorIdList, logFlushPeriod) )
+    {
+        yError() << "yarpWholeBodySensors : impossible to open sensor log " << logFile;
+        delete sensorsLog;
+        sensorsLog = 0;
+        return false;
+    }
+
+    yInfo() << "yarpWholeBodySensors : recording sensor readings in " << logFile;
+    return true;
+}
+
+bool yarpWholeBodySensors::openControlBoardDriver(const int bp)
+{
+    if( !useControlBoardRemapper )
+    {
+        return openPolyDriver(name, robot, dd[bp], controlBoardNames[bp]);
+    }
+
+    std::vector<std::string> axesNames(remappedAxesList.size());
+    for(int axis=0; axis < (int)remappedAxesList.size(); axis++ )
+    {
+        wbi::ID axisName;
+        remappedAxesList.indexToID(axis,axisName);
+        axesNames[axis] = axisName.toString();
+    }
+    return openRemapperPolyDriver(name, robot, dd[bp], axesNames, remappedControlBoardNames);
+}
+
+bool yarpWholeBodySensors::openEncoder(const int bp)
+{
+    // check whether the encoder interface is already open
+    if(ienc[bp]!=0) return true;
+    // check whether the poly driver is already open (here I assume the elements of dd are initialized to 0)
+    if(dd[bp]==0 && !openControlBoardDriver(bp)) return false;
+    // open the encoder interface
+    if(!dd[bp]->view(ienc[bp]))
+    {
+        fprintf(stderr, "Problem initializing drivers of %s\n", controlBoardNames[bp].c_str());
+        return false;
+    }
+    ///< store the number of joints in this body part
+    return readControlBoardAxes(bp);
+}
+
+bool yarpWholeBodySensors::readControlBoardAxes(const int bp)
+{
+    if( controlBoardAxes[bp] != 0 ) return true;
+
+    IEncoders * axesInfo = 0;
+    int nj=0;
+    if( dd[bp] == 0 || !dd[bp]->view(axesInfo) || !axesInfo->getAxes(&nj) )
+    {
+        yError("yarpWholeBodySensors: impossible to get the number of axes of %s", controlBoardNames[bp].c_str());
+        return false;
+    }
+    controlBoardAxes[bp] = nj;
+    return true;
+}
+
+void yarpWholeBodySensors::buildControlBoardArenas()
+{
+    //Compute the offset of each controlboard in the arenas
+    int nrOfControlBoards = controlBoardNames.size();
+    controlBoardArenaOffset.resize(nrOfControlBoards);
+    int arenaSize = 0;
+    for(int ctrlBoard=0; ctrlBoard < nrOfControlBoards; ctrlBoard++ )
+    {
+        controlBoardArenaOffset[ctrlBoard] = arenaSize;
+        arenaSize += controlBoardAxes[ctrlBoard];
+    }
+
+    qArena.resize(arenaSize,0.0);
+    dqArena.resize(arenaSize,0.0);
+    d2qArena.resize(arenaSize,0.0);
+    qStampArena.resize(arenaSize,INITIAL_TIMESTAMP);
+    pwmArena.resize(arenaSize,0.0);
+    torqueArena.resize(arenaSize,0.0);
+    torqueStampArena.resize(arenaSize,INITIAL_TIMESTAMP);
+
+    //Allocate the scratch buffers of the acquisitions (same layout of the arenas)
+    readScratchArena.resize(CONTROLBOARD_READING_TYPE_SIZE);
+    readScratchStampArena.resize(CONTROLBOARD_READING_TYPE_SIZE);
+    for(int type=0; type < CONTROLBOARD_READING_TYPE_SIZE; type++ )
+    {
+        readScratchArena[type].resize(arenaSize,0.0);
+        readScratchStampArena[type].resize(arenaSize,INITIAL_TIMESTAMP);
+    }
+
+    //Allocate the timestamp alignment buffers
+    if( timestampAlignment != TIMESTAMP_ALIGNMENT_NONE )
+    {
+        alignmentHistoryData.resize(CONTROLBOARD_READING_TYPE_SIZE);
+        alignmentHistoryTime.resize(CONTROLBOARD_READING_TYPE_SIZE);
+        alignmentHistoryHead.resize(CONTROLBOARD_READING_TYPE_SIZE);
+        alignmentHistoryCount.resize(CONTROLBOARD_READING_TYPE_SIZE);
+        alignedArena.resize(CONTROLBOARD_READING_TYPE_SIZE);
+        for(int type=0; type < CONTROLBOARD_READING_TYPE_SIZE; type++ )
+        {
+            alignmentHistoryData[type].resize(alignmentHistoryLength*arenaSize,0.0);
+            alignmentHistoryTime[type].resize(alignmentHistoryLength*nrOfControlBoards,INITIAL_TIMESTAMP);
+            alignmentHistoryHead[type].assign(nrOfControlBoards,0);
+            alignmentHistoryCount[type].assign(nrOfControlBoards,0);
+            alignedArena[type].resize(arenaSize,0.0);
+        }
+    }
+
+    //Compute the flat gather indeces
+    encoderGatherIndex.resize(encoderControlBoardAxisList.size());
+    for(int i=0; i < (int)encoderControlBoardAxisList.size(); i++ )
+    {
+        encoderGatherIndex[i] = controlBoardArenaOffset[encoderControlBoardAxisList[i].first]+encoderControlBoardAxisList[i].second;
+    }
+
+    pwmGatherIndex.resize(pwmControlBoardAxisList.size());
+    for(int i=0; i < (int)pwmControlBoardAxisList.size(); i++ )
+    {
+        pwmGatherIndex[i] = controlBoardArenaOffset[pwmControlBoardAxisList[i].first]+pwmControlBoardAxisList[i].second;
+    }
+
+    torqueGatherIndex.resize(torqueControlBoardAxisList.size());
+    for(int i=0; i < (int)torqueControlBoardAxisList.size(); i++ )
+    {
+        torqueGatherIndex[i] = controlBoardArenaOffset[torqueControlBoardAxisList[i].first]+torqueControlBoardAxisList[i].second;
+    }
+}
+
+bool yarpWholeBodySensors::openPwm(const int bp)
+{
+    ///< check whether the motor PWM interface is already open
+    if(iopl[bp]!=0)             return true;
+
+    ///< if necessary open the poly driver
+    if(dd[bp]==0 && !openControlBoardDriver(bp))
+    {
+        return false;
+    }
+
+    // Conditional definition of open loop for compatibility with both YARP master and devel:
+    // The iopl pointer is passed to the device driver that implements the interface. The view
+    // function is using a dynamic cast which doesn't work properly on a (void*), so we use a
+    // proper type here (IPWMControl*) or (IOpenLoopControl*).
+#ifndef YARPWBI_YARP_HAS_LEGACY_IOPENLOOP
+    IPWMControl * typed_iopl = 0;
+#else
+    IOpenLoopControl * typed_iopl = 0;
+#endif
+
+    if(!dd[bp]->view(typed_iopl))
+    {
+        fprintf(stderr, "Problem initializing drivers of %s\n", controlBoardNames[bp].c_str());
+        return false;
+    }
+    iopl[bp] = typed_iopl; // copy to iopl which is a (void*)
+
+    return readControlBoardAxes(bp);
+}
+
+bool yarpWholeBodySensors::loadAccelerometerInfoFromConfig(const Searchable& opts, const IDList& list, vector< AccelerometerConfigurationInfo >& infos)
+{
+    std::string accelerometers_info_group_name = "WBI_YARP_ACCELEROMETERS";
+    yarp::os::Bottle info_lists = wbi_yarp_properties.findGroup(accelerometers_info_group_name);
+    if( info_lists.isNull() || info_lists.size() == 0 ) {
+        if( list.size() == 0 )
+        {
+            infos.resize(0);
+            return true;
+        }
+        else
+        {
+            std::cout << "[ERR] yarpWbi::loadAccelerometerInfoFromConfig error: group "
+                      << accelerometers_info_group_name << " not found in yarpWholeBodyInterface configuration file."  << std::endl;
+            return false;
+        }
+    }
+
+    infos.resize(list.size());
+
+    for(int acc_index = 0; acc_index < (int)list.size(); acc_index++ )
+    {
+        wbi::ID acc_ID;
+        list.indexToID(acc_index,acc_ID);
+        yarp::os::Bottle * port = info_lists.find(acc_ID.toString()).asList();
+        //std::cout << port->toString() << std::endl;
+        if( port == NULL
+            || port->size() != 2
+            || !(port->get(0).isString())
+            || !(port->get(1).isString()) )
+        {
+            std::cout << "yarpWbi::loadAccelerometerInfoFromConfig error: " << info_lists.toString() << " has a malformed element" << std::endl;
+            return false;
+        }
+        std::string accelerometer_type = port->get(0).asString();
+        std::string accelerometer_type_option = port->get(1).asString();
+        if( accelerometer_type == "imu" )
+        {
+            infos[acc_index].type = IMU_STYLE;
             infos[acc_index].type_option = accelerometer_type_option;
         }
         else
@@ -542,69 +1430,130 @@ bool yarpWholeBodySensors::openAccelerometer(const int acc_index, const Accelero
             ret = false;
             break;
     }
-    return ret;
+    return ret;
+}
+
+bool yarpWholeBodySensors::connectSensorPort(const std::string & remotePort, const std::string & localPort,
+                                             const std::string & carrier, std::string & effectiveCarrier)
+{
+    if( Network::connect(remotePort.c_str(), localPort.c_str(), carrier.c_str(), true) )
+    {
+        effectiveCarrier = carrier;
+        return true;
+    }
+
+    // the requested carrier may be unavailable (e.g. shmem between different hosts): fall back to udp
+    if( carrier != "udp" )
+    {
+        yWarning() << "yarpWholeBodySensors: could not connect " << remotePort << " to " << localPort
+                   << " with carrier " << carrier << ", falling back to udp";
+        if( Network::connect(remotePort.c_str(), localPort.c_str(), "udp", true) )
+        {
+            effectiveCarrier = "udp";
+            return true;
+        }
+    }
+
+    return false;
+}
+
+void yarpWholeBodySensors::reportSensorPortConnection(BufferedPort<Vector> * port, Vector & lastRead, double & lastStamp,
+                                                      const std::string & remotePort, const std::string & effectiveCarrier)
+{
+    // at init, optionally wait for the first sample to measure the latency of the stream
+    // (sensors added after init are never probed, not to block the caller)
+    double probeTimeout = initDone ? 0.0 : sensorPortProbeTimeout;
+    if( probeTimeout <= 0.0 )
+    {
+        yInfo() << "yarpWholeBodySensors: connected to " << remotePort << " with carrier " << effectiveCarrier;
+        return;
+    }
+
+    int lastSequence = -1;
+    double probeStart = Time::now();
+    bool received = false;
+    while( !received && Time::now()-probeStart < probeTimeout )
+    {
+        received = readSensorPort(port, lastRead, lastStamp, -1, lastSequence, false);
+        if( !received ) Time::delay(WAIT_TIME);
+    }
+
+    if( !received )
+    {
+        yInfo() << "yarpWholeBodySensors: connected to " << remotePort << " with carrier " << effectiveCarrier
+                << ", no sample received in " << probeTimeout << " s";
+    }
+    else if( lastStamp <= 0.0 )
+    {
+        yInfo() << "yarpWholeBodySensors: connected to " << remotePort << " with carrier " << effectiveCarrier
+                << ", latency not available (the stream is not timestamped)";
+    }
+    else
+    {
+        // the latency is measured against the clock of the publisher: it is meaningful only if the clocks are synchronized
+        yInfo() << "yarpWholeBodySensors: connected to " << remotePort << " with carrier " << effectiveCarrier
+                << ", latency " << 1e3*(Time::now()-lastStamp) << " ms";
+    }
 }
 
-bool yarpWholeBodySensors::openImu(const int numeric_id, const std::string & port_name)
+bool yarpWholeBodySensors::openSensorPort(const std::string & localPort, const std::string & port_name, const std::string & carrier,
+                                          const int dataSize, BufferedPort<Vector> * & port, Vector & lastRead, double & lastStamp)
 {
-    if( numeric_id < 0 || numeric_id >= (int)sensorIdList[SENSOR_IMU].size() )
-    {
-        return false;
-    }
-
     string remotePort = "/" + robot + port_name;
-    stringstream localPort;
-    wbi::ID wbi_id;
-    sensorIdList[SENSOR_IMU].indexToID(numeric_id,wbi_id);
-    localPort << "/" << name << "/imu/" <<  wbi_id.toString() << ":i";
-    portsIMU[numeric_id] = new BufferedPort<Vector>();
-    if(!portsIMU[numeric_id]->open(localPort.str().c_str())) { // open local input port
-        std::cerr << "yarpWholeBodySensors::openImu(): Open of localPort " << localPort.str() << " failed " << std::endl;
-        return false;
+    port = new BufferedPort<Vector>();
+    bool ok = true;
+    string effectiveCarrier;
+    if(!port->open(localPort.c_str())) { // open local input port
+        std::cerr << "yarpWholeBodySensors::openSensorPort(): Open of localPort " << localPort << " failed " << std::endl;
+        ok = false;
     }
-    if(!Network::exists(remotePort.c_str())) {       // check remote output port exists
-        std::cerr << "yarpWholeBodySensors::openImu():  " << remotePort << " does not exist " << std::endl;
-        return false;
+    else if(!Network::exists(remotePort.c_str())) {       // check remote output port exists
+        std::cerr << "yarpWholeBodySensors::openSensorPort():  " << remotePort << " does not exist " << std::endl;
+        ok = false;
+    }
+    else if(!connectSensorPort(remotePort, localPort, carrier, effectiveCarrier)) {  // connect remote to local port
+        std::cerr << "yarpWholeBodySensors::openSensorPort():  could not connect " << remotePort << " to " << localPort << std::endl;
+        ok = false;
     }
-    if(!Network::connect(remotePort.c_str(), localPort.str().c_str(), "udp", true)) {  // connect remote to local port
-        std::cerr << "yarpWholeBodySensors::openImu():  could not connect " << remotePort << " to " << localPort.str() << std::endl;
+
+    if( !ok )
+    {
+        port->close();
+        delete port;
+        port = 0;
         return false;
     }
 
     //allocate lastRead variables
-    imuLastRead[numeric_id].resize(sensorTypeDescriptions[SENSOR_IMU].dataSize,0.0);
-    imuStampLastRead[numeric_id] = INITIAL_TIMESTAMP;
+    lastRead.resize(dataSize,0.0);
+    lastStamp = INITIAL_TIMESTAMP;
+
+    reportSensorPortConnection(port, lastRead, lastStamp, remotePort, effectiveCarrier);
 
     return true;
 }
 
-bool yarpWholeBodySensors::openFTsens(const int ft_sens_numeric_id, const std::string & port_name)
+bool yarpWholeBodySensors::openImu(const int numeric_id, const std::string & port_name, const std::string & carrier)
 {
-    string remotePort = "/" + robot + port_name;
-    stringstream localPort;
-    wbi::ID wbi_id;
-    sensorIdList[SENSOR_FORCE_TORQUE].indexToID(ft_sens_numeric_id,wbi_id);
-    localPort << "/" << name << "/ftSens/" << wbi_id.toString() << ":i";
-    portsFTsens[ft_sens_numeric_id] = new BufferedPort<Vector>();
-    if(!portsFTsens[ft_sens_numeric_id]->open(localPort.str().c_str())) {
-        // open local input port
-        std::cerr << "yarpWholeBodySensors::openFTsens(): Open of localPort " << localPort.str() << " failed " << std::endl;
-        return false;
-    }
-    if(!Network::exists(remotePort.c_str())) {            // check remote output port exists
-        std::cerr << "yarpWholeBodySensors::openFTsens():  " << remotePort << " does not exist " << std::endl;
-        return false;
-    }
-    if(!Network::connect(remotePort.c_str(), localPort.str().c_str(), "udp")) {  // connect remote to local port
-        std::cerr << "yarpWholeBodySensors::openFTsens():  could not connect " << remotePort << " to " << localPort.str() << std::endl;
+    if( numeric_id < 0 || numeric_id >= (int)sensorIdList[SENSOR_IMU].size() )
+    {
         return false;
     }
 
-    //allocate lastRead variables
-    ftSensLastRead[ft_sens_numeric_id].resize(sensorTypeDescriptions[SENSOR_FORCE_TORQUE].dataSize,0.0);
-    ftStampSensLastRead[ft_sens_numeric_id] = INITIAL_TIMESTAMP;
+    wbi::ID wbi_id;
+    sensorIdList[SENSOR_IMU].indexToID(numeric_id,wbi_id);
+    string localPort = "/" + name + "/imu/" + wbi_id.toString() + ":i";
+    return openSensorPort(localPort, port_name, carrier, sensorTypeDescriptions[SENSOR_IMU].dataSize,
+                          portsIMU[numeric_id], imuLastRead[numeric_id], imuStampLastRead[numeric_id]);
+}
 
-    return true;
+bool yarpWholeBodySensors::openFTsens(const int ft_sens_numeric_id, const std::string & port_name, const std::string & carrier)
+{
+    wbi::ID wbi_id;
+    sensorIdList[SENSOR_FORCE_TORQUE].indexToID(ft_sens_numeric_id,wbi_id);
+    string localPort = "/" + name + "/ftSens/" + wbi_id.toString() + ":i";
+    return openSensorPort(localPort, port_name, carrier, sensorTypeDescriptions[SENSOR_FORCE_TORQUE].dataSize,
+                          portsFTsens[ft_sens_numeric_id], ftSensLastRead[ft_sens_numeric_id], ftStampSensLastRead[ft_sens_numeric_id]);
 }
 
 bool yarpWholeBodySensors::openTorqueSensor(const int bp)
@@ -614,7 +1563,7 @@ bool yarpWholeBodySensors::openTorqueSensor(const int bp)
         return true;
 
     ///< if necessary open the poly driver
-    if(dd[bp]==0 && !openPolyDriver(name, robot, dd[bp], controlBoardNames[bp]))
+    if(dd[bp]==0 && !openControlBoardDriver(bp))
         return false;
 
     if(!dd[bp]->view(itrq[bp]))
@@ -623,13 +1572,14 @@ bool yarpWholeBodySensors::openTorqueSensor(const int bp)
         return false;
     }
 
-    //allocate lastRead variables
-    qLastRead[bp].resize(controlBoardAxes[bp]);
-    qStampLastRead[bp].resize(controlBoardAxes[bp]);
-    pwmLastRead[bp].resize(controlBoardAxes[bp]);
-    torqueSensorsLastRead[bp].resize(controlBoardAxes[bp]);
+    ///< the acquisition time of joint torques is optional: if not available the reading time is used
+    if(!dd[bp]->view(itrqTimed[bp]))
+    {
+        itrqTimed[bp] = 0;
+        yWarning("yarpWholeBodySensors: acquisition time of joint torques of %s not available, using reading time", controlBoardNames[bp].c_str());
+    }
 
-    return true;
+    return readControlBoardAxes(bp);
 }
 
 /**************************** READ ************************/
@@ -646,58 +1596,312 @@ bool yarpWholeBodySensors::getEncodersPosSpeedAccTimed(const EncoderType st, yar
     }
 }
 
-bool yarpWholeBodySensors::readEncoders(const EncoderType st, double *data, double *stamps, bool wait)
+bool yarpWholeBodySensors::readControlBoard(const ControlBoardReadingType type, const int ctrlBoard, bool wait)
 {
-    //std::cout << "|||||||||| Read encoders " << std::endl;
-    double dataTemp[MAX_NJ], tTemp[MAX_NJ];
-    bool res = true, update=false;
+    // if the controlboard has already been read in this epoch, serve the cached data
+    // (epoch 0: nobody is advancing the epochs, so every read is a new acquisition)
+    readEpochMutex.lock();
+    unsigned long epoch = readEpoch;
+    readEpochMutex.unlock();
+    if( readCacheEnabled && epoch != 0 && controlBoardReadEpoch[type][ctrlBoard] == epoch )
+    {
+        return true;
+    }
 
-     //Read data from all controlboards
-    for(std::vector<int>::const_iterator ctrlBoard = encoderControlBoardList.begin();
-        ctrlBoard != encoderControlBoardList.end(); ctrlBoard++ )
+    // the readings are acquired in a scratch buffer and published in the arenas only when successful,
+    // so a failed or partial acquisition never overwrites the last good sample
+    int offset = controlBoardArenaOffset[ctrlBoard];
+    double * scratch = readScratchArena[type].data()+offset;
+    double * scratchStamps = readScratchStampArena[type].data()+offset;
+    bool update=false;
+    double waiting_time = 0;
+
+    // stamp of the previous sample, to detect stale readings
+    double readStart = 0.0, previousStamp = 0.0;
+    if( telemetry != 0 && controlBoardAxes[ctrlBoard] > 0 )
+    {
+        readStart = Time::now();
+        previousStamp = (type == CONTROLBOARD_READING_TORQUE) ? torqueStampArena[offset] : qStampArena[offset];
+    }
+    while( true )
+    {
+        switch(type)
+        {
+            case CONTROLBOARD_READING_ENCODER_POS:
+                update = getEncodersPosSpeedAccTimed(ENCODER_POS, ienc[ctrlBoard], scratch, scratchStamps);
+                break;
+            case CONTROLBOARD_READING_ENCODER_SPEED:
+                update = getEncodersPosSpeedAccTimed(ENCODER_SPEED, ienc[ctrlBoard], scratch, scratchStamps);
+                break;
+            case CONTROLBOARD_READING_ENCODER_ACCELERATION:
+                update = getEncodersPosSpeedAccTimed(ENCODER_ACCELERATION, ienc[ctrlBoard], scratch, scratchStamps);
+                break;
+            case CONTROLBOARD_READING_PWM:
+#ifndef YARPWBI_YARP_HAS_LEGACY_IOPENLOOP
+                update = ((IPWMControl*)iopl[ctrlBoard])->getDutyCycles(scratch);
+#else
+                update = ((IOpenLoopControl*)iopl[ctrlBoard])->getOutputs(scratch);
+#endif
+                break;
+            case CONTROLBOARD_READING_TORQUE:
+                update = itrq[ctrlBoard]->getTorques(scratch);
+                break;
+            default:
+                return false;
+        }
+
+        if( update || !wait )
+        {
+            break;
+        }
+
+        Time::delay(WAIT_TIME);
+        waiting_time += WAIT_TIME;
+
+        if( waiting_time > BLOCKING_SENSOR_TIMEOUT )
+        {
+            yError("yarpWholeBodySensors: reading of controlboard %s failed for timeout", controlBoardNames[ctrlBoard].c_str());
+            if( telemetry != 0 ) telemetry->recordTimeout(controlBoardTelemetrySource[ctrlBoard]);
+            return false;
+        }
+    }
+
+    if(update)
     {
-        // read data
-        // std::cout << "|||||||||| getEncodersTimed " << std::endl;
-        dataTemp[0] = -10.0;
-        dataTemp[1] = -10.0;
-        double waiting_time = 0;
-        while( !(update=getEncodersPosSpeedAccTimed(st, ienc[*ctrlBoard], dataTemp, tTemp)) && wait)
+        int nrOfAxes = controlBoardAxes[ctrlBoard];
+        memcpy(controlBoardArena(type).data()+offset, scratch, nrOfAxes*sizeof(double));
+        if( type != CONTROLBOARD_READING_PWM && type != CONTROLBOARD_READING_TORQUE )
         {
-            //std::cout << "waitign " << dataTemp[0] << " " << dataTemp[1] << std::endl;
-            Time::delay(WAIT_TIME);
-            waiting_time += WAIT_TIME;
+            memcpy(qStampArena.data()+offset, scratchStamps, nrOfAxes*sizeof(double));
+        }
 
-            if( waiting_time > BLOCKING_SENSOR_TIMEOUT )
+        if( type == CONTROLBOARD_READING_TORQUE )
+        {
+            // all the torques of a controlboard are acquired in the same packet
+            double stamp = 0.0;
+            if( itrqTimed[ctrlBoard] != 0 )
             {
-                yError("yarpWholeBodySensors::readEncoders failed for timeout");
-                return false;
+                stamp = itrqTimed[ctrlBoard]->getLastInputStamp().getTime();
+            }
+            if( stamp <= 0.0 )
+            {
+                stamp = Time::now();
+            }
+            for(int axis=0; axis < (int)controlBoardAxes[ctrlBoard]; axis++ )
+            {
+                torqueStampArena[offset+axis] = stamp;
             }
         }
 
-        // if reading has succeeded, update last read data
-        if(update)
+        if( telemetry != 0 && controlBoardAxes[ctrlBoard] > 0 )
         {
-            for(int axis=0; axis < (int)qLastRead[*ctrlBoard].size(); axis++ )
+            telemetry->recordRead(controlBoardTelemetrySource[ctrlBoard], Time::now()-readStart);
+            // speed and acceleration share the stamps of the positions, so only positions and torques are checked
+            if( type == CONTROLBOARD_READING_ENCODER_POS || type == CONTROLBOARD_READING_TORQUE )
             {
-                //std::cout << "read dataTemp : " << dataTemp[axis] << std::endl;
-                qLastRead[*ctrlBoard][axis] = yarpWbi::Deg2Rad*dataTemp[axis];
-                qStampLastRead[*ctrlBoard][axis] = tTemp[axis];
+                double stamp = (type == CONTROLBOARD_READING_TORQUE) ? torqueStampArena[offset] : qStampArena[offset];
+                telemetry->recordSample(controlBoardTelemetrySource[ctrlBoard], stamp != previousStamp);
             }
         }
 
+        // pwm readings have no timestamps, so they are never aligned
+        if( timestampAlignment != TIMESTAMP_ALIGNMENT_NONE && type != CONTROLBOARD_READING_PWM && controlBoardAxes[ctrlBoard] > 0 )
+        {
+            double stamp = (type == CONTROLBOARD_READING_TORQUE) ? torqueStampArena[offset] : qStampArena[offset];
+            pushAlignmentHistory(type, ctrlBoard, stamp);
+        }
+        controlBoardReadEpoch[type][ctrlBoard] = epoch;
+    }
+
+    return update;
+}
+
+yarp::sig::Vector & yarpWholeBodySensors::controlBoardArena(const ControlBoardReadingType type)
+{
+    switch(type)
+    {
+        case CONTROLBOARD_READING_ENCODER_SPEED:        return dqArena;
+        case CONTROLBOARD_READING_ENCODER_ACCELERATION: return d2qArena;
+        case CONTROLBOARD_READING_PWM:                  return pwmArena;
+        case CONTROLBOARD_READING_TORQUE:               return torqueArena;
+        case CONTROLBOARD_READING_ENCODER_POS:
+        default:                                        return qArena;
+    }
+}
+
+void yarpWholeBodySensors::pushAlignmentHistory(const ControlBoardReadingType type, const int ctrlBoard, const double stamp)
+{
+    int nrOfControlBoards = controlBoardNames.size();
+    int head  = alignmentHistoryHead[type][ctrlBoard];
+    int count = alignmentHistoryCount[type][ctrlBoard];
+
+    // the same sample can be read more than once: store only new samples
+    if( count > 0 && alignmentHistoryTime[type][head*nrOfControlBoards+ctrlBoard] >= stamp )
+    {
+        return;
+    }
+
+    head = (head+1) % alignmentHistoryLength;
+    int arenaSize = controlBoardArena(type).size();
+    int offset = controlBoardArenaOffset[ctrlBoard];
+    memcpy(alignmentHistoryData[type].data()+head*arenaSize+offset,
+           controlBoardArena(type).data()+offset,
+           controlBoardAxes[ctrlBoard]*sizeof(double));
+    alignmentHistoryTime[type][head*nrOfControlBoards+ctrlBoard] = stamp;
+
+    alignmentHistoryHead[type][ctrlBoard] = head;
+    alignmentHistoryCount[type][ctrlBoard] = std::min(count+1,alignmentHistoryLength);
+}
+
+double yarpWholeBodySensors::alignControlBoards(const ControlBoardReadingType type, const std::vector<int> & ctrlBoardList)
+{
+    // the reference time is the oldest among the latest readings of the controlboards,
+    // so that every controlboard is interpolated and never extrapolated
+    int nrOfControlBoards = controlBoardNames.size();
+    double referenceTime = 0.0;
+    bool referenceTimeFound = false;
+    for(std::vector<int>::const_iterator ctrlBoard = ctrlBoardList.begin(); ctrlBoard != ctrlBoardList.end(); ctrlBoard++ )
+    {
+        if( alignmentHistoryCount[type][*ctrlBoard] == 0 ) continue;
+        double latestTime = alignmentHistoryTime[type][alignmentHistoryHead[type][*ctrlBoard]*nrOfControlBoards+*ctrlBoard];
+        if( !referenceTimeFound || latestTime < referenceTime )
+        {
+            referenceTime = latestTime;
+            referenceTimeFound = true;
+        }
+    }
+
+    for(std::vector<int>::const_iterator ctrlBoard = ctrlBoardList.begin(); ctrlBoard != ctrlBoardList.end(); ctrlBoard++ )
+    {
+        resampleControlBoard(type, *ctrlBoard, referenceTime);
+    }
+
+    return referenceTime;
+}
+
+void yarpWholeBodySensors::resampleControlBoard(const ControlBoardReadingType type, const int ctrlBoard, const double t)
+{
+    int nrOfControlBoards = controlBoardNames.size();
+    int arenaSize = alignedArena[type].size();
+    int offset = controlBoardArenaOffset[ctrlBoard];
+    int nrOfAxes = controlBoardAxes[ctrlBoard];
+    int head  = alignmentHistoryHead[type][ctrlBoard];
+    int count = alignmentHistoryCount[type][ctrlBoard];
+    double * out = alignedArena[type].data()+offset;
+
+    if( count == 0 )
+    {
+        memcpy(out, controlBoardArena(type).data()+offset, nrOfAxes*sizeof(double));
+        return;
+    }
+
+    // k-th newest sample of the history (k=0 is the newest)
+    #define HISTORY_SLOT(k) ((head-(k)+alignmentHistoryLength)%alignmentHistoryLength)
+    #define HISTORY_TIME(k) (alignmentHistoryTime[type][HISTORY_SLOT(k)*nrOfControlBoards+ctrlBoard])
+    #define HISTORY_DATA(k) (alignmentHistoryData[type].data()+HISTORY_SLOT(k)*arenaSize+offset)
+
+    // find the newest sample not after t
+    int k = 0;
+    while( k < count-1 && HISTORY_TIME(k) > t )
+    {
+        k++;
+    }
+
+    // t is after the newest sample or before the oldest one: hold the closest sample
+    if( k == 0 || HISTORY_TIME(k) > t )
+    {
+        memcpy(out, HISTORY_DATA(k), nrOfAxes*sizeof(double));
+        return;
+    }
+
+    // interpolate between the samples k (p0 at t0) and k-1 (p1 at t1)
+    const double * p0 = HISTORY_DATA(k);
+    const double * p1 = HISTORY_DATA(k-1);
+    double t0 = HISTORY_TIME(k);
+    double dt = HISTORY_TIME(k-1) - t0;
+    double s  = (t-t0)/dt;
+
+    if( timestampAlignment == TIMESTAMP_ALIGNMENT_LINEAR )
+    {
+        for(int axis=0; axis < nrOfAxes; axis++ )
+        {
+            out[axis] = p0[axis] + s*(p1[axis]-p0[axis]);
+        }
+        return;
+    }
+
+    // cubic Hermite interpolation, with the tangents estimated by finite differences
+    // of the neighbour samples (one sided at the boundaries of the history)
+    const double * pPrev = (k+1 < count) ? HISTORY_DATA(k+1) : p0;
+    const double * pNext = (k-2 >= 0)    ? HISTORY_DATA(k-2) : p1;
+    double tPrev = (k+1 < count) ? HISTORY_TIME(k+1) : t0;
+    double tNext = (k-2 >= 0)    ? HISTORY_TIME(k-2) : t0+dt;
+    double m0Scale = dt/(t0+dt-tPrev);
+    double m1Scale = dt/(tNext-t0);
+
+    double s2 = s*s, s3 = s2*s;
+    double h00 = 2*s3-3*s2+1, h10 = s3-2*s2+s, h01 = -2*s3+3*s2, h11 = s3-s2;
+    for(int axis=0; axis < nrOfAxes; axis++ )
+    {
+        double m0 = m0Scale*(p1[axis]-pPrev[axis]);
+        double m1 = m1Scale*(pNext[axis]-p0[axis]);
+        out[axis] = h00*p0[axis] + h10*m0 + h01*p1[axis] + h11*m1;
+    }
+
+    #undef HISTORY_SLOT
+    #undef HISTORY_TIME
+    #undef HISTORY_DATA
+}
+
+/** Get the controlboard reading corresponding to a given encoder type. */
+static ControlBoardReadingType encoderReadingType(const EncoderType st)
+{
+    switch(st)
+    {
+        case ENCODER_SPEED:        return CONTROLBOARD_READING_ENCODER_SPEED;
+        case ENCODER_ACCELERATION: return CONTROLBOARD_READING_ENCODER_ACCELERATION;
+        case ENCODER_POS:
+        default:                   return CONTROLBOARD_READING_ENCODER_POS;
+    }
+}
+
+bool yarpWholeBodySensors::readEncoders(const EncoderType st, double *data, double *stamps, bool wait)
+{
+    bool res = true, update=false;
+    ControlBoardReadingType readingType = encoderReadingType(st);
+    const yarp::sig::Vector & arena = (st == ENCODER_POS)   ? qArena :
+                                      (st == ENCODER_SPEED) ? dqArena :
+                                                              d2qArena;
+
+     //Read data from all controlboards
+    for(std::vector<int>::const_iterator ctrlBoard = encoderControlBoardList.begin();
+        ctrlBoard != encoderControlBoardList.end(); ctrlBoard++ )
+    {
+        update = readControlBoard(readingType, *ctrlBoard, wait);
+        if( !update && wait )
+        {
+            return false;
+        }
+
         res = res && update;
     }
 
-     //Copy readed data in the output vector
-    for(int encNumericId = 0; encNumericId < (int)sensorIdList[SENSOR_ENCODER_POS].size(); encNumericId++)
+    int nrOfEncoders = encoderGatherIndex.size();
+    if( timestampAlignment != TIMESTAMP_ALIGNMENT_NONE )
     {
-        int encControlBoard = encoderControlBoardAxisList[encNumericId].first;
-        int encAxis = encoderControlBoardAxisList[encNumericId].second;
-        data[encNumericId] = qLastRead[encControlBoard][encAxis];
+        //Resample all the controlboards at the same time, and copy them in the output vector
+        double referenceTime = alignControlBoards(readingType, encoderControlBoardList);
+        gatherAndScale(alignedArena[readingType].data(), encoderGatherIndex.data(), nrOfEncoders, yarpWbi::Deg2Rad, data);
         if(stamps!=0)
-                stamps[encNumericId] = qStampLastRead[encControlBoard][encAxis];
+            std::fill(stamps, stamps+nrOfEncoders, referenceTime);
+        return res || wait;
     }
 
+     //Copy readed data in the output vector (converting them to radians)
+    gatherAndScale(arena.data(), encoderGatherIndex.data(), nrOfEncoders, yarpWbi::Deg2Rad, data);
+    if(stamps!=0)
+        gather(qStampArena.data(), encoderGatherIndex.data(), nrOfEncoders, stamps);
+
 
     return res || wait;
 }
@@ -711,54 +1915,56 @@ bool yarpWholeBodySensors::readPwms(double *pwm, double *stamps, bool wait)
         return false;
     }
 
-    double pwmTemp[MAX_NJ];
     bool res = true, update=false;
 
     //Read data from all controlboards
     for(std::vector<int>::iterator ctrlBoard=pwmControlBoardList.begin();
         ctrlBoard != pwmControlBoardList.end(); ctrlBoard++ )
     {
-        // read data
-        double waiting_time = 0;
-
-#ifndef YARPWBI_YARP_HAS_LEGACY_IOPENLOOP
-        while( !(update=((IPWMControl*)iopl[*ctrlBoard])->getDutyCycles(pwmTemp)) && wait)
-#else
-        while( !(update=((IOpenLoopControl*)iopl[*ctrlBoard])->getOutputs(pwmTemp)) && wait)
-#endif
-        {
-            Time::delay(WAIT_TIME);
-
-            waiting_time += WAIT_TIME;
-
-            if( waiting_time > BLOCKING_SENSOR_TIMEOUT )
-            {
-                yError("yarpWholeBodySensors::readPwms failed for timeout");
-                return false;
-            }
-        }
-
-        // if reading has succeeded, update last read data
-        if(update)
+        update = readControlBoard(CONTROLBOARD_READING_PWM, *ctrlBoard, wait);
+        if( !update && wait )
         {
-            for(int axis=0; axis < (int) pwmLastRead[*ctrlBoard].size(); axis++ )
-            {
-                pwmLastRead[*ctrlBoard][axis] = pwmTemp[axis];
-            }
+            return false;
         }
 
         res = res && update;
     }
 
     //Copy readed data in the output vector
-    for(int pwmNumericId = 0; pwmNumericId < (int)sensorIdList[SENSOR_PWM].size(); pwmNumericId++)
+    gather(pwmArena.data(), pwmGatherIndex.data(), pwmGatherIndex.size(), pwm);
+
+    return res || wait;
+}
+
+bool yarpWholeBodySensors::readSensorPort(BufferedPort<Vector> * port, Vector & lastRead, double & lastStamp,
+                                          const int telemetrySource, int & lastSequence, bool wait)
+{
+    double readStart = (telemetry != 0) ? Time::now() : 0.0;
+    Vector *v = port->read(wait);
+    if( v == 0 )
     {
-        int pwmControlBoard = pwmControlBoardAxisList[pwmNumericId].first;
-        int pwmAxes = pwmControlBoardAxisList[pwmNumericId].second;
-        pwm[pwmNumericId] = pwmLastRead[pwmControlBoard][pwmAxes];
+        // no new sample: the caller gets the previous one
+        if( telemetry != 0 && telemetrySource >= 0 ) telemetry->recordSample(telemetrySource, false);
+        return false;
     }
 
-    return res || wait;
+    yarp::os::Stamp info;
+    lastRead = *v;
+    port->getEnvelope(info);
+    lastStamp = info.getTime();
+
+    if( telemetry != 0 && telemetrySource >= 0 )
+    {
+        telemetry->recordRead(telemetrySource, Time::now()-readStart);
+        telemetry->recordSample(telemetrySource, true);
+        unsigned long lostSamples = yarpWholeBodySensorsTelemetry::sequenceGap(lastSequence, info.getCount());
+        if( lostSamples > 0 )
+        {
+            telemetry->recordSequenceGap(telemetrySource, lostSamples);
+        }
+        lastSequence = info.getCount();
+    }
+    return true;
 }
 
 bool yarpWholeBodySensors::readAccelerometers(double *accs, double *stamps, bool wait)
@@ -775,17 +1981,9 @@ bool yarpWholeBodySensors::readIMUs(double *inertial, double *stamps, bool wait)
 {
     assert(false);
     return false;
-    Vector *v;
     for(int i=0; i < (int)sensorIdList[SENSOR_IMU].size(); i++)
     {
-        v = portsIMU[i]->read(wait);
-        if(v!=0)
-        {
-            yarp::os::Stamp info;
-            imuLastRead[i] = *v;
-            portsIMU[i]->getEnvelope(info);
-            imuStampLastRead[i] = info.getTime();
-        }
+        readSensorPort(portsIMU[i], imuLastRead[i], imuStampLastRead[i], imuTelemetrySources[i], imuLastSequence[i], wait);
         convertIMU(&inertial[sensorTypeDescriptions[SENSOR_IMU].dataSize*i],imuLastRead[i].data());
         if( stamps != 0 ) {
             stamps[i] = imuStampLastRead[i];
@@ -796,110 +1994,86 @@ bool yarpWholeBodySensors::readIMUs(double *inertial, double *stamps, bool wait)
 
 bool yarpWholeBodySensors::readFTsensors(double *ftSens, double *stamps, bool wait)
 {
-    Vector *v;
-    for(int i=0; i < (int)sensorIdList[SENSOR_FORCE_TORQUE].size(); i++)
+    //The raw readings are acquired in the output buffer, logged, and then calibrated in place
+    ftCalibrationMutex.lock();
+    int nrOfFTsensors = sensorIdList[SENSOR_FORCE_TORQUE].size();
+    ftNewSample.resize(nrOfFTsensors);
+    for(int i=0; i < nrOfFTsensors; i++)
     {
-        v = portsFTsens[i]->read(wait);
-        if(v!=0)
-        {
-            ftSensLastRead[i] = *v;
-            yarp::os::Stamp info;
-            portsFTsens[i]->getEnvelope(info);
-            ftStampSensLastRead[i] = info.getTime();
-        }
+        ftNewSample[i] = readSensorPort(portsFTsens[i], ftSensLastRead[i], ftStampSensLastRead[i], ftTelemetrySources[i], ftLastSequence[i], wait);
         memcpy(&ftSens[i*6], ftSensLastRead[i].data(), 6*sizeof(double));
         if( stamps != 0 ) {
                 stamps[i] = ftStampSensLastRead[i];
         }
-        i++;
     }
+
+    if( sensorsLog != 0 )
+    {
+        sensorsLog->log(SENSOR_FORCE_TORQUE, ftSens, stamps);
+    }
+
+    for(int i=0; i < nrOfFTsensors; i++)
+    {
+        calibrateFTsensor(i, &ftSens[i*6], ftNewSample[i]);
+    }
+    ftCalibrationMutex.unlock();
     return true;
 }
 
 bool yarpWholeBodySensors::readTorqueSensors(double *jointSens, double *stamps, bool wait)
 {
     bool res = true, update=false;
-   //Do not support stamps on torque sensors
 
     //Read data from all controlboards
     for(std::vector<int>::iterator ctrlBoard=torqueControlBoardList.begin();
         ctrlBoard != torqueControlBoardList.end(); ctrlBoard++ )
     {
-        // read data
-        double waiting_time = 0;
-        while( !(update=itrq[*ctrlBoard]->getTorques(torqueSensorsLastRead[*ctrlBoard].data())) && wait)
+        update = readControlBoard(CONTROLBOARD_READING_TORQUE, *ctrlBoard, wait);
+        if( !update && wait )
         {
-            Time::delay(WAIT_TIME);
-
-            waiting_time += WAIT_TIME;
-
-            if( waiting_time > BLOCKING_SENSOR_TIMEOUT )
-            {
-                yError("yarpWholeBodySensors::readTorqueSensors failed for timeout");
-                return false;
-            }
+            return false;
         }
 
         res = res && update;
     }
 
-    //Copy readed data in the output vector
-    for(int torqueNumericId = 0; torqueNumericId < (int)sensorIdList[SENSOR_TORQUE].size(); torqueNumericId++)
+    if( timestampAlignment != TIMESTAMP_ALIGNMENT_NONE )
     {
-        int torqueControlBoard = torqueControlBoardAxisList[torqueNumericId].first;
-        int torqueAxis = torqueControlBoardAxisList[torqueNumericId].second;
-        jointSens[torqueNumericId] = torqueSensorsLastRead[torqueControlBoard][torqueAxis];
+        //Resample all the controlboards at the same time, and copy them in the output vector
+        double referenceTime = alignControlBoards(CONTROLBOARD_READING_TORQUE, torqueControlBoardList);
+        gather(alignedArena[CONTROLBOARD_READING_TORQUE].data(), torqueGatherIndex.data(), torqueGatherIndex.size(), jointSens);
+        if(stamps != 0)
+            std::fill(stamps, stamps+torqueGatherIndex.size(), referenceTime);
+        return res || wait;
     }
 
+    //Copy readed data in the output vector
+    gather(torqueArena.data(), torqueGatherIndex.data(), torqueGatherIndex.size(), jointSens);
+
     if(stamps != 0)
-    {
-        double now = yarp::os::Time::now();
-        for(int torqueNumericId = 0; torqueNumericId < (int)sensorIdList[SENSOR_TORQUE].size(); torqueNumericId++)
-        {
-            stamps[torqueNumericId] = now;
-        }
-    }
+        gather(torqueStampArena.data(), torqueGatherIndex.data(), torqueGatherIndex.size(), stamps);
 
     return res || wait;
 }
 
 bool yarpWholeBodySensors::readEncoder(const EncoderType st, const int encoder_numeric_id, double *data, double *stamps, bool wait)
 {
-    bool update=false;
     int encoderCtrlBoard = encoderControlBoardAxisList[encoder_numeric_id].first;
-    int encoderCtrlBoardAxis = encoderControlBoardAxisList[encoder_numeric_id].second;
-
-    double dataTemp[MAX_NJ], tTemp[MAX_NJ];
-
-    // read encoders
-    double waiting_time = 0;
-    while( !(update=getEncodersPosSpeedAccTimed(st, ienc[encoderCtrlBoard], dataTemp, tTemp)) && wait)
-    {
-        Time::delay(WAIT_TIME);
-
-        waiting_time += WAIT_TIME;
 
-        if( waiting_time > BLOCKING_SENSOR_TIMEOUT )
-        {
-            yError("yarpWholeBodySensors::readEncoder failed for timeout");
-            return false;
-        }
-    }
-
-    if( update )
+    // read encoders (or get them from the read cache)
+    bool update = readControlBoard(encoderReadingType(st), encoderCtrlBoard, wait);
+    if( !update && wait )
     {
-          for(int axis=0; axis < (int)qLastRead[encoderCtrlBoard].size(); axis++ )
-          {
-                //std::cout << "read dataTemp : " << dataTemp[axis] << std::endl;
-                qLastRead[encoderCtrlBoard][axis] = yarpWbi::Deg2Rad*dataTemp[axis];
-                qStampLastRead[encoderCtrlBoard][axis] = tTemp[axis];
-          }
+        return false;
     }
 
     // copy most recent data into output variables
-    data[0] = qLastRead[encoderCtrlBoard][encoderCtrlBoardAxis];
+    const yarp::sig::Vector & arena = (st == ENCODER_POS)   ? qArena :
+                                      (st == ENCODER_SPEED) ? dqArena :
+                                                              d2qArena;
+    data[0] = yarpWbi::Deg2Rad*arena[encoderGatherIndex[encoder_numeric_id]];
     if(stamps!=0)
-        stamps[0] = qStampLastRead[encoderCtrlBoard][encoderCtrlBoardAxis];
+        stamps[0] = qStampArena[encoderGatherIndex[encoder_numeric_id]];
 
     return update || wait;  // if read failed => return false
 }
@@ -911,31 +2085,17 @@ bool yarpWholeBodySensors::readPwm(const int pwm_numeric_id, double *pwm, double
         yWarning("yarpWholeBodySensors::readPwm does not support timestamp reading at the moment");
     }
 
-    bool update=false;
     int pwmCtrlBoard = pwmControlBoardAxisList[pwm_numeric_id].first;
-    int pwmCtrlBoardAxis = pwmControlBoardAxisList[pwm_numeric_id].second;
 
-    // read pwm sensors
-    double waiting_time = 0.0;
-#ifndef YARPWBI_YARP_HAS_LEGACY_IOPENLOOP
-    while( !(update=((IPWMControl*)iopl[pwmCtrlBoard])->getDutyCycles(pwmLastRead[pwmCtrlBoard].data())) && wait)
-#else
-    while( !(update=((IOpenLoopControl*)iopl[pwmCtrlBoard])->getOutputs(pwmLastRead[pwmCtrlBoard].data())) && wait)
-#endif
+    // read pwm sensors (or get them from the read cache)
+    bool update = readControlBoard(CONTROLBOARD_READING_PWM, pwmCtrlBoard, wait);
+    if( !update && wait )
     {
-        Time::delay(WAIT_TIME);
-
-        waiting_time += WAIT_TIME;
-
-        if( waiting_time > BLOCKING_SENSOR_TIMEOUT )
-        {
-            yError("yarpWholeBodySensors::readPwm failed for timeout");
-            return false;
-        }
+        return false;
     }
 
     // copy most recent data into output variables
-    pwm[0] = pwmLastRead[pwmCtrlBoard][pwmCtrlBoardAxis];
+    pwm[0] = pwmArena[pwmGatherIndex[pwm_numeric_id]];
 
     return update || wait;  // if read failed => return false
 }
@@ -993,13 +2153,11 @@ bool yarpWholeBodySensors::readIMU(const int imu_sensor_numeric_id, double *iner
     }
     #endif
 
-    Vector *v = portsIMU[imu_sensor_numeric_id]->read(wait);
-    if(v!=0) {
-        yarp::os::Stamp info;
-        imuLastRead[imu_sensor_numeric_id] = *v;
-        portsIMU[imu_sensor_numeric_id]->getEnvelope(info);
-        imuStampLastRead[imu_sensor_numeric_id] = info.getTime();
-    }
+    readSensorPort(portsIMU[imu_sensor_numeric_id],
+                   imuLastRead[imu_sensor_numeric_id],
+                   imuStampLastRead[imu_sensor_numeric_id],
+                   imuTelemetrySources[imu_sensor_numeric_id],
+                   imuLastSequence[imu_sensor_numeric_id], wait);
     if( stamps != 0 ) {
         *stamps = imuStampLastRead[imu_sensor_numeric_id];
     }
@@ -1018,52 +2176,46 @@ bool yarpWholeBodySensors::readFTsensor(const int ft_sensor_numeric_id, double *
         return false;
     }
 
-    Vector *v = portsFTsens[ft_sensor_numeric_id]->read(wait);
-    if(v!=NULL) {
-        ftSensLastRead[ft_sensor_numeric_id] = *v;
-        yarp::os::Stamp info;
-        portsFTsens[ft_sensor_numeric_id]->getEnvelope(info);
-        ftStampSensLastRead[ft_sensor_numeric_id] = info.getTime();
-    }
+    bool newSample = readSensorPort(portsFTsens[ft_sensor_numeric_id],
+                                    ftSensLastRead[ft_sensor_numeric_id],
+                                    ftStampSensLastRead[ft_sensor_numeric_id],
+                                    ftTelemetrySources[ft_sensor_numeric_id],
+                                    ftLastSequence[ft_sensor_numeric_id], wait);
     memcpy(&ftSens[0], ftSensLastRead[ft_sensor_numeric_id].data(), 6*sizeof(double));
     if( stamps != 0 ) {
         *stamps = ftStampSensLastRead[ft_sensor_numeric_id];
     }
 
+    //The raw reading is logged before the calibration
+    if( sensorsLog != 0 )
+    {
+        sensorsLog->logSensor(SENSOR_FORCE_TORQUE, ft_sensor_numeric_id, ftSens, stamps);
+    }
+
+    ftCalibrationMutex.lock();
+    calibrateFTsensor(ft_sensor_numeric_id, ftSens, newSample);
+    ftCalibrationMutex.unlock();
+
     return true;
 }
 
 bool yarpWholeBodySensors::readTorqueSensor(const int numeric_torque_id, double *jointTorque, double *stamps, bool wait)
 {
-    double torqueTemp;
-    bool update=false;
-
     int torqueCtrlBoard = torqueControlBoardAxisList[numeric_torque_id].first;
-    int torqueCtrlBoardAxis = torqueControlBoardAxisList[numeric_torque_id].second;
 
     assert(itrq[torqueCtrlBoard]!=0);
 
-    // read joint torque
-    double waiting_time = 0.0;
-    while(!(update = itrq[torqueCtrlBoard]->getTorque(torqueCtrlBoardAxis, &torqueTemp)) && wait)
+    // read joint torques (or get them from the read cache)
+    bool update = readControlBoard(CONTROLBOARD_READING_TORQUE, torqueCtrlBoard, wait);
+    if( !update && wait )
     {
-        Time::delay(WAIT_TIME);
-
-        waiting_time += WAIT_TIME;
-
-        if( waiting_time > BLOCKING_SENSOR_TIMEOUT )
-        {
-            yError("yarpWholeBodySensors::readTorqueSensor failed for timeout");
-            return false;
-        }
+        return false;
     }
 
-    // if read succeeded => update data
-    if(update)
-        torqueSensorsLastRead[torqueCtrlBoard][torqueCtrlBoardAxis] = torqueTemp;
-
     // copy most recent data into output variables
-    jointTorque[0] = torqueSensorsLastRead[torqueCtrlBoard][torqueCtrlBoardAxis];
+    jointTorque[0] = torqueArena[torqueGatherIndex[numeric_torque_id]];
+    if(stamps!=0)
+        stamps[0] = torqueStampArena[torqueGatherIndex[numeric_torque_id]];
 
     return update || wait;  // if read failed => return false
 }
@@ -0,0 +1,340 @@
+/*
+ * Copyright (C) 2026 yarp-wholebodyinterface authors
+ *
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#include "yarpWholeBodySensorsLog.h"
+
+#include <yarp/os/RateThread.h>
+#include <yarp/os/Time.h>
+#include <yarp/os/Log.h>
+
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+using namespace wbi;
+using namespace yarpWbi;
+
+const char yarpWbi::SensorsLogMagic[8] = {'W','B','I','S','L','O','G','\0'};
+
+namespace yarpWbi
+{
+    /** Thread periodically flushing a yarpWholeBodySensorsLog to disk. */
+    class yarpWholeBodySensorsLogFlusher: public yarp::os::RateThread
+    {
+        yarpWholeBodySensorsLog * sensorsLog;
+
+    public:
+        yarpWholeBodySensorsLogFlusher(int periodInMs, yarpWholeBodySensorsLog * _sensorsLog):
+        RateThread(periodInMs), sensorsLog(_sensorsLog)
+        {
+        }
+
+        virtual void run()
+        {
+            sensorsLog->flush();
+        }
+    };
+}
+
+yarpWholeBodySensorsLog::yarpWholeBodySensorsLog():
+fileDescriptor(-1), mappedFile(0), fileSize(0), writeOffset(0),
+flushedOffset(0), droppedRecords(0), flusher(0)
+{
+}
+
+yarpWholeBodySensorsLog::~yarpWholeBodySensorsLog()
+{
+    close();
+}
+
+bool yarpWholeBodySensorsLog::isOpen() const
+{
+    return mappedFile != 0;
+}
+
+bool yarpWholeBodySensorsLog::open(const std::string & fileName,
+                                   const uint64_t _fileSize,
+                                   const std::vector<IDList> & sensorIdList,
+                                   const int flushPeriodInMs)
+{
+#ifdef _WIN32
+    yError("yarpWholeBodySensorsLog: memory-mapped logging is not supported on this platform");
+    return false;
+#else
+    if( isOpen() )
+    {
+        yError("yarpWholeBodySensorsLog: log already open");
+        return false;
+    }
+
+    //Compute the size of the header and of the records of each type
+    nrOfSensors.assign(SENSOR_TYPE_SIZE,0);
+    dataSize.assign(SENSOR_TYPE_SIZE,0);
+    uint64_t headerSize = sizeof(SensorsLogFileHeader) + 2*SENSOR_TYPE_SIZE*sizeof(uint32_t);
+    for(int st=0; st < SENSOR_TYPE_SIZE && st < (int)sensorIdList.size(); st++ )
+    {
+        nrOfSensors[st] = sensorIdList[st].size();
+        dataSize[st]    = sensorTypeDescriptions[st].dataSize;
+        for(int sid=0; sid < (int)nrOfSensors[st]; sid++ )
+        {
+            ID sensorId;
+            sensorIdList[st].indexToID(sid,sensorId);
+            headerSize += sensorId.toString().size()+1;
+        }
+    }
+    headerSize = ((headerSize+7)/8)*8;
+
+    if( _fileSize < headerSize )
+    {
+        yError("yarpWholeBodySensorsLog: log size of %lu bytes too small for the header of %lu bytes",
+               (unsigned long)_fileSize, (unsigned long)headerSize);
+        return false;
+    }
+
+    //Create, preallocate and map the file
+    fileDescriptor = ::open(fileName.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if( fileDescriptor < 0 )
+    {
+        yError("yarpWholeBodySensorsLog: impossible to create log file %s", fileName.c_str());
+        return false;
+    }
+
+    if( ftruncate(fileDescriptor, (off_t)_fileSize) != 0 )
+    {
+        yError("yarpWholeBodySensorsLog: impossible to allocate %lu bytes for log file %s", (unsigned long)_fileSize, fileName.c_str());
+        ::close(fileDescriptor);
+        fileDescriptor = -1;
+        return false;
+    }
+
+    void * mapped = mmap(0, (size_t)_fileSize, PROT_READ | PROT_WRITE, MAP_SHARED, fileDescriptor, 0);
+    if( mapped == MAP_FAILED )
+    {
+        yError("yarpWholeBodySensorsLog: impossible to map log file %s", fileName.c_str());
+        ::close(fileDescriptor);
+        fileDescriptor = -1;
+        return false;
+    }
+    mappedFile = (char*)mapped;
+    fileSize = _fileSize;
+
+    //Write the header
+    memset(mappedFile, 0, (size_t)headerSize);
+    SensorsLogFileHeader * header = (SensorsLogFileHeader*)mappedFile;
+    memcpy(header->magic, SensorsLogMagic, sizeof(header->magic));
+    header->version         = SENSORS_LOG_VERSION;
+    header->headerSize      = (uint32_t)headerSize;
+    header->fileSize        = fileSize;
+    header->endOffset       = headerSize;
+    header->dataSize        = 0;
+    header->nrOfSensorTypes = SENSOR_TYPE_SIZE;
+    header->reserved        = 0;
+
+    char * cursor = mappedFile + sizeof(SensorsLogFileHeader);
+    memcpy(cursor, &(nrOfSensors[0]), SENSOR_TYPE_SIZE*sizeof(uint32_t));
+    cursor += SENSOR_TYPE_SIZE*sizeof(uint32_t);
+    memcpy(cursor, &(dataSize[0]), SENSOR_TYPE_SIZE*sizeof(uint32_t));
+    cursor += SENSOR_TYPE_SIZE*sizeof(uint32_t);
+    for(int st=0; st < SENSOR_TYPE_SIZE; st++ )
+    {
+        for(int sid=0; sid < (int)nrOfSensors[st]; sid++ )
+        {
+            ID sensorId;
+            sensorIdList[st].indexToID(sid,sensorId);
+            std::string sensorName = sensorId.toString();
+            memcpy(cursor, sensorName.c_str(), sensorName.size()+1);
+            cursor += sensorName.size()+1;
+        }
+    }
+
+    writeOffset    = headerSize;
+    flushedOffset  = 0;
+    droppedRecords = 0;
+
+    //Start the background flusher
+    flusher = new yarpWholeBodySensorsLogFlusher(flushPeriodInMs, this);
+    if( !flusher->start() )
+    {
+        yWarning("yarpWholeBodySensorsLog: impossible to start the flusher thread, the log will be flushed only at close");
+        delete flusher;
+        flusher = 0;
+    }
+
+    return true;
+#endif
+}
+
+bool yarpWholeBodySensorsLog::log(const SensorType st, const double * data, const double * stamps)
+{
+    if( st < 0 || st >= SENSOR_TYPE_SIZE || nrOfSensors.empty() )
+    {
+        return false;
+    }
+    return logRange(st, 0, nrOfSensors[st], data, stamps);
+}
+
+bool yarpWholeBodySensorsLog::logSensor(const SensorType st, const int sid, const double * data, const double * stamps)
+{
+    return logRange(st, sid, 1, data, stamps);
+}
+
+bool yarpWholeBodySensorsLog::logRange(const SensorType st, const int firstSensor, const int n, const double * data, const double * stamps)
+{
+#ifdef _WIN32
+    return false;
+#else
+    if( st < 0 || st >= SENSOR_TYPE_SIZE )
+    {
+        return false;
+    }
+
+    double recordTime = yarp::os::Time::now();
+
+    mutex.lock();
+    if( !isOpen() || n <= 0 || firstSensor < 0 || firstSensor+n > (int)nrOfSensors[st] )
+    {
+        mutex.unlock();
+        return false;
+    }
+
+    uint32_t recordSize = sizeof(SensorsLogRecordHeader) + n*(dataSize[st]+1)*sizeof(double);
+    if( writeOffset + recordSize > fileSize )
+    {
+        if( droppedRecords == 0 )
+        {
+            yWarning("yarpWholeBodySensorsLog: log full, new readings will be dropped");
+        }
+        droppedRecords++;
+        mutex.unlock();
+        return false;
+    }
+
+    char * record = mappedFile + writeOffset;
+    SensorsLogRecordHeader * recordHeader = (SensorsLogRecordHeader*)record;
+    recordHeader->sensorType  = (uint32_t)st;
+    recordHeader->recordSize  = recordSize;
+    recordHeader->recordTime  = recordTime;
+    recordHeader->firstSensor = (uint32_t)firstSensor;
+    recordHeader->nrOfSensors = (uint32_t)n;
+
+    int nrOfDoubles = n*dataSize[st];
+    double * recordData = (double*)(record + sizeof(SensorsLogRecordHeader));
+    memcpy(recordData, data, nrOfDoubles*sizeof(double));
+
+    double * recordStamps = recordData + nrOfDoubles;
+    if( stamps != 0 )
+    {
+        memcpy(recordStamps, stamps, n*sizeof(double));
+    }
+    else
+    {
+        for(int sid=0; sid < n; sid++ )
+        {
+            recordStamps[sid] = recordTime;
+        }
+    }
+
+    writeOffset += recordSize;
+    ((SensorsLogFileHeader*)mappedFile)->endOffset = writeOffset;
+    mutex.unlock();
+
+    return true;
+#endif
+}
+
+bool yarpWholeBodySensorsLog::flush()
+{
+#ifdef _WIN32
+    return false;
+#else
+    if( !isOpen() )
+    {
+        return false;
+    }
+
+    mutex.lock();
+    uint64_t endOffset = writeOffset;
+    uint64_t startOffset = flushedOffset;
+    mutex.unlock();
+
+    if( endOffset == startOffset )
+    {
+        return true;
+    }
+
+    //msync requires a page aligned address (the header page is always synced, as it contains endOffset)
+    uint64_t pageSize = (uint64_t)sysconf(_SC_PAGESIZE);
+    uint64_t alignedStartOffset = (startOffset/pageSize)*pageSize;
+    bool ok = msync(mappedFile, (size_t)pageSize < fileSize ? (size_t)pageSize : (size_t)fileSize, MS_ASYNC) == 0;
+    ok = ok && msync(mappedFile+alignedStartOffset, (size_t)(endOffset-alignedStartOffset), MS_ASYNC) == 0;
+
+    mutex.lock();
+    flushedOffset = endOffset;
+    mutex.unlock();
+
+    return ok;
+#endif
+}
+
+bool yarpWholeBodySensorsLog::close()
+{
+#ifdef _WIN32
+    return true;
+#else
+    if( flusher != 0 )
+    {
+        flusher->stop();
+        delete flusher;
+        flusher = 0;
+    }
+
+    if( !isOpen() )
+    {
+        return true;
+    }
+
+    //Shrink the file to the written records (fileSize keeps the preallocated size)
+    mutex.lock();
+    ((SensorsLogFileHeader*)mappedFile)->dataSize = writeOffset;
+    bool ok = msync(mappedFile, (size_t)fileSize, MS_SYNC) == 0;
+    ok = (munmap(mappedFile, (size_t)fileSize) == 0) && ok;
+    mappedFile = 0;
+    ok = (ftruncate(fileDescriptor, (off_t)writeOffset) == 0) && ok;
+    ok = (::close(fileDescriptor) == 0) && ok;
+    fileDescriptor = -1;
+
+    if( droppedRecords > 0 )
+    {
+        yWarning("yarpWholeBodySensorsLog: %lu records dropped because the log was full", droppedRecords);
+    }
+    mutex.unlock();
+
+    return ok;
+#endif
+}
+
+unsigned long yarpWholeBodySensorsLog::getDroppedRecords()
+{
+    mutex.lock();
+    unsigned long dropped = droppedRecords;
+    mutex.unlock();
+    return dropped;
+}
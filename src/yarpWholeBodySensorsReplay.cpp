@@ -0,0 +1,408 @@
+/*
+ * Copyright (C) 2026 yarp-wholebodyinterface authors
+ *
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#include "yarpWholeBodySensorsReplay.h"
+
+#include <yarp/os/Time.h>
+#include <yarp/os/Log.h>
+#include <yarp/os/LogStream.h>
+
+#include <cstring>
+#include <fstream>
+
+using namespace wbi;
+using namespace yarpWbi;
+
+yarpWholeBodySensorsReplay::yarpWholeBodySensorsReplay(const char* _name, const yarp::os::Property & opt):
+yarpWholeBodySensors(_name,opt), replayRealTime(false), nextRecord(0),
+replayStarted(false), logStartTime(0.0), replayStartTime(0.0)
+{
+}
+
+bool yarpWholeBodySensorsReplay::init()
+{
+    if( initDone ) return true;
+
+    yarp::os::Bottle & sensors_options = wbi_yarp_properties.findGroup("WBI_SENSORS_OPTIONS");
+    if( !sensors_options.check("replayLog") )
+    {
+        yError() << "yarpWholeBodySensorsReplay : replayLog option not found in WBI_SENSORS_OPTIONS";
+        return false;
+    }
+    std::string logFile = sensors_options.find("replayLog").asString().c_str();
+    replayRealTime = sensors_options.check("replayRealTime");
+
+    if( !loadLog(logFile) )
+    {
+        return false;
+    }
+
+    yInfo() << "yarpWholeBodySensorsReplay : replaying " << recordOffsets.size() << " records from " << logFile
+            << (replayRealTime ? " in real time" : " as fast as possible");
+
+    initDone = true;
+    return true;
+}
+
+bool yarpWholeBodySensorsReplay::close()
+{
+    replayMutex.lock();
+    logBuffer.clear();
+    recordOffsets.clear();
+    nextRecord = 0;
+    nextRecordOfType.clear();
+    lastRecordOfType.clear();
+    replayStarted = false;
+    replayMutex.unlock();
+    return yarpWholeBodySensors::close();
+}
+
+bool yarpWholeBodySensorsReplay::addSensor(const SensorType st, const ID &sid)
+{
+    if( initDone )
+    {
+        yError() << "yarpWholeBodySensorsReplay : sensors can not be added during the replay";
+        return false;
+    }
+    return yarpWholeBodySensors::addSensor(st, sid);
+}
+
+int yarpWholeBodySensorsReplay::addSensors(const SensorType st, const IDList &sids)
+{
+    if( initDone )
+    {
+        yError() << "yarpWholeBodySensorsReplay : sensors can not be added during the replay";
+        return 0;
+    }
+    return yarpWholeBodySensors::addSensors(st, sids);
+}
+
+bool yarpWholeBodySensorsReplay::removeSensor(const SensorType st, const ID &sid)
+{
+    if( initDone )
+    {
+        yError() << "yarpWholeBodySensorsReplay : sensors can not be removed during the replay";
+        return false;
+    }
+    return yarpWholeBodySensors::removeSensor(st, sid);
+}
+
+bool yarpWholeBodySensorsReplay::loadLog(const std::string & logFile)
+{
+    //Load the whole log in memory
+    std::ifstream logStream(logFile.c_str(), std::ios::in | std::ios::binary);
+    if( !logStream.is_open() )
+    {
+        yError() << "yarpWholeBodySensorsReplay : impossible to open " << logFile;
+        return false;
+    }
+    logStream.seekg(0, std::ios::end);
+    std::streamoff logSize = logStream.tellg();
+    logStream.seekg(0, std::ios::beg);
+    if( logSize < (std::streamoff)sizeof(SensorsLogFileHeader) )
+    {
+        yError() << "yarpWholeBodySensorsReplay : " << logFile << " is not a valid sensor log";
+        return false;
+    }
+    logBuffer.resize((size_t)logSize);
+    logStream.read(&(logBuffer[0]), logSize);
+    if( !logStream )
+    {
+        yError() << "yarpWholeBodySensorsReplay : impossible to read " << logFile;
+        return false;
+    }
+
+    //Check the header: every field is checked against the size of the log, which may be truncated or corrupted
+    const SensorsLogFileHeader * header = (const SensorsLogFileHeader*)&(logBuffer[0]);
+    uint64_t logBufferSize = logBuffer.size();
+    if( memcmp(header->magic, SensorsLogMagic, sizeof(header->magic)) != 0
+        || header->version != SENSORS_LOG_VERSION )
+    {
+        yError() << "yarpWholeBodySensorsReplay : " << logFile << " is not a valid sensor log (version " << SENSORS_LOG_VERSION << ")";
+        return false;
+    }
+    if( header->headerSize > logBufferSize
+        || sizeof(SensorsLogFileHeader) + 2*(uint64_t)header->nrOfSensorTypes*sizeof(uint32_t) > header->headerSize )
+    {
+        yError() << "yarpWholeBodySensorsReplay : truncated or corrupted header in " << logFile;
+        return false;
+    }
+
+    //Read the number of sensors, the reading sizes and the sensor IDs of each type
+    int nrOfLogTypes = header->nrOfSensorTypes;
+    const char * cursor = &(logBuffer[0]) + sizeof(SensorsLogFileHeader);
+    const char * headerEnd = &(logBuffer[0]) + header->headerSize;
+    std::vector<uint32_t> nrOfSensorsInLog(nrOfLogTypes), dataSizeInLog(nrOfLogTypes);
+    if( nrOfLogTypes > 0 )
+    {
+        memcpy(&(nrOfSensorsInLog[0]), cursor, nrOfLogTypes*sizeof(uint32_t));
+        cursor += nrOfLogTypes*sizeof(uint32_t);
+        memcpy(&(dataSizeInLog[0]), cursor, nrOfLogTypes*sizeof(uint32_t));
+        cursor += nrOfLogTypes*sizeof(uint32_t);
+    }
+
+    std::vector<IDList> logSensorIdList(nrOfLogTypes);
+    for(int st=0; st < nrOfLogTypes; st++ )
+    {
+        //a reading of a single sensor must fit in the log
+        if( ((uint64_t)dataSizeInLog[st]+1)*sizeof(double) > logBufferSize )
+        {
+            yError() << "yarpWholeBodySensorsReplay : corrupted reading size of sensor type " << st << " in " << logFile;
+            return false;
+        }
+        for(uint32_t sid=0; sid < nrOfSensorsInLog[st]; sid++ )
+        {
+            const char * nameEnd = (const char*)memchr(cursor, '\0', headerEnd-cursor);
+            if( nameEnd == 0 )
+            {
+                yError() << "yarpWholeBodySensorsReplay : truncated sensor list in " << logFile;
+                return false;
+            }
+            logSensorIdList[st].addID(cursor);
+            cursor = nameEnd+1;
+        }
+    }
+
+    //Map the sensors added to the interface to the sensors of the log
+    logNrOfSensors.assign(SENSOR_TYPE_SIZE,0);
+    logDataSize.assign(SENSOR_TYPE_SIZE,0);
+    logSensorIndex.resize(SENSOR_TYPE_SIZE);
+    replayedData.resize(SENSOR_TYPE_SIZE);
+    replayedStamps.resize(SENSOR_TYPE_SIZE);
+    replayedDataAvailable.resize(SENSOR_TYPE_SIZE);
+    for(int st=0; st < SENSOR_TYPE_SIZE; st++ )
+    {
+        logSensorIndex[st].resize(sensorIdList[st].size());
+        //readings of a different size (e.g. a log written with a different wbi) can not be replayed
+        if( st < nrOfLogTypes && dataSizeInLog[st] == (uint32_t)sensorTypeDescriptions[st].dataSize )
+        {
+            logNrOfSensors[st] = nrOfSensorsInLog[st];
+            logDataSize[st]    = dataSizeInLog[st];
+        }
+
+        if( sensorIdList[st].size() > 0 && logNrOfSensors[st] == 0 )
+        {
+            yError() << "yarpWholeBodySensorsReplay : readings of sensor type " << st << " not found in " << logFile;
+            return false;
+        }
+
+        for(int sid=0; sid < (int)sensorIdList[st].size(); sid++ )
+        {
+            ID sensorId;
+            sensorIdList[st].indexToID(sid,sensorId);
+            if( !logSensorIdList[st].idToIndex(sensorId,logSensorIndex[st][sid]) )
+            {
+                yError() << "yarpWholeBodySensorsReplay : sensor " << sensorId.toString() << " not found in " << logFile;
+                return false;
+            }
+        }
+
+        replayedData[st].resize(logNrOfSensors[st]*logDataSize[st],0.0);
+        replayedStamps[st].resize(logNrOfSensors[st],0.0);
+        replayedDataAvailable[st].assign(logNrOfSensors[st],false);
+    }
+
+    //Index the records
+    uint64_t endOffset = header->endOffset < logBufferSize ? header->endOffset : logBufferSize;
+    uint64_t offset = header->headerSize;
+    recordOffsets.clear();
+    lastRecordOfType.assign(SENSOR_TYPE_SIZE,0);
+    while( offset + sizeof(SensorsLogRecordHeader) <= endOffset )
+    {
+        const SensorsLogRecordHeader * record = (const SensorsLogRecordHeader*)&(logBuffer[offset]);
+        if( record->sensorType >= (uint32_t)nrOfLogTypes
+            || record->nrOfSensors == 0
+            || record->firstSensor > nrOfSensorsInLog[record->sensorType]
+            || record->nrOfSensors > nrOfSensorsInLog[record->sensorType] - record->firstSensor
+            || (uint64_t)record->recordSize != sizeof(SensorsLogRecordHeader) + (uint64_t)record->nrOfSensors*((uint64_t)dataSizeInLog[record->sensorType]+1)*sizeof(double)
+            || offset + record->recordSize > endOffset )
+        {
+            yWarning() << "yarpWholeBodySensorsReplay : corrupted record in " << logFile << ", ignoring the rest of the log";
+            break;
+        }
+        recordOffsets.push_back(offset);
+        if( record->sensorType < (uint32_t)SENSOR_TYPE_SIZE )
+        {
+            lastRecordOfType[record->sensorType] = recordOffsets.size();
+        }
+        offset += record->recordSize;
+    }
+
+    if( recordOffsets.empty() )
+    {
+        yError() << "yarpWholeBodySensorsReplay : no records found in " << logFile;
+        return false;
+    }
+
+    logStartTime = ((const SensorsLogRecordHeader*)&(logBuffer[recordOffsets[0]]))->recordTime;
+    nextRecord = 0;
+    nextRecordOfType.assign(SENSOR_TYPE_SIZE,0);
+    replayStarted = false;
+    return true;
+}
+
+void yarpWholeBodySensorsReplay::replayRecord(const size_t record)
+{
+    const SensorsLogRecordHeader * recordHeader = (const SensorsLogRecordHeader*)&(logBuffer[recordOffsets[record]]);
+    int st = recordHeader->sensorType;
+    //types unknown to this wbi, or with readings of a different size, are not replayed
+    if( st >= SENSOR_TYPE_SIZE || logNrOfSensors[st] == 0 )
+    {
+        return;
+    }
+
+    //the record contains the readings of the sensors firstSensor ... firstSensor+nrOfSensors-1 of the log
+    const double * recordData = (const double*)(((const char*)recordHeader) + sizeof(SensorsLogRecordHeader));
+    int firstSensor = recordHeader->firstSensor;
+    int nrOfSensors = recordHeader->nrOfSensors;
+    int nrOfDoubles = nrOfSensors*logDataSize[st];
+    memcpy(replayedData[st].data()+firstSensor*logDataSize[st], recordData, nrOfDoubles*sizeof(double));
+    memcpy(replayedStamps[st].data()+firstSensor, recordData+nrOfDoubles, nrOfSensors*sizeof(double));
+    for(int sid=firstSensor; sid < firstSensor+nrOfSensors; sid++ )
+    {
+        replayedDataAvailable[st][sid] = true;
+    }
+}
+
+bool yarpWholeBodySensorsReplay::isReplayedDataAvailable(const SensorType st, const int sid)
+{
+    if( sid >= 0 )
+    {
+        return replayedDataAvailable[st][logSensorIndex[st][sid]];
+    }
+    for(int i=0; i < (int)sensorIdList[st].size(); i++ )
+    {
+        if( !replayedDataAvailable[st][logSensorIndex[st][i]] )
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+bool yarpWholeBodySensorsReplay::advanceReplay(const SensorType st)
+{
+    if( replayRealTime )
+    {
+        double now = yarp::os::Time::now();
+        if( !replayStarted )
+        {
+            replayStarted = true;
+            replayStartTime = now;
+        }
+
+        double logTime = logStartTime + (now - replayStartTime);
+        while( nextRecord < recordOffsets.size()
+               && ((const SensorsLogRecordHeader*)&(logBuffer[recordOffsets[nextRecord]]))->recordTime <= logTime )
+        {
+            replayRecord(nextRecord);
+            nextRecord++;
+        }
+        return isReplayedDataAvailable(st);
+    }
+
+    //Each sensor type has its own cursor, so the records of the other types are
+    //not consumed and are replayed in order by the bulk reads of their type
+    size_t & nextRecordOfThisType = nextRecordOfType[st];
+    while( nextRecordOfThisType < lastRecordOfType[st] )
+    {
+        size_t record = nextRecordOfThisType++;
+        if( ((const SensorsLogRecordHeader*)&(logBuffer[recordOffsets[record]]))->sensorType == (uint32_t)st )
+        {
+            replayRecord(record);
+            return isReplayedDataAvailable(st);
+        }
+    }
+
+    //End of the records of this type
+    return false;
+}
+
+void yarpWholeBodySensorsReplay::copyReplayedReading(const SensorType st, const int sid, double *data, double *stamps)
+{
+    int dataSize = logDataSize[st];
+    int logSid = logSensorIndex[st][sid];
+    memcpy(data, replayedData[st].data()+logSid*dataSize, dataSize*sizeof(double));
+    if( stamps != 0 )
+    {
+        *stamps = replayedStamps[st][logSid];
+    }
+}
+
+bool yarpWholeBodySensorsReplay::readSensor(const SensorType st, const int sid, double *data, double *stamps, bool blocking)
+{
+    if( !initDone || st < 0 || st >= SENSOR_TYPE_SIZE || sid < 0 || sid >= (int)sensorIdList[st].size() )
+    {
+        return false;
+    }
+
+    replayMutex.lock();
+    if( replayRealTime )
+    {
+        advanceReplay(st);
+    }
+
+    bool ret = isReplayedDataAvailable(st, sid);
+    if( ret )
+    {
+        copyReplayedReading(st, sid, data, stamps);
+    }
+    replayMutex.unlock();
+
+    return ret;
+}
+
+bool yarpWholeBodySensorsReplay::readSensors(const SensorType st, double *data, double *stamps, bool blocking)
+{
+    if( !initDone || st < 0 || st >= SENSOR_TYPE_SIZE )
+    {
+        return false;
+    }
+
+    replayMutex.lock();
+    bool ret = advanceReplay(st);
+    if( ret )
+    {
+        int dataSize = logDataSize[st];
+        for(int sid=0; sid < (int)sensorIdList[st].size(); sid++ )
+        {
+            copyReplayedReading(st, sid, data+sid*dataSize, stamps != 0 ? stamps+sid : 0);
+        }
+    }
+    replayMutex.unlock();
+
+    return ret;
+}
+
+bool yarpWholeBodySensorsReplay::isReplayFinished()
+{
+    replayMutex.lock();
+    bool finished = nextRecord >= recordOffsets.size();
+    if( !replayRealTime )
+    {
+        //finished when all the records of the sensor types added to the interface have been replayed
+        finished = true;
+        for(int st=0; st < (int)nextRecordOfType.size(); st++ )
+        {
+            if( sensorIdList[st].size() > 0 && nextRecordOfType[st] < lastRecordOfType[st] )
+            {
+                finished = false;
+            }
+        }
+    }
+    replayMutex.unlock();
+    return finished;
+}
@@ -0,0 +1,282 @@
+/*
+ * Copyright (C) 2026 yarp-wholebodyinterface authors
+ *
+ * Permission is granted to copy, distribute, and/or modify this program
+ * under the terms of the GNU General Public License, version 2 or any
+ * later version published by the Free Software Foundation.
+ *
+ * A copy of the license can be found at
+ * http://www.robotcub.org/icub/license/gpl.txt
+ *
+ * This program is distributed in the hope that it will be useful, but
+ * WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE. See the GNU General
+ * Public License for more details
+ */
+
+#include "yarpWholeBodySensorsTelemetry.h"
+
+#include <yarp/os/Log.h>
+#include <yarp/os/Time.h>
+
+#include <cmath>
+
+using namespace yarpWbi;
+
+#define LATENCY_HISTOGRAM_BINS 72         ///< number of bins of the latency histograms
+#define LATENCY_HISTOGRAM_MIN  1e-5       ///< upper bound of the first bin (seconds)
+#define LATENCY_BINS_PER_OCTAVE 4.0
+#define STALE_PERIOD_FACTOR    2.0       ///< a sample is stale when older than this number of expected periods
+#define PERIOD_FILTER_GAIN     0.1       ///< gain of the exponential filter estimating the period of the sources
+#define SEQUENCE_COUNTER_RANGE 2147483648UL  ///< range of the sequence number of yarp::os::Stamp (2^31)
+
+namespace yarpWbi
+{
+    /** Thread periodically publishing the statistics of a yarpWholeBodySensorsTelemetry. */
+    class yarpWholeBodySensorsTelemetryPublisher: public yarp::os::RateThread
+    {
+        yarpWholeBodySensorsTelemetry * telemetry;
+
+    public:
+        yarp::os::BufferedPort<yarp::os::Bottle> port;
+
+        yarpWholeBodySensorsTelemetryPublisher(int periodInMs, yarpWholeBodySensorsTelemetry * _telemetry):
+        RateThread(periodInMs), telemetry(_telemetry)
+        {
+        }
+
+        virtual void run()
+        {
+            yarp::os::Bottle & bot = port.prepare();
+            bot.clear();
+            telemetry->toBottle(bot);
+            port.write();
+        }
+    };
+}
+
+yarpWholeBodySensorsTelemetry::yarpWholeBodySensorsTelemetry(): publisher(0)
+{
+}
+
+yarpWholeBodySensorsTelemetry::~yarpWholeBodySensorsTelemetry()
+{
+    stopPublishing();
+}
+
+int yarpWholeBodySensorsTelemetry::latencyBin(const double latency)
+{
+    if( latency <= LATENCY_HISTOGRAM_MIN )
+    {
+        return 0;
+    }
+    int bin = (int)ceil(LATENCY_BINS_PER_OCTAVE*log(latency/LATENCY_HISTOGRAM_MIN)/log(2.0));
+    return bin < LATENCY_HISTOGRAM_BINS ? bin : LATENCY_HISTOGRAM_BINS-1;
+}
+
+double yarpWholeBodySensorsTelemetry::latencyBinUpperBound(const int bin)
+{
+    return LATENCY_HISTOGRAM_MIN*pow(2.0,bin/LATENCY_BINS_PER_OCTAVE);
+}
+
+double yarpWholeBodySensorsTelemetry::latencyPercentile(const int source, const double percentile) const
+{
+    unsigned long reads = statistics[source].reads;
+    if( reads == 0 )
+    {
+        return 0.0;
+    }
+
+    unsigned long threshold = (unsigned long)ceil(percentile*reads);
+    unsigned long cumulated = 0;
+    for(int bin=0; bin < LATENCY_HISTOGRAM_BINS; bin++ )
+    {
+        cumulated += latencyHistograms[source][bin];
+        if( cumulated >= threshold )
+        {
+            // the last bin is open ended: use the maximum measured latency
+            return bin < LATENCY_HISTOGRAM_BINS-1 ? latencyBinUpperBound(bin) : statistics[source].latencyMax;
+        }
+    }
+    return statistics[source].latencyMax;
+}
+
+int yarpWholeBodySensorsTelemetry::addSource(const std::string & sourceName)
+{
+    SensorReadStatistics emptyStatistics = {0,0,0,0,0,0.0,0.0,0.0,0.0};
+    mutex.lock();
+    int source = sourceNames.size();
+    sourceNames.push_back(sourceName);
+    statistics.push_back(emptyStatistics);
+    latencyHistograms.push_back(std::vector<unsigned long>(LATENCY_HISTOGRAM_BINS,0));
+    lastNewSampleTime.push_back(0.0);
+    expectedPeriod.push_back(0.0);
+    mutex.unlock();
+    return source;
+}
+
+int yarpWholeBodySensorsTelemetry::getNrOfSources() const
+{
+    // sources can be added while the statistics are published
+    mutex.lock();
+    int nrOfSources = sourceNames.size();
+    mutex.unlock();
+    return nrOfSources;
+}
+
+std::string yarpWholeBodySensorsTelemetry::getSourceName(const int source) const
+{
+    std::string sourceName;
+    mutex.lock();
+    if( source >= 0 && source < (int)sourceNames.size() )
+    {
+        sourceName = sourceNames[source];
+    }
+    mutex.unlock();
+    return sourceName;
+}
+
+void yarpWholeBodySensorsTelemetry::recordRead(const int source, const double latency)
+{
+    int bin = latencyBin(latency);
+    mutex.lock();
+    statistics[source].reads++;
+    latencyHistograms[source][bin]++;
+    if( latency > statistics[source].latencyMax )
+    {
+        statistics[source].latencyMax = latency;
+    }
+    mutex.unlock();
+}
+
+void yarpWholeBodySensorsTelemetry::recordTimeout(const int source)
+{
+    mutex.lock();
+    statistics[source].timeouts++;
+    mutex.unlock();
+}
+
+void yarpWholeBodySensorsTelemetry::recordSample(const int source, const bool newSample)
+{
+    double now = yarp::os::Time::now();
+    mutex.lock();
+    if( newSample )
+    {
+        if( lastNewSampleTime[source] > 0.0 )
+        {
+            double period = now - lastNewSampleTime[source];
+            expectedPeriod[source] = (expectedPeriod[source] <= 0.0) ? period
+                                   : expectedPeriod[source] + PERIOD_FILTER_GAIN*(period - expectedPeriod[source]);
+        }
+        lastNewSampleTime[source] = now;
+    }
+    else if( expectedPeriod[source] > 0.0 && now - lastNewSampleTime[source] > STALE_PERIOD_FACTOR*expectedPeriod[source] )
+    {
+        statistics[source].staleSamples++;
+    }
+    mutex.unlock();
+}
+
+unsigned long yarpWholeBodySensorsTelemetry::sequenceGap(const int previousCount, const int count)
+{
+    if( previousCount < 0 || count < 0 )
+    {
+        return 0;
+    }
+    unsigned long gap = ((unsigned long)count + SEQUENCE_COUNTER_RANGE - (unsigned long)previousCount - 1) % SEQUENCE_COUNTER_RANGE;
+    // a repeated or older sequence number (or a restart of the sender) gives a gap of more than half of the range
+    return gap < SEQUENCE_COUNTER_RANGE/2 ? gap : 0;
+}
+
+void yarpWholeBodySensorsTelemetry::recordSequenceGap(const int source, const unsigned long lostSamples)
+{
+    mutex.lock();
+    statistics[source].sequenceGaps += lostSamples;
+    mutex.unlock();
+}
+
+void yarpWholeBodySensorsTelemetry::recordRejectedSample(const int source, const unsigned long rejectedSamples)
+{
+    mutex.lock();
+    statistics[source].rejectedSamples += rejectedSamples;
+    mutex.unlock();
+}
+
+bool yarpWholeBodySensorsTelemetry::getStatistics(const int source, SensorReadStatistics & sourceStatistics)
+{
+    mutex.lock();
+    if( source < 0 || source >= (int)sourceNames.size() )
+    {
+        mutex.unlock();
+        return false;
+    }
+    sourceStatistics = statistics[source];
+    sourceStatistics.latencyP50 = latencyPercentile(source,0.5);
+    sourceStatistics.latencyP90 = latencyPercentile(source,0.9);
+    sourceStatistics.latencyP99 = latencyPercentile(source,0.99);
+    mutex.unlock();
+    return true;
+}
+
+void yarpWholeBodySensorsTelemetry::reset()
+{
+    SensorReadStatistics emptyStatistics = {0,0,0,0,0,0.0,0.0,0.0,0.0};
+    mutex.lock();
+    for(int source=0; source < (int)sourceNames.size(); source++ )
+    {
+        statistics[source] = emptyStatistics;
+        latencyHistograms[source].assign(LATENCY_HISTOGRAM_BINS,0);
+    }
+    mutex.unlock();
+}
+
+void yarpWholeBodySensorsTelemetry::toBottle(yarp::os::Bottle & bot)
+{
+    for(int source=0; source < getNrOfSources(); source++ )
+    {
+        SensorReadStatistics sourceStatistics;
+        getStatistics(source,sourceStatistics);
+        yarp::os::Bottle & sourceBot = bot.addList();
+        sourceBot.addString(getSourceName(source).c_str());
+        sourceBot.addInt((int)sourceStatistics.reads);
+        sourceBot.addInt((int)sourceStatistics.timeouts);
+        sourceBot.addInt((int)sourceStatistics.staleSamples);
+        sourceBot.addInt((int)sourceStatistics.sequenceGaps);
+        sourceBot.addInt((int)sourceStatistics.rejectedSamples);
+        sourceBot.addDouble(1e3*sourceStatistics.latencyP50);
+        sourceBot.addDouble(1e3*sourceStatistics.latencyP90);
+        sourceBot.addDouble(1e3*sourceStatistics.latencyP99);
+        sourceBot.addDouble(1e3*sourceStatistics.latencyMax);
+    }
+}
+
+bool yarpWholeBodySensorsTelemetry::startPublishing(const std::string & portName, const int periodInMs)
+{
+    if( publisher != 0 )
+    {
+        return true;
+    }
+
+    publisher = new yarpWholeBodySensorsTelemetryPublisher(periodInMs, this);
+    if( !publisher->port.open(portName.c_str()) || !publisher->start() )
+    {
+        yError("yarpWholeBodySensorsTelemetry: impossible to publish the telemetry on port %s", portName.c_str());
+        publisher->port.close();
+        delete publisher;
+        publisher = 0;
+        return false;
+    }
+    return true;
+}
+
+void yarpWholeBodySensorsTelemetry::stopPublishing()
+{
+    if( publisher == 0 )
+    {
+        return;
+    }
+    publisher->stop();
+    publisher->port.close();
+    delete publisher;
+    publisher = 0;
+}
@@ -17,6 +17,7 @@
 
 #include "yarpWholeBodyStates.h"
 #include "yarpWholeBodySensors.h"
+#include "yarpWholeBodySensorsReplay.h"
 #include "yarpWbiUtil.h"
 
 #include <wbi/iWholeBodyModel.h>
@@ -25,10 +26,15 @@
 #include <yarp/os/Time.h>
 #include <yarp/os/Log.h>
 #include <yarp/os/LogStream.h>
+#include <yarp/os/ResourceFinder.h>
 #include <yarp/math/api.h>
 #include <iCub/skinDynLib/common.h>
 
 #include <string>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <limits>
 
 #include <Eigen/LU>
 
@@ -56,6 +62,7 @@ sensors(0),
 estimator(0)
 {
     estimateIdList.resize(wbi::ESTIMATE_TYPE_SIZE);
+    estimateListCopies.resize(wbi::ESTIMATE_TYPE_SIZE);
     wholeBodyModel = wholeBodyModelRef;
 }
 
@@ -259,6 +266,66 @@ bool yarpWholeBodyStates::configureFloatingBaseStateEstimator()
     return true;
 }
 
+bool yarpWholeBodyStates::configureForceTorqueEstimator()
+{
+    yarp::os::Bottle & state_opt_bot = wbi_yarp_properties.findGroup("WBI_STATE_OPTIONS");
+
+    if( !wbi_yarp_properties.check("urdf") && !wbi_yarp_properties.check("urdf_file") )
+    {
+        yError("yarpWholeBodyStates fatal error: forceTorqueCompensation requires the urdf option");
+        return false;
+    }
+
+    std::string urdf_file;
+    if( wbi_yarp_properties.check("urdf") )
+    {
+        urdf_file = wbi_yarp_properties.find("urdf").asString().c_str();
+    }
+    else
+    {
+        urdf_file = wbi_yarp_properties.find("urdf_file").asString().c_str();
+    }
+
+    yarp::os::ResourceFinder rf;
+    if( wbi_yarp_properties.check("verbose") )
+    {
+        rf.setVerbose();
+    }
+    std::string urdf_file_path = rf.findFile(urdf_file.c_str());
+
+    std::string fixed_frame;
+    if( state_opt_bot.check("forceTorqueEstimationFixedFrame") )
+    {
+        fixed_frame = state_opt_bot.find("forceTorqueEstimationFixedFrame").asString().c_str();
+    }
+
+    double gravity[3] = {0.0, 0.0, -9.81};
+    if( state_opt_bot.check("forceTorqueEstimationGravity") )
+    {
+        yarp::os::Bottle * gravity_bot = state_opt_bot.find("forceTorqueEstimationGravity").asList();
+        if( !gravity_bot || gravity_bot->size() != 3 )
+        {
+            yError("yarpWholeBodyStates fatal error: forceTorqueEstimationGravity should be a list of 3 doubles");
+            return false;
+        }
+        for(int i=0; i < 3; i++ )
+        {
+            gravity[i] = gravity_bot->get(i).asDouble();
+        }
+    }
+
+    estimator->ftEstimator = new modelBasedForceTorqueEstimator();
+    if( !estimator->ftEstimator->init(urdf_file_path, fixed_frame, gravity) )
+    {
+        yError() << "Error while initializing the model based force/torque estimation from " << urdf_file_path;
+        delete estimator->ftEstimator;
+        estimator->ftEstimator = 0;
+        return false;
+    }
+
+    return true;
+}
+
 bool yarpWholeBodyStates::init()
 {
     if (initDone) return false;
@@ -354,8 +421,17 @@ bool yarpWholeBodyStates::init()
 
 
 
-    sensors = new yarpWholeBodySensors(name.c_str(), wbi_yarp_properties);              // sensor interface
+    if( wbi_yarp_properties.findGroup("WBI_SENSORS_OPTIONS").check("replayLog") )
+    {
+        yInfo() << "yarpWholeBodyStates : replayLog option found, replaying recorded sensor readings";
+        sensors = new yarpWholeBodySensorsReplay(name.c_str(), wbi_yarp_properties);    // replayed sensor interface
+    }
+    else
+    {
+        sensors = new yarpWholeBodySensors(name.c_str(), wbi_yarp_properties);          // sensor interface
+    }
     estimator = new yarpWholeBodyEstimator(estimatorPeriod_in_ms, cutOffFrequencyTorqueInHz, cutOffFrequencyVelocitiesInHz, sensors);  // estimation thread
+    sensors->setSensorTablesLock(&(estimator->mutex));  // sensors added after init are swapped in between two estimator cycles
 
 
     if( wbi_yarp_properties.check("readSpeedAccFromControlBoard") )
@@ -369,6 +445,33 @@ bool yarpWholeBodyStates::init()
         estimator->readSpeedAccFromControlBoard = false;
     }
 
+    if( wbi_yarp_properties.findGroup("WBI_STATE_OPTIONS").check("outlierRejection") )
+    {
+        yarp::os::Bottle & state_options = wbi_yarp_properties.findGroup("WBI_STATE_OPTIONS");
+        std::string outlierRejection = state_options.find("outlierRejection").asString().c_str();
+        if( outlierRejection == "median3" )
+        {
+            estimator->qOutlierRejector.configure(OUTLIER_REJECTION_MEDIAN3);
+            estimator->tauJOutlierRejector.configure(OUTLIER_REJECTION_MEDIAN3);
+        }
+        else if( outlierRejection == "rateLimit" )
+        {
+            if( !state_options.check("maxJointVelocity") || !state_options.check("maxJointTorqueRate") )
+            {
+                yError() << "yarpWholeBodyStates : rateLimit outlier rejection requires the maxJointVelocity and maxJointTorqueRate options";
+                return false;
+            }
+            estimator->qOutlierRejector.configure(OUTLIER_REJECTION_RATE_LIMIT, state_options.find("maxJointVelocity").asDouble());
+            estimator->tauJOutlierRejector.configure(OUTLIER_REJECTION_RATE_LIMIT, state_options.find("maxJointTorqueRate").asDouble());
+        }
+        else if( outlierRejection != "none" )
+        {
+            yError() << "yarpWholeBodyStates : unknown outlierRejection " << outlierRejection << ", available rejections are none, median3 and rateLimit";
+            return false;
+        }
+        yInfo() << "yarpWholeBodyStates : using " << outlierRejection << " outlier rejection on encoders and joint torques";
+    }
+
     // handle legacy parameter
     if( wbi_yarp_properties.findGroup("WBI_STATE_OPTIONS").check("estimateBasePosAndVel") )
     {
@@ -401,47 +504,58 @@ bool yarpWholeBodyStates::init()
         }
     }
 
+    estimator->compensateForceTorque = wbi_yarp_properties.findGroup("WBI_STATE_OPTIONS").check("forceTorqueCompensation");
+    if( estimator->compensateForceTorque )
+    {
+        yInfo() << "yarpWholeBodyStates : forceTorqueCompensation option found, compensating the force/torque sensors for the weight of the attached links";
+    }
+    estimator->estimateJointTorquesFromFT = wbi_yarp_properties.findGroup("WBI_STATE_OPTIONS").check("estimateJointTorquesFromFT");
+    if( estimator->estimateJointTorquesFromFT )
+    {
+        yInfo() << "yarpWholeBodyStates : estimateJointTorquesFromFT option found, estimating joint torques from the force/torque sensors";
+        yarp::os::Bottle * contacts_bot = wbi_yarp_properties.findGroup("WBI_STATE_OPTIONS").find("defaultContactFrames").asList();
+        if( contacts_bot )
+        {
+            for(int i=0; i < contacts_bot->size(); i++ )
+            {
+                estimator->defaultContactFrames.addID(contacts_bot->get(i).asString().c_str());
+            }
+        }
+        if( estimator->defaultContactFrames.size() == 0 && estimateIdList[ESTIMATE_EXTERNAL_FORCE_TORQUE].size() == 0 )
+        {
+            yError() << "yarpWholeBodyStates : estimateJointTorquesFromFT requires the defaultContactFrames option or external wrench estimates";
+            return false;
+        }
+    }
+    if( estimator->compensateForceTorque || estimator->estimateJointTorquesFromFT || estimateIdList[ESTIMATE_EXTERNAL_FORCE_TORQUE].size() > 0 )
+    {
+        if( !this->configureForceTorqueEstimator() )
+        {
+            return false;
+        }
+        for(int i=0; i < (int)estimator->defaultContactFrames.size(); i++ )
+        {
+            wbi::ID frame;
+            estimator->defaultContactFrames.indexToID(i, frame);
+            if( !estimator->ftEstimator->hasFrame(frame) )
+            {
+                yError() << "yarpWholeBodyStates : default contact frame " << frame.toString() << " not found in the model of the force/torque estimation";
+                return false;
+            }
+        }
+    }
+
     //Add required sensors given the estimate list
     // TODO FIXME ugly, we should probably have a way to iterate on estimate type
     // indipendent from enum values
     for(int et_i=0; et_i < wbi::ESTIMATE_TYPE_SIZE; et_i++)
     {
         EstimateType et = static_cast<EstimateType>(et_i);
-        //bool SensorAddOk = true;
-        //int addedSensors = 0;
-        // this is the perfect example of switch that should be avoided
-        switch(et)
+        int added = addSensorsForEstimate(et, estimateIdList[et]);
+        if( et == ESTIMATE_EXTERNAL_FORCE_TORQUE && added != (int)estimateIdList[et].size() )
         {
-            case ESTIMATE_JOINT_POS:
-                sensors->addSensors(SENSOR_ENCODER_POS, estimateIdList[et]);
-                break;
-            case ESTIMATE_JOINT_VEL:
-                sensors->addSensors(SENSOR_ENCODER_SPEED, estimateIdList[et]);
-                break;
-            case ESTIMATE_JOINT_ACC:
-                sensors->addSensors(SENSOR_ENCODER_ACCELERATION, estimateIdList[et]);
-                break;
-
-            case ESTIMATE_JOINT_TORQUE:
-            case ESTIMATE_JOINT_TORQUE_DERIVATIVE:
-            case ESTIMATE_MOTOR_TORQUE:
-            case ESTIMATE_MOTOR_TORQUE_DERIVATIVE:
-                sensors->addSensors(SENSOR_TORQUE, estimateIdList[et]);
-                break;
-            case ESTIMATE_MOTOR_PWM:
-                sensors->addSensors(SENSOR_PWM,  estimateIdList[et]);
-                break;
-            //case ESTIMATE_IMU:
-            //  SensorAddOk = lockAndAddSensors(SENSOR_IMU, sids);
-            //  break;
-            case ESTIMATE_FORCE_TORQUE_SENSOR:
-                sensors->addSensors(SENSOR_FORCE_TORQUE, estimateIdList[et]);
-                break;
-            case ESTIMATE_EXTERNAL_FORCE_TORQUE:
-                ///< \todo TODO properly account for external forque torque
-                break;
-            default:
-                break;
+            yError() << "yarpWholeBodyStates::init : some external wrench frames are not in the model of the force/torque estimation";
+            return false;
         }
     }
 
@@ -489,9 +603,80 @@ bool yarpWholeBodyStates::close()
     return ok;
 }
 
+int yarpWholeBodyStates::addSensorsForEstimate(const EstimateType et, const IDList &sids)
+{
+    // this is the perfect example of switch that should be avoided
+    switch(et)
+    {
+        case ESTIMATE_JOINT_POS:
+            return sensors->addSensors(SENSOR_ENCODER_POS, sids);
+        case ESTIMATE_JOINT_VEL:
+            return sensors->addSensors(SENSOR_ENCODER_SPEED, sids);
+        case ESTIMATE_JOINT_ACC:
+            return sensors->addSensors(SENSOR_ENCODER_ACCELERATION, sids);
+
+        case ESTIMATE_JOINT_TORQUE:
+        case ESTIMATE_JOINT_TORQUE_DERIVATIVE:
+        case ESTIMATE_MOTOR_TORQUE:
+        case ESTIMATE_MOTOR_TORQUE_DERIVATIVE:
+            return sensors->addSensors(SENSOR_TORQUE, sids);
+        case ESTIMATE_MOTOR_PWM:
+            return sensors->addSensors(SENSOR_PWM, sids);
+        //case ESTIMATE_IMU:
+        //  SensorAddOk = lockAndAddSensors(SENSOR_IMU, sids);
+        //  break;
+        case ESTIMATE_FORCE_TORQUE_SENSOR:
+            return sensors->addSensors(SENSOR_FORCE_TORQUE, sids);
+        case ESTIMATE_EXTERNAL_FORCE_TORQUE:
+            if( estimator->ftEstimator == 0 )
+            {
+                yError() << "yarpWholeBodyStates : external wrench estimates can be added only if they are requested before init, or with forceTorqueCompensation";
+                return 0;
+            }
+            return estimator->lockAndAddExternalWrenchFrames(sids);
+        default:
+            break;
+    }
+    return 0;
+}
+
+bool yarpWholeBodyStates::removeSensorForEstimate(const EstimateType et, const ID &sid)
+{
+    switch(et)
+    {
+        case ESTIMATE_JOINT_POS:
+            return sensors->removeSensor(SENSOR_ENCODER_POS, sid);
+        case ESTIMATE_JOINT_VEL:
+            return sensors->removeSensor(SENSOR_ENCODER_SPEED, sid);
+        case ESTIMATE_JOINT_ACC:
+            return sensors->removeSensor(SENSOR_ENCODER_ACCELERATION, sid);
+
+        case ESTIMATE_JOINT_TORQUE:
+        case ESTIMATE_JOINT_TORQUE_DERIVATIVE:
+        case ESTIMATE_MOTOR_TORQUE:
+        case ESTIMATE_MOTOR_TORQUE_DERIVATIVE:
+            return sensors->removeSensor(SENSOR_TORQUE, sid);
+        case ESTIMATE_MOTOR_PWM:
+            return sensors->removeSensor(SENSOR_PWM, sid);
+        case ESTIMATE_FORCE_TORQUE_SENSOR:
+            return sensors->removeSensor(SENSOR_FORCE_TORQUE, sid);
+        case ESTIMATE_EXTERNAL_FORCE_TORQUE:
+            return estimator->lockAndRemoveExternalWrenchFrame(sid);
+        default:
+            break;
+    }
+    return false;
+}
+
 bool yarpWholeBodyStates::addEstimate(const EstimateType et, const ID &sid)
 {
-    if( initDone ) return false;
+    if( initDone )
+    {
+        // the sensors are opened at runtime, the estimator resizes its buffers at its next cycle
+        IDList sids;
+        sids.addID(sid);
+        return addSensorsForEstimate(et, sids) == 1;
+    }
 
     estimateIdList[et].addID(sid);
     return true;
@@ -499,14 +684,19 @@ bool yarpWholeBodyStates::addEstimate(const EstimateType et, const ID &sid)
 
 int yarpWholeBodyStates::addEstimates(const EstimateType et, const IDList &sids)
 {
-    if( initDone ) return false;
-    estimateIdList[et].addIDList(sids);
-    return true;
+    if( initDone )
+    {
+        return addSensorsForEstimate(et, sids);
+    }
+    return estimateIdList[et].addIDList(sids);
 }
 
 bool yarpWholeBodyStates::removeEstimate(const EstimateType et, const ID &sid)
 {
-    if( initDone ) return false;
+    if( initDone )
+    {
+        return removeSensorForEstimate(et, sid);
+    }
 
    estimateIdList[et].removeID(sid);
    return true;
@@ -514,29 +704,37 @@ bool yarpWholeBodyStates::removeEstimate(const EstimateType et, const ID &sid)
 
 const IDList& yarpWholeBodyStates::getEstimateList(const EstimateType et)
 {
-    if( initDone )
+    if( !initDone )
     {
-    switch(et)
+        return estimateIdList[et];
+    }
+    if( et < 0 || et >= wbi::ESTIMATE_TYPE_SIZE )
     {
-    case ESTIMATE_JOINT_POS:                return sensors->getSensorList(SENSOR_ENCODER_POS);
-    case ESTIMATE_JOINT_VEL:                return sensors->getSensorList(SENSOR_ENCODER_SPEED);
-    case ESTIMATE_JOINT_ACC:                return sensors->getSensorList(SENSOR_ENCODER_ACCELERATION);
-    case ESTIMATE_JOINT_TORQUE:             return sensors->getSensorList(SENSOR_TORQUE);
-    case ESTIMATE_JOINT_TORQUE_DERIVATIVE:  return sensors->getSensorList(SENSOR_TORQUE);
-    case ESTIMATE_MOTOR_POS:                return estimateIdList[ESTIMATE_MOTOR_POS];
-    case ESTIMATE_MOTOR_VEL:                return estimateIdList[ESTIMATE_MOTOR_POS];
-    case ESTIMATE_MOTOR_ACC:                return estimateIdList[ESTIMATE_MOTOR_POS];
-    case ESTIMATE_MOTOR_TORQUE:             return estimateIdList[ESTIMATE_MOTOR_POS];
-    case ESTIMATE_MOTOR_TORQUE_DERIVATIVE:  return estimateIdList[ESTIMATE_MOTOR_POS];
-    case ESTIMATE_MOTOR_PWM:                return estimateIdList[ESTIMATE_MOTOR_POS];
-    //case ESTIMATE_IMU:                    return sensors->getSensorList(SENSOR_IMU);
-    case ESTIMATE_FORCE_TORQUE_SENSOR:      return sensors->getSensorList(SENSOR_FORCE_TORQUE);
-    // ESTIMATE_EXTERNAL_FORCE_TORQUE: return list of links where is possible to get contact
-    default: break;
+        return emptyList;
     }
-    return emptyList;
+
+    // the lists change at runtime under the estimator mutex: return a copy taken under it
+    estimator->mutex.wait();
+    switch(et)
+    {
+    case ESTIMATE_JOINT_POS:                estimateListCopies[et] = sensors->getSensorList(SENSOR_ENCODER_POS); break;
+    case ESTIMATE_JOINT_VEL:                estimateListCopies[et] = sensors->getSensorList(SENSOR_ENCODER_SPEED); break;
+    case ESTIMATE_JOINT_ACC:                estimateListCopies[et] = sensors->getSensorList(SENSOR_ENCODER_ACCELERATION); break;
+    case ESTIMATE_JOINT_TORQUE:             estimateListCopies[et] = sensors->getSensorList(SENSOR_TORQUE); break;
+    case ESTIMATE_JOINT_TORQUE_DERIVATIVE:  estimateListCopies[et] = sensors->getSensorList(SENSOR_TORQUE); break;
+    case ESTIMATE_MOTOR_POS:                estimateListCopies[et] = estimateIdList[ESTIMATE_MOTOR_POS]; break;
+    case ESTIMATE_MOTOR_VEL:                estimateListCopies[et] = estimateIdList[ESTIMATE_MOTOR_POS]; break;
+    case ESTIMATE_MOTOR_ACC:                estimateListCopies[et] = estimateIdList[ESTIMATE_MOTOR_POS]; break;
+    case ESTIMATE_MOTOR_TORQUE:             estimateListCopies[et] = estimateIdList[ESTIMATE_MOTOR_POS]; break;
+    case ESTIMATE_MOTOR_TORQUE_DERIVATIVE:  estimateListCopies[et] = estimateIdList[ESTIMATE_MOTOR_POS]; break;
+    case ESTIMATE_MOTOR_PWM:                estimateListCopies[et] = estimateIdList[ESTIMATE_MOTOR_POS]; break;
+    //case ESTIMATE_IMU:                    estimateListCopies[et] = sensors->getSensorList(SENSOR_IMU); break;
+    case ESTIMATE_FORCE_TORQUE_SENSOR:      estimateListCopies[et] = sensors->getSensorList(SENSOR_FORCE_TORQUE); break;
+    case ESTIMATE_EXTERNAL_FORCE_TORQUE:    estimateListCopies[et] = estimator->externalWrenchFrames; break;
+    default:                                estimateListCopies[et] = emptyList; break;
     }
-    return estimateIdList[et];
+    estimator->mutex.post();
+    return estimateListCopies[et];
 }
 
 int yarpWholeBodyStates::getEstimateNumber(const EstimateType et)
@@ -557,9 +755,9 @@ bool yarpWholeBodyStates::getEstimate(const EstimateType et, const int numeric_i
     case ESTIMATE_JOINT_ACC:
         return estimator->lockAndCopyVectorElement(numeric_id, estimator->estimates.lastD2q, data);
     case ESTIMATE_JOINT_TORQUE:
-        return estimator->lockAndCopyVectorElement(numeric_id, estimator->estimates.lastTauJ, data);
+        return estimator->lockAndCopyJointTorqueEstimates(numeric_id, estimator->estimates.lastTauJ, data);
     case ESTIMATE_JOINT_TORQUE_DERIVATIVE:
-        return estimator->lockAndCopyVectorElement(numeric_id, estimator->estimates.lastDtauJ, data);
+        return estimator->lockAndCopyJointTorqueEstimates(numeric_id, estimator->estimates.lastDtauJ, data);
     case ESTIMATE_MOTOR_POS:
         return false;
     case ESTIMATE_MOTOR_VEL:
@@ -577,7 +775,7 @@ bool yarpWholeBodyStates::getEstimate(const EstimateType et, const int numeric_i
     case ESTIMATE_FORCE_TORQUE_SENSOR:
         return lockAndReadSensor(SENSOR_FORCE_TORQUE, numeric_id, data, time, blocking);
     case ESTIMATE_EXTERNAL_FORCE_TORQUE:
-        return false; //lockAndGetExternalWrench(sid,data);
+        return estimator->lockAndCopyExternalWrenches(numeric_id, data);
    case ESTIMATE_BASE_POS:
         return estimator->lockAndCopyVectorElement(numeric_id,estimator->estimates.lastBasePos,data);
    case ESTIMATE_BASE_VEL:
@@ -601,8 +799,8 @@ bool yarpWholeBodyStates::getEstimates(const EstimateType et, double *data, doub
     case ESTIMATE_JOINT_POS:                return estimator->lockAndCopyVector(estimator->estimates.lastQ, data);
     case ESTIMATE_JOINT_VEL:                return estimator->lockAndCopyVector(estimator->estimates.lastDq, data);
     case ESTIMATE_JOINT_ACC:                return estimator->lockAndCopyVector(estimator->estimates.lastD2q, data);
-    case ESTIMATE_JOINT_TORQUE:             return estimator->lockAndCopyVector(estimator->estimates.lastTauJ, data);
-    case ESTIMATE_JOINT_TORQUE_DERIVATIVE:  return estimator->lockAndCopyVector(estimator->estimates.lastDtauJ, data);
+    case ESTIMATE_JOINT_TORQUE:             return estimator->lockAndCopyJointTorqueEstimates(-1, estimator->estimates.lastTauJ, data);
+    case ESTIMATE_JOINT_TORQUE_DERIVATIVE:  return estimator->lockAndCopyJointTorqueEstimates(-1, estimator->estimates.lastDtauJ, data);
     case ESTIMATE_MOTOR_POS:                return false;
     case ESTIMATE_MOTOR_VEL:                return getMotorVel(data, time, blocking);
     case ESTIMATE_MOTOR_ACC:                return false;
@@ -633,6 +831,7 @@ bool yarpWholeBodyStates::getEstimates(const EstimateType et, double *data, doub
         }
     }
     case ESTIMATE_FORCE_TORQUE_SENSOR:      return lockAndReadSensors(SENSOR_FORCE_TORQUE, data, time, blocking);
+    case ESTIMATE_EXTERNAL_FORCE_TORQUE:    return estimator->lockAndCopyExternalWrenches(-1, data);
     default: break;
     }
     return false;
@@ -643,6 +842,18 @@ bool yarpWholeBodyStates::setEstimationParameter(const EstimateType et, const Es
     return estimator->lockAndSetEstimationParameter(et, ep, value);
 }
 
+bool yarpWholeBodyStates::getCompensatedForceTorqueEstimate(const int numeric_id, double *data)
+{
+    if( !initDone || !estimator->compensateForceTorque ) return false;
+    return estimator->lockAndCopyVectorBlock(numeric_id, 6, estimator->estimates.lastCompensatedFT, data);
+}
+
+bool yarpWholeBodyStates::getCompensatedForceTorqueEstimates(double *data)
+{
+    if( !initDone || !estimator->compensateForceTorque ) return false;
+    return estimator->lockAndCopyVector(estimator->estimates.lastCompensatedFT, data);
+}
+
 // *********************************************************************************************************************
 // *********************************************************************************************************************
 //                                          PRIVATE METHODS
@@ -680,44 +891,115 @@ bool yarpWholeBodyStates::lockAndReadSensor(const SensorType st, const int numer
 
 
 
-bool yarpWholeBodyStates::lockAndAddSensor(const SensorType st, const ID &sid)
+IDList yarpWholeBodyStates::lockAndGetSensorList(const SensorType st)
 {
     estimator->mutex.wait();
-    bool res = sensors->addSensor(st, sid);
+    IDList res = sensors->getSensorList(st);
     estimator->mutex.post();
     return res;
 }
 
-int yarpWholeBodyStates::lockAndAddSensors(const SensorType st, const IDList &sids)
+int yarpWholeBodyStates::lockAndGetSensorNumber(const SensorType st)
 {
     estimator->mutex.wait();
-    int res = sensors->addSensors(st, sids);
+    int res = sensors->getSensorNumber(st);
     estimator->mutex.post();
     return res;
 }
 
-bool yarpWholeBodyStates::lockAndRemoveSensor(const SensorType st, const ID &sid)
+// *********************************************************************************************************************
+// *********************************************************************************************************************
+//                                         JOINT OUTLIER REJECTOR
+// *********************************************************************************************************************
+// *********************************************************************************************************************
+jointOutlierRejector::jointOutlierRejector():
+type(OUTLIER_REJECTION_NONE), maxRate(0.0), previousTime(0.0), nrOfSamples(0)
 {
-    estimator->mutex.wait();
-    bool res = sensors->removeSensor(st, sid);
-    estimator->mutex.post();
-    return res;
 }
 
-IDList yarpWholeBodyStates::lockAndGetSensorList(const SensorType st)
+void jointOutlierRejector::configure(const OutlierRejectionType _type, const double _maxRate)
 {
-    estimator->mutex.wait();
-    IDList res = sensors->getSensorList(st);
-    estimator->mutex.post();
-    return res;
+    type = _type;
+    maxRate = _maxRate;
+    nrOfSamples = 0;
 }
 
-int yarpWholeBodyStates::lockAndGetSensorNumber(const SensorType st)
+void jointOutlierRejector::resize(const int n)
 {
-    estimator->mutex.wait();
-    int res = sensors->getSensorNumber(st);
-    estimator->mutex.post();
-    return res;
+    if( (int)previous.size() == n )
+    {
+        return;
+    }
+    previous.resize(n,0.0);
+    previous2.resize(n,0.0);
+    consecutiveRejections.assign(n,0);
+    nrOfSamples = 0;
+}
+
+void jointOutlierRejector::reset()
+{
+    consecutiveRejections.assign(consecutiveRejections.size(),0);
+    nrOfSamples = 0;
+}
+
+int jointOutlierRejector::filter(yarp::sig::Vector & x, const double time, const double fallbackDt)
+{
+    if( type == OUTLIER_REJECTION_NONE )
+    {
+        return 0;
+    }
+
+    int n = x.size();
+    double * xp = x.data();
+    double * p1 = previous.data();
+    double * p2 = previous2.data();
+    int rejected = 0;
+
+    if( nrOfSamples < 2 )
+    {
+        // not enough history yet: accept the sample
+        memcpy(p2, p1, n*sizeof(double));
+        memcpy(p1, xp, n*sizeof(double));
+        previousTime = time;
+        nrOfSamples++;
+        return 0;
+    }
+
+    if( type == OUTLIER_REJECTION_MEDIAN3 )
+    {
+        for(int i=0; i < n; i++ )
+        {
+            double a = p2[i], b = p1[i], c = xp[i];
+            double median = std::max(std::min(a,b), std::min(std::max(a,b),c));
+            p2[i] = b;
+            p1[i] = c;
+            rejected += (median != c);
+            xp[i] = median;
+        }
+        return rejected;
+    }
+
+    // rate limit
+    double dt = time - previousTime;
+    if( dt <= 0.0 ) dt = fallbackDt;
+    previousTime = time;
+    double maxDelta = maxRate*dt;
+    int * consecutive = consecutiveRejections.data();
+    for(int i=0; i < n; i++ )
+    {
+        if( std::abs(xp[i]-p1[i]) > maxDelta && consecutive[i] < 2 )
+        {
+            consecutive[i]++;
+            xp[i] = p1[i];
+            rejected++;
+        }
+        else
+        {
+            consecutive[i] = 0;
+            p1[i] = xp[i];
+        }
+    }
+    return rejected;
 }
 
 // *********************************************************************************************************************
@@ -739,8 +1021,19 @@ yarpWholeBodyEstimator::yarpWholeBodyEstimator(int _period_in_milliseconds, doub
   motor_quantites_estimation_enabled(false),
   estimateBaseState(false),
   use_localFloatingBaseStateEstimator(false),
-  use_remoteFloatingBaseStateEstimator(false)
+  use_remoteFloatingBaseStateEstimator(false),
+  ftEstimator(0),
+  compensateForceTorque(false),
+  externalWrenchFramesChanged(true),
+  externalWrenchesValid(false),
+  tauJEstimatesValid(true),
+  forceTorqueEstimationOk(true),
+  estimateJointTorquesFromFT(false),
+  qOutliersTelemetrySource(-1),
+  tauJOutliersTelemetrySource(-1),
+  sensorTablesGeneration(0)
 {
+    lastTauJStamp = -std::numeric_limits<double>::max();
     resizeAll(sensors->getSensorNumber(SENSOR_ENCODER_POS));
 
     ///< Window lengths of adaptive window filters
@@ -762,8 +1055,14 @@ yarpWholeBodyEstimator::yarpWholeBodyEstimator(int _period_in_milliseconds, doub
 
 }
 
+yarpWholeBodyEstimator::~yarpWholeBodyEstimator()
+{
+    if( ftEstimator != 0 ) { delete ftEstimator; ftEstimator = 0; }
+}
+
 bool yarpWholeBodyEstimator::threadInit()
 {
+    sensorTablesGeneration = sensors->getSensorTablesGeneration();
     resizeAll(sensors->getSensorNumber(SENSOR_ENCODER_POS));
     ///< create derivative filters
     dqFilt = new AWLinEstimator(dqFiltWL, dqFiltTh);
@@ -782,6 +1081,20 @@ bool yarpWholeBodyEstimator::threadInit()
     velocitiesFilt = new FirstOrderLowPassFilter(velocitiesCutFrequency > 0 ? velocitiesCutFrequency : 3, getRate()*1e-3, estimates.lastDq);
 
 
+    ///< count the samples rejected as outliers in the sensor telemetry
+    if( sensors->getTelemetry() != 0 )
+    {
+        qOutliersTelemetrySource    = sensors->getTelemetry()->addSource("estimator/encoders");
+        tauJOutliersTelemetrySource = sensors->getTelemetry()->addSource("estimator/jointTorques");
+    }
+
+    ///< map the joints and force/torque sensors to the model of the force/torque estimation
+    if( ftEstimator != 0 )
+    {
+        ftEstimator->setJointList(sensors->getSensorList(SENSOR_ENCODER_POS));
+        ftEstimator->setJointTorqueList(sensors->getSensorList(SENSOR_TORQUE));
+    }
+
     int dof = estimates.lastQ.length();
     // Update dof in base estimator
     localFltBaseStateEstimator.changeDoF(dof);
@@ -801,18 +1114,37 @@ void yarpWholeBodyEstimator::run()
 {
     mutex.wait();
     {
+        ///< Start a new read cycle: each controlboard is queried at most once per cycle
+        sensors->advanceReadEpoch();
+
+        ///< Sensors may have been added or removed at runtime: rebuild the filters for the new sensor tables
+        ///< (a swap of sensors leaves the number of joints unchanged, so the table generation is checked)
+        unsigned long generation = sensors->getSensorTablesGeneration();
+        bool sensorsChanged = generation != sensorTablesGeneration;
+        sensorTablesGeneration = generation;
         resizeAll(sensors->getSensorNumber(SENSOR_ENCODER_POS));
+        if( sensorsChanged )
+        {
+            rebuildFilters();
+        }
 
         ///< Read encoders
         if(sensors->readSensors(SENSOR_ENCODER_POS, q.data(), qStamps.data(), false))
         {
-            estimates.lastQ = q;
-
             // in case we estimate the speeds and accelerations instead of reading them
             AWPolyElement el;
-            el.data = q;
             el.time = yarp::os::Time::now();
 
+            ///< reject the outliers before they reach the filters
+            int rejected = qOutlierRejector.filter(q, el.time, getRate()*1e-3);
+            if( rejected > 0 && qOutliersTelemetrySource >= 0 )
+            {
+                sensors->getTelemetry()->recordRejectedSample(qOutliersTelemetrySource, rejected);
+            }
+
+            estimates.lastQ = q;
+            el.data = q;
+
             /* If the encoders speeds/accelerations estimation by the firmware are enabled
             read these values from the controlboard. */
             if(this->readSpeedAccFromControlBoard )
@@ -846,12 +1178,34 @@ void yarpWholeBodyEstimator::run()
             }
         }
 
-        ///< Read joint torque sensors
-        if(sensors->readSensors(SENSOR_TORQUE, tauJ.data(), tauJStamps.data(), false))
+        ///< Compute the model based force/torque estimates
+        bool tauJEstimated = false;
+        if( ftEstimator != 0 )
+        {
+            tauJEstimated = computeForceTorqueEstimates(sensorsChanged);
+        }
+
+        ///< Read joint torque sensors, or use the joint torques estimated from the force/torque sensors
+        bool tauJAvailable = estimateJointTorquesFromFT ? tauJEstimated
+                                                        : sensors->readSensors(SENSOR_TORQUE, tauJ.data(), tauJStamps.data(), false);
+        tauJEstimatesValid = !estimateJointTorquesFromFT || tauJEstimated;
+        if( tauJAvailable )
         {
             // @todo Convert joint torques into motor torques
+            ///< use the acquisition time of the most recent joint torque as time of the sample
             AWPolyElement el;
-            el.time = yarp::os::Time::now();
+            el.time = tauJStamps.size() > 0 ? tauJStamps[0] : yarp::os::Time::now();
+            for(int i=1; i < (int)tauJStamps.size(); i++ )
+            {
+                el.time = std::max(el.time,tauJStamps[i]);
+            }
+
+            ///< reject the outliers before they reach the filters
+            int rejected = tauJOutlierRejector.filter(tauJ, el.time, getRate()*1e-3);
+            if( rejected > 0 && tauJOutliersTelemetrySource >= 0 )
+            {
+                sensors->getTelemetry()->recordRejectedSample(tauJOutliersTelemetrySource, rejected);
+            }
 
             estimates.lastTauJ = tauJFilt->filt(tauJ);  ///< low pass filter
 
@@ -861,14 +1215,20 @@ void yarpWholeBodyEstimator::run()
                     = this->joint_to_motor_torque_coupling*toEigen(estimates.lastTauJ);
             }
 
-            //Here there are some inefficencies... \todo TODO FIXME
-            el.data = tauJ;
-            estimates.lastDtauJ = dTauJFilt->estimate(el);  ///< derivative filter
-
-            if( this->motor_quantites_estimation_enabled )
+            ///< feed the derivative filters only with new samples, to avoid duplicated times in their windows
+            if( el.time > lastTauJStamp )
             {
-                el.data = estimates.lastTauM;
-                estimates.lastDtauM = dTauMFilt->estimate(el);  ///< derivative filter
+                lastTauJStamp = el.time;
+
+                //Here there are some inefficencies... \todo TODO FIXME
+                el.data = tauJ;
+                estimates.lastDtauJ = dTauJFilt->estimate(el);  ///< derivative filter
+
+                if( this->motor_quantites_estimation_enabled )
+                {
+                    el.data = estimates.lastTauM;
+                    estimates.lastDtauM = dTauMFilt->estimate(el);  ///< derivative filter
+                }
             }
         }
 
@@ -914,6 +1274,74 @@ void yarpWholeBodyEstimator::run()
     return;
 }
 
+bool yarpWholeBodyEstimator::computeForceTorqueEstimates(bool sensorsChanged)
+{
+    if( sensorsChanged )
+    {
+        ftEstimator->setJointList(sensors->getSensorList(SENSOR_ENCODER_POS));
+        ftEstimator->setJointTorqueList(sensors->getSensorList(SENSOR_TORQUE));
+    }
+
+    ///< the contact configurations are cached by the force/torque estimator, switching between them is cheap
+    if( externalWrenchFramesChanged )
+    {
+        ///< on failure no contact configuration is active, and every estimation fails until the frames change again
+        if( !ftEstimator->setContactFrames(externalWrenchFrames.size() > 0 ? externalWrenchFrames : defaultContactFrames) )
+        {
+            yError() << "yarpWholeBodyEstimator: the contact frames can not be used, external wrenches and joint torques will not be estimated";
+        }
+        estimates.lastExternalWrenches.resize(6*externalWrenchFrames.size(), 0.0);
+        externalWrenchesValid = false;
+        externalWrenchFramesChanged = false;
+    }
+
+    ///< force/torque sensors may have been added or removed at runtime
+    int nrOfFTSensors = sensors->getSensorNumber(SENSOR_FORCE_TORQUE);
+    if( nrOfFTSensors != ftEstimator->getNrOfForceTorqueSensors() || (int)ft.size() != 6*nrOfFTSensors )
+    {
+        ftEstimator->setForceTorqueSensorList(sensors->getSensorList(SENSOR_FORCE_TORQUE));
+        ft.resize(6*nrOfFTSensors, 0.0);
+        ftStamps.resize(nrOfFTSensors, 0.0);
+        estimates.lastCompensatedFT.resize(6*nrOfFTSensors, 0.0);
+    }
+
+    if( nrOfFTSensors == 0 || !sensors->readSensors(SENSOR_FORCE_TORQUE, ft.data(), ftStamps.data(), false) )
+    {
+        externalWrenchesValid = false;
+        return false;
+    }
+
+    ftEstimator->updateKinematics(estimates.lastQ.data(), estimates.lastDq.data(), estimates.lastD2q.data());
+    if( compensateForceTorque )
+    {
+        ftEstimator->computeCompensatedForceTorque(ft.data(), estimates.lastCompensatedFT.data());
+    }
+    if( externalWrenchFrames.size() > 0 || estimateJointTorquesFromFT )
+    {
+        ///< the joint torques are estimated in the order of the SENSOR_TORQUE list, as the ESTIMATE_JOINT_TORQUE estimates
+        bool torquesFit = sensors->getSensorNumber(SENSOR_TORQUE) <= (int)tauJ.size();
+        bool ok = ftEstimator->estimateExternalWrenchesAndJointTorques(ft.data(),
+                        externalWrenchFrames.size() > 0 ? estimates.lastExternalWrenches.data() : 0,
+                        estimateJointTorquesFromFT && torquesFit ? tauJ.data() : 0);
+        if( ok != forceTorqueEstimationOk )
+        {
+            if( !ok ) yWarning() << "yarpWholeBodyEstimator: model based estimation of external wrenches and joint torques failed, the estimates are not available";
+            else      yInfo() << "yarpWholeBodyEstimator: model based estimation of external wrenches and joint torques recovered";
+            forceTorqueEstimationOk = ok;
+        }
+        externalWrenchesValid = ok && externalWrenchFrames.size() > 0;
+        if( ok && estimateJointTorquesFromFT && torquesFit )
+        {
+            ///< the estimated torques are as recent as the most recent force/torque measurement
+            double stamp = ftStamps[0];
+            for(int i=1; i < (int)ftStamps.size(); i++ ) stamp = std::max(stamp, ftStamps[i]);
+            tauJStamps = stamp;
+            return true;
+        }
+    }
+    return false;
+}
+
 void yarpWholeBodyEstimator::threadRelease()
 {
     //this causes a memory access violation (to investigate)
@@ -927,6 +1355,43 @@ void yarpWholeBodyEstimator::threadRelease()
     if(velocitiesFilt!=0) { delete velocitiesFilt; velocitiesFilt=0; }
 }
 
+void yarpWholeBodyEstimator::rebuildFilters()
+{
+    int dof = q.size();
+    yInfo() << "yarpWholeBodyEstimator: sensors changed (" << dof << " joints), rebuilding the filters";
+
+    threadRelease();
+
+    // the joints may have been remapped even if their number did not change
+    qOutlierRejector.reset();
+    tauJOutlierRejector.reset();
+
+    estimates.lastQ.zero();
+    estimates.lastDq.zero();
+    estimates.lastD2q.zero();
+    estimates.lastTauJ.zero();
+    estimates.lastPwm.zero();
+    lastTauJStamp = -std::numeric_limits<double>::max();
+
+    dqFilt = new AWLinEstimator(dqFiltWL, dqFiltTh);
+    d2qFilt = new AWQuadEstimator(d2qFiltWL, d2qFiltTh);
+    dTauJFilt = new AWLinEstimator(dTauJFiltWL, dTauJFiltTh);
+    dTauMFilt = new AWLinEstimator(dTauMFiltWL, dTauMFiltTh);
+    tauJFilt    = new FirstOrderLowPassFilter(tauJCutFrequency, getRate()*1e-3, estimates.lastTauJ);
+    tauMFilt    = new FirstOrderLowPassFilter(tauMCutFrequency, getRate()*1e-3, estimates.lastTauJ);
+    pwmFilt     = new FirstOrderLowPassFilter(pwmCutFrequency, getRate()*1e-3, estimates.lastPwm);
+    velocitiesFilt = new FirstOrderLowPassFilter(velocitiesCutFrequency > 0 ? velocitiesCutFrequency : 3, getRate()*1e-3, estimates.lastDq);
+
+    localFltBaseStateEstimator.changeDoF(dof);
+
+    // the coupling matrices are loaded at init for the initial joints
+    if( motor_quantites_estimation_enabled && joint_to_motor_kinematic_coupling.rows() != dof )
+    {
+        yWarning() << "yarpWholeBodyEstimator: joint coupling does not match the new joints, disabling motor quantities estimation";
+        motor_quantites_estimation_enabled = false;
+    }
+}
+
 void yarpWholeBodyEstimator::lockAndResizeAll(int n)
 {
     mutex.wait();
@@ -936,6 +1401,8 @@ void yarpWholeBodyEstimator::lockAndResizeAll(int n)
 
 void yarpWholeBodyEstimator::resizeAll(int n)
 {
+    qOutlierRejector.resize(n);
+    tauJOutlierRejector.resize(n);
     q.resize(n);
     dq.resize(n);
     d2q.resize(n);
@@ -979,6 +1446,91 @@ bool yarpWholeBodyEstimator::lockAndCopyVectorElement(int index, const Vector &s
     return true;
 }
 
+bool yarpWholeBodyEstimator::lockAndCopyVectorBlock(int index, int size, const Vector &src, double *dest)
+{
+    mutex.wait();
+    bool ok = index >= 0 && (index+1)*size <= (int)src.size();
+    if( ok )
+    {
+        memcpy(dest, src.data()+index*size, sizeof(double)*size);
+    }
+    mutex.post();
+    return ok;
+}
+
+bool yarpWholeBodyEstimator::lockAndCopyJointTorqueEstimates(int i, const Vector &src, double *dest)
+{
+    mutex.wait();
+    bool ok = tauJEstimatesValid;
+    ///< the torques of the joints not in the model can not be estimated from the force/torque sensors
+    int nrOfTorques = sensors->getSensorNumber(SENSOR_TORQUE);
+    for(int j = (i < 0 ? 0 : i); ok && estimateJointTorquesFromFT && j < (i < 0 ? nrOfTorques : i+1); j++ )
+    {
+        ok = ftEstimator->canEstimateJointTorque(j);
+    }
+    if( ok && i < 0 )
+    {
+        ok = nrOfTorques <= (int)src.size();
+        if( ok ) memcpy(dest, src.data(), sizeof(double)*nrOfTorques);
+    }
+    else if( ok )
+    {
+        ok = i < nrOfTorques && i < (int)src.size();
+        if( ok ) *dest = src[i];
+    }
+    mutex.post();
+    return ok;
+}
+
+bool yarpWholeBodyEstimator::lockAndCopyExternalWrenches(int i, double *dest)
+{
+    mutex.wait();
+    bool ok = externalWrenchesValid;
+    if( ok && i < 0 )
+    {
+        memcpy(dest, estimates.lastExternalWrenches.data(), sizeof(double)*estimates.lastExternalWrenches.size());
+    }
+    else if( ok )
+    {
+        ok = (i+1)*6 <= (int)estimates.lastExternalWrenches.size();
+        if( ok ) memcpy(dest, estimates.lastExternalWrenches.data()+i*6, sizeof(double)*6);
+    }
+    mutex.post();
+    return ok;
+}
+
+int yarpWholeBodyEstimator::lockAndAddExternalWrenchFrames(const IDList &frames)
+{
+    mutex.wait();
+    int added = 0;
+    for(int i=0; i < (int)frames.size(); i++ )
+    {
+        wbi::ID frame;
+        frames.indexToID(i, frame);
+        if( ftEstimator == 0 || !ftEstimator->hasFrame(frame) )
+        {
+            yError() << "yarpWholeBodyEstimator: frame " << frame.toString() << " not found in the model of the force/torque estimation";
+            continue;
+        }
+        if( externalWrenchFrames.addID(frame) )
+        {
+            added++;
+        }
+    }
+    externalWrenchFramesChanged = externalWrenchFramesChanged || added > 0;
+    mutex.post();
+    return added;
+}
+
+bool yarpWholeBodyEstimator::lockAndRemoveExternalWrenchFrame(const ID &frame)
+{
+    mutex.wait();
+    bool removed = externalWrenchFrames.removeID(frame);
+    externalWrenchFramesChanged = externalWrenchFramesChanged || removed;
+    mutex.post();
+    return removed;
+}
+
 bool yarpWholeBodyEstimator::lockAndSetEstimationParameter(const EstimateType et, const EstimationParameter ep, const void *value)
 {
     bool res = false;
@@ -0,0 +1,135 @@
+/*
+ * Copyright (C) 2026 yarp-wholebodyinterface authors
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+
+/**
+ * \infile Tests for the joint outlier rejection of the state estimator (jointOutlierRejector).
+ */
+#include <yarp/sig/Vector.h>
+
+#include "yarpWholeBodyStates.h"
+
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+using namespace yarp::sig;
+using namespace yarpWbi;
+
+const double TOL = 1e-12;
+const double DT = 0.01;
+
+bool check(bool condition, const std::string & what)
+{
+    if( !condition )
+    {
+        std::cerr << "[ERR] jointOutlierRejectorTest: " << what << std::endl;
+    }
+    return condition;
+}
+
+/** Filter the sample (x0,x1) and check the output and the number of rejected readings. */
+bool checkFilter(jointOutlierRejector & rejector, double x0, double x1, double time,
+                 double expected0, double expected1, int expectedRejected, const std::string & what)
+{
+    Vector x(2);
+    x[0] = x0;
+    x[1] = x1;
+    int rejected = rejector.filter(x, time, DT);
+    bool ok = true;
+    ok = check(rejected == expectedRejected, what + ": wrong number of rejected readings") && ok;
+    ok = check(x[0] - expected0 < TOL && expected0 - x[0] < TOL, what + ": wrong output of joint 0") && ok;
+    ok = check(x[1] - expected1 < TOL && expected1 - x[1] < TOL, what + ": wrong output of joint 1") && ok;
+    return ok;
+}
+
+bool testNone()
+{
+    jointOutlierRejector rejector;
+    rejector.configure(OUTLIER_REJECTION_NONE);
+    rejector.resize(2);
+    bool ok = true;
+    ok = checkFilter(rejector, 0.0, 1.0, 0.0,   0.0, 1.0, 0, "none, first sample") && ok;
+    ok = checkFilter(rejector, 0.0, 1.0, DT,    0.0, 1.0, 0, "none, second sample") && ok;
+    ok = checkFilter(rejector, 10.0, 1.0, 2*DT, 10.0, 1.0, 0, "none, spike") && ok;
+    return ok;
+}
+
+bool testMedian3()
+{
+    jointOutlierRejector rejector;
+    rejector.configure(OUTLIER_REJECTION_MEDIAN3);
+    rejector.resize(2);
+    bool ok = true;
+    // the first two samples fill the history
+    ok = checkFilter(rejector, 0.0, 1.0, 0.0,    0.0, 1.0, 0, "median3, first sample") && ok;
+    ok = checkFilter(rejector, 0.01, 1.0, DT,    0.01, 1.0, 0, "median3, second sample") && ok;
+    // a single sample spike of joint 0 is removed, joint 1 is untouched
+    ok = checkFilter(rejector, 10.0, 1.0, 2*DT,  0.01, 1.0, 1, "median3, spike") && ok;
+    ok = checkFilter(rejector, 0.03, 1.0, 3*DT,  0.03, 1.0, 0, "median3, after the spike") && ok;
+    return ok;
+}
+
+bool testRateLimit()
+{
+    jointOutlierRejector rejector;
+    rejector.configure(OUTLIER_REJECTION_RATE_LIMIT, 1.0);
+    rejector.resize(2);
+    bool ok = true;
+    ok = checkFilter(rejector, 0.0, 1.0, 0.0,    0.0, 1.0, 0, "rate limit, first sample") && ok;
+    ok = checkFilter(rejector, 0.0, 1.0, DT,     0.0, 1.0, 0, "rate limit, second sample") && ok;
+    // a step of joint 0 is held for two samples, then accepted as a real change
+    ok = checkFilter(rejector, 1.0, 1.0, 2*DT,   0.0, 1.0, 1, "rate limit, step") && ok;
+    ok = checkFilter(rejector, 1.0, 1.0, 3*DT,   0.0, 1.0, 1, "rate limit, step held") && ok;
+    ok = checkFilter(rejector, 1.0, 1.0, 4*DT,   1.0, 1.0, 0, "rate limit, step accepted") && ok;
+    ok = checkFilter(rejector, 1.005, 1.0, 5*DT, 1.005, 1.0, 0, "rate limit, change within the bound") && ok;
+    // when the time does not advance the fallback time step is used
+    ok = checkFilter(rejector, 1.01, 1.0, 5*DT,  1.01, 1.0, 0, "rate limit, fallback time step") && ok;
+    ok = checkFilter(rejector, 1.01, 1.5, 5*DT,  1.01, 1.0, 1, "rate limit, jump with the fallback time step") && ok;
+    return ok;
+}
+
+bool testResizeAndReset()
+{
+    jointOutlierRejector rejector;
+    rejector.configure(OUTLIER_REJECTION_RATE_LIMIT, 1.0);
+    rejector.resize(2);
+    bool ok = true;
+    ok = checkFilter(rejector, 0.0, 0.0, 0.0,   0.0, 0.0, 0, "resize, first sample") && ok;
+    ok = checkFilter(rejector, 0.0, 0.0, DT,    0.0, 0.0, 0, "resize, second sample") && ok;
+
+    // resizing to the same number of joints keeps the history
+    rejector.resize(2);
+    ok = checkFilter(rejector, 1.0, 0.0, 2*DT,  0.0, 0.0, 1, "resize to the same size") && ok;
+
+    // after a reset the history is rebuilt, so the jumps are accepted
+    rejector.reset();
+    ok = checkFilter(rejector, 5.0, 5.0, 3*DT,  5.0, 5.0, 0, "reset, first sample") && ok;
+    ok = checkFilter(rejector, 5.0, 5.0, 4*DT,  5.0, 5.0, 0, "reset, second sample") && ok;
+    ok = checkFilter(rejector, 6.0, 5.0, 5*DT,  5.0, 5.0, 1, "reset, step") && ok;
+
+    // resizing to a different number of joints resets the history
+    rejector.resize(3);
+    rejector.resize(2);
+    ok = checkFilter(rejector, 9.0, 9.0, 6*DT,  9.0, 9.0, 0, "resize to a different size") && ok;
+    return ok;
+}
+
+int main(int argc, char * argv[])
+{
+    bool ok = true;
+    ok = testNone() && ok;
+    ok = testMedian3() && ok;
+    ok = testRateLimit() && ok;
+    ok = testResizeAndReset() && ok;
+
+    if( !ok )
+    {
+        std::cerr << "jointOutlierRejectorTest failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "jointOutlierRejectorTest passed" << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -0,0 +1,225 @@
+/*
+ * Copyright (C) 2026 yarp-wholebodyinterface authors
+ * CopyPolicy: Released under the terms of the LGPLv2.1 or later, see LGPL.TXT
+ */
+
+
+/**
+ * \infile Tests for the sensor log: the readings written by yarpWholeBodySensorsLog
+ * are read back, in order, by yarpWholeBodySensorsReplay.
+ */
+#include <yarp/os/Network.h>
+#include <yarp/os/Property.h>
+
+#include "yarpWholeBodySensorsLog.h"
+#include "yarpWholeBodySensorsReplay.h"
+
+#include <wbi/wbiConstants.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <fstream>
+#include <iterator>
+#include <iostream>
+#include <string>
+#include <vector>
+
+using namespace yarp::os;
+using namespace wbi;
+using namespace yarpWbi;
+
+const double TOL = 1e-12;
+
+const std::string LOG_FILE = "yarpWholeBodySensorsLogTest.log";
+const std::string CORRUPTED_LOG_FILE = "yarpWholeBodySensorsLogTest_corrupted.log";
+
+const int NR_OF_JOINTS = 3;
+const int FT_SIZE = 6;
+
+bool check(bool condition, const std::string & what)
+{
+    if( !condition )
+    {
+        std::cerr << "[ERR] yarpWholeBodySensorsLogTest: " << what << std::endl;
+    }
+    return condition;
+}
+
+bool checkVector(const double * actual, const double * expected, int n, const std::string & what)
+{
+    for(int i=0; i < n; i++ )
+    {
+        if( actual[i] - expected[i] > TOL || expected[i] - actual[i] > TOL )
+        {
+            std::cerr << "[ERR] yarpWholeBodySensorsLogTest: " << what << ", element " << i
+                      << " is " << actual[i] << " instead of " << expected[i] << std::endl;
+            return false;
+        }
+    }
+    return true;
+}
+
+std::vector<IDList> getSensorIdList()
+{
+    std::vector<IDList> sensorIdList(SENSOR_TYPE_SIZE);
+    sensorIdList[SENSOR_ENCODER_POS].addID(ID("joint0"));
+    sensorIdList[SENSOR_ENCODER_POS].addID(ID("joint1"));
+    sensorIdList[SENSOR_ENCODER_POS].addID(ID("joint2"));
+    sensorIdList[SENSOR_FORCE_TORQUE].addID(ID("ft0"));
+    return sensorIdList;
+}
+
+/** Reading of the encoders in the r-th bulk record. */
+void encoderReading(int r, double * q, double * stamps)
+{
+    for(int j=0; j < NR_OF_JOINTS; j++ )
+    {
+        q[j] = 0.1*r + 0.01*j;
+        stamps[j] = 10.0 + r;
+    }
+}
+
+/** Reading of the force/torque sensor in the r-th record. */
+void ftReading(int r, double * ft, double * stamp)
+{
+    for(int i=0; i < FT_SIZE; i++ )
+    {
+        ft[i] = r - 0.5*i;
+    }
+    *stamp = 20.0 + r;
+}
+
+/**
+ * Write a log with three bulk encoder records, a single encoder record
+ * (between the second and the third bulk record) and two force/torque records.
+ */
+bool writeLog()
+{
+    yarpWholeBodySensorsLog log;
+    if( !check(log.open(LOG_FILE, 1 << 20, getSensorIdList(), 100), "unable to open the log") )
+    {
+        return false;
+    }
+
+    double q[NR_OF_JOINTS], qStamps[NR_OF_JOINTS], ft[FT_SIZE], ftStamp;
+    bool ok = true;
+    encoderReading(0, q, qStamps);
+    ok = ok && log.log(SENSOR_ENCODER_POS, q, qStamps);
+    ftReading(0, ft, &ftStamp);
+    ok = ok && log.log(SENSOR_FORCE_TORQUE, ft, &ftStamp);
+    encoderReading(1, q, qStamps);
+    ok = ok && log.log(SENSOR_ENCODER_POS, q, qStamps);
+    double single = 100.0, singleStamp = 30.0;
+    ok = ok && log.logSensor(SENSOR_ENCODER_POS, 1, &single, &singleStamp);
+    ftReading(1, ft, &ftStamp);
+    ok = ok && log.log(SENSOR_FORCE_TORQUE, ft, &ftStamp);
+    encoderReading(2, q, qStamps);
+    ok = ok && log.log(SENSOR_ENCODER_POS, q, qStamps);
+
+    ok = check(ok, "unable to write the records") && ok;
+    ok = check(log.getDroppedRecords() == 0, "records dropped") && ok;
+    ok = check(log.close(), "unable to close the log") && ok;
+    return ok;
+}
+
+bool openReplay(yarpWholeBodySensorsReplay & replay, const std::string & logFile)
+{
+    Property options;
+    options.fromConfig(("[WBI_SENSORS_OPTIONS]\nreplayLog " + logFile + "\n").c_str());
+    replay.setYarpWbiProperties(options);
+
+    std::vector<IDList> sensorIdList = getSensorIdList();
+    replay.addSensors(SENSOR_ENCODER_POS, sensorIdList[SENSOR_ENCODER_POS]);
+    replay.addSensors(SENSOR_FORCE_TORQUE, sensorIdList[SENSOR_FORCE_TORQUE]);
+    return replay.init();
+}
+
+/** Replay the log as fast as possible: each sensor type is replayed in order. */
+bool replayLog()
+{
+    yarpWholeBodySensorsReplay replay("yarpWholeBodySensorsLogTest");
+    if( !check(openReplay(replay, LOG_FILE), "unable to replay the log") )
+    {
+        return false;
+    }
+
+    bool ok = true;
+    double q[NR_OF_JOINTS], qStamps[NR_OF_JOINTS], expectedQ[NR_OF_JOINTS], expectedStamps[NR_OF_JOINTS];
+
+    // the bulk records, with the single reading of joint1 replayed after the second one
+    for(int r=0; r < 4; r++ )
+    {
+        encoderReading(r < 2 ? r : r-1, expectedQ, expectedStamps);
+        if( r == 2 )
+        {
+            expectedQ[1] = 100.0;
+            expectedStamps[1] = 30.0;
+        }
+        ok = check(replay.readSensors(SENSOR_ENCODER_POS, q, qStamps, false), "encoder record not replayed") && ok;
+        ok = checkVector(q, expectedQ, NR_OF_JOINTS, "replayed encoders") && ok;
+        ok = checkVector(qStamps, expectedStamps, NR_OF_JOINTS, "replayed encoder stamps") && ok;
+    }
+    ok = check(!replay.readSensors(SENSOR_ENCODER_POS, q, qStamps, false), "encoder records replayed after the end of the log") && ok;
+
+    // a single read returns the last replayed reading
+    double single = 0.0, singleStamp = 0.0;
+    ok = check(replay.readSensor(SENSOR_ENCODER_POS, 2, &single, &singleStamp, false), "single encoder read failed") && ok;
+    ok = checkVector(&single, &(expectedQ[2]), 1, "single encoder read") && ok;
+
+    // the force/torque records are replayed independently of the encoder ones
+    double ft[FT_SIZE], ftStamp, expectedFt[FT_SIZE], expectedFtStamp;
+    for(int r=0; r < 2; r++ )
+    {
+        ftReading(r, expectedFt, &expectedFtStamp);
+        ok = check(replay.readSensors(SENSOR_FORCE_TORQUE, ft, &ftStamp, false), "force/torque record not replayed") && ok;
+        ok = checkVector(ft, expectedFt, FT_SIZE, "replayed force/torque") && ok;
+        ok = checkVector(&ftStamp, &expectedFtStamp, 1, "replayed force/torque stamp") && ok;
+    }
+    ok = check(!replay.readSensors(SENSOR_FORCE_TORQUE, ft, &ftStamp, false), "force/torque records replayed after the end of the log") && ok;
+
+    ok = check(replay.isReplayFinished(), "replay not finished") && ok;
+    replay.close();
+    return ok;
+}
+
+/** A file that is not a sensor log (wrong magic) must be rejected. */
+bool replayCorruptedLog()
+{
+    std::ifstream in(LOG_FILE.c_str(), std::ios::binary);
+    std::vector<char> content((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    in.close();
+    if( !check(content.size() > sizeof(SensorsLogFileHeader), "log file too small") )
+    {
+        return false;
+    }
+
+    content[0] = ~content[0];
+    std::ofstream out(CORRUPTED_LOG_FILE.c_str(), std::ios::binary);
+    out.write(&(content[0]), content.size());
+    out.close();
+
+    yarpWholeBodySensorsReplay replay("yarpWholeBodySensorsLogTest");
+    bool ok = check(!openReplay(replay, CORRUPTED_LOG_FILE), "corrupted log accepted");
+    replay.close();
+    return ok;
+}
+
+int main(int argc, char * argv[])
+{
+    Network yarpNet;
+
+    bool ok = writeLog();
+    ok = ok && replayLog();
+    ok = ok && replayCorruptedLog();
+
+    std::remove(LOG_FILE.c_str());
+    std::remove(CORRUPTED_LOG_FILE.c_str());
+
+    if( !ok )
+    {
+        std::cerr << "yarpWholeBodySensorsLogTest failed" << std::endl;
+        return EXIT_FAILURE;
+    }
+    std::cout << "yarpWholeBodySensorsLogTest passed" << std::endl;
+    return EXIT_SUCCESS;
+}
@@ -28,11 +28,38 @@
 
 #include "../include/yarpWholeBodyInterface/yarpWholeBodyActuators.h"
 #include "../include/yarpWholeBodyInterface/yarpWholeBodySensors.h"
+#include "../include/yarpWholeBodyInterface/PIDList.h"
 
 class yarpWbiActuatorsUnitTest : public GazeboYarpServerFixture
 {
 };
 
+/**
+ * Initialize the actuators and the encoders of the double pendulum,
+ * with the options in actuatorsOptions added to the WBI_ACTUATORS_OPTIONS group.
+ */
+bool initDoublePendulum(yarpWbi::yarpWholeBodyActuators & actuators,
+                        yarpWbi::yarpWholeBodySensors & sensors,
+                        const std::string & actuatorsOptions)
+{
+  yarp::os::Property wbiInterfaceProperties;
+  wbiInterfaceProperties.fromConfigFile(std::string(YARP_CONF_PATH)+"/"+"wbi_double_pendulum.ini",true);
+  if( !actuatorsOptions.empty() )
+  {
+    wbiInterfaceProperties.fromConfig(("[WBI_ACTUATORS_OPTIONS]\n"+actuatorsOptions).c_str(),false);
+  }
+
+  actuators.setYarpWbiProperties(wbiInterfaceProperties);
+  sensors.setYarpWbiProperties(wbiInterfaceProperties);
+
+  return actuators.addActuator(wbi::wbiId("upper_joint"))
+         && actuators.addActuator(wbi::wbiId("lower_joint"))
+         && sensors.addSensor(wbi::SENSOR_ENCODER_POS,wbi::wbiId("upper_joint"))
+         && sensors.addSensor(wbi::SENSOR_ENCODER_POS,wbi::wbiId("lower_joint"))
+         && actuators.init()
+         && sensors.init();
+}
+
 /////////////////////////////////////////////////
 /*
 TEST_F(yarpWbiActuatorsUnitTest, basicGazeboYarpLoadingTest)
@@ -125,6 +152,386 @@ TEST_F(yarpWbiActuatorsUnitTest, basicWbiLoadingTest)
   ASSERT_TRUE(doublePendulumActuactors.close());
 }
 
+/////////////////////////////////////////////////
+TEST_F(yarpWbiActuatorsUnitTest, controlModeSwitchTest)
+{
+  Load("double_pendulum.world", false);
+  ASSERT_TRUE(yarp::os::NetworkBase::checkNetwork(1.0));
+
+  yarpWbi::yarpWholeBodyActuators doublePendulumActuactors("test_actuactors");
+  yarpWbi::yarpWholeBodySensors    doublePendulumSensors("test_sensors");
+  ASSERT_TRUE(initDoublePendulum(doublePendulumActuactors,doublePendulumSensors,""));
+
+  yarp::sig::Vector real_q(2), desired_q(2), zero_dq(2,0.0), ref_dq(2,40.0*M_PI/180.0);
+  double tol = 0.1;
+
+  ASSERT_TRUE(doublePendulumActuactors.setControlMode(wbi::CTRL_MODE_POS));
+  ASSERT_TRUE(doublePendulumActuactors.setControlParam(wbi::CTRL_PARAM_REF_VEL, ref_dq.data()));
+  ASSERT_TRUE(doublePendulumActuactors.setControlMode(wbi::CTRL_MODE_VEL, zero_dq.data()));
+
+  // switching back to position, the references passed to setControlMode are sent with the switch
+  ASSERT_TRUE(doublePendulumSensors.readSensors(wbi::SENSOR_ENCODER_POS,real_q.data(),0,true));
+  desired_q[0] = real_q[0] + M_PI/4;
+  desired_q[1] = real_q[1] - M_PI/4;
+  ASSERT_TRUE(doublePendulumActuactors.setControlMode(wbi::CTRL_MODE_POS, desired_q.data()));
+
+  yarp::os::Time::delay(5.0);
+
+  ASSERT_TRUE(doublePendulumSensors.readSensors(wbi::SENSOR_ENCODER_POS,real_q.data(),0,true));
+  EXPECT_NEAR(desired_q[0],real_q[0],tol);
+  EXPECT_NEAR(desired_q[1],real_q[1],tol);
+
+  // a switch to the current mode does not switch the joints again, but still sends the references
+  desired_q[0] = real_q[0] - M_PI/4;
+  desired_q[1] = real_q[1] + M_PI/4;
+  ASSERT_TRUE(doublePendulumActuactors.setControlMode(wbi::CTRL_MODE_POS, desired_q.data()));
+
+  yarp::os::Time::delay(5.0);
+
+  ASSERT_TRUE(doublePendulumSensors.readSensors(wbi::SENSOR_ENCODER_POS,real_q.data(),0,true));
+  EXPECT_NEAR(desired_q[0],real_q[0],tol);
+  EXPECT_NEAR(desired_q[1],real_q[1],tol);
+
+  // the same for a single joint
+  desired_q[1] = real_q[1] - M_PI/4;
+  ASSERT_TRUE(doublePendulumActuactors.setControlMode(wbi::CTRL_MODE_POS, &(desired_q[1]), 1));
+
+  yarp::os::Time::delay(5.0);
+
+  ASSERT_TRUE(doublePendulumSensors.readSensors(wbi::SENSOR_ENCODER_POS,real_q.data(),0,true));
+  EXPECT_NEAR(desired_q[1],real_q[1],tol);
+
+  ASSERT_TRUE(doublePendulumSensors.close());
+  ASSERT_TRUE(doublePendulumActuactors.close());
+}
+
+/////////////////////////////////////////////////
+TEST_F(yarpWbiActuatorsUnitTest, mixedControlModesTest)
+{
+  Load("double_pendulum.world", false);
+  ASSERT_TRUE(yarp::os::NetworkBase::checkNetwork(1.0));
+
+  yarpWbi::yarpWholeBodyActuators doublePendulumActuactors("test_actuactors");
+  yarpWbi::yarpWholeBodySensors    doublePendulumSensors("test_sensors");
+  ASSERT_TRUE(initDoublePendulum(doublePendulumActuactors,doublePendulumSensors,""));
+
+  yarp::sig::Vector real_q(2), start_q(2), ref(2), ref_dq(2,40.0*M_PI/180.0);
+
+  // the joints of the controlboard are in different modes: each mode sends the references of a subset of the axes
+  ASSERT_TRUE(doublePendulumActuactors.setControlMode(wbi::CTRL_MODE_POS));
+  ASSERT_TRUE(doublePendulumActuactors.setControlParam(wbi::CTRL_PARAM_REF_VEL, ref_dq.data()));
+  ref[1] = 0.0;
+  ASSERT_TRUE(doublePendulumActuactors.setControlMode(wbi::CTRL_MODE_VEL, &(ref[1]), 1));
+
+  ASSERT_TRUE(doublePendulumSensors.readSensors(wbi::SENSOR_ENCODER_POS,start_q.data(),0,true));
+  ref[0] = start_q[0] + M_PI/4;
+  ref[1] = 10.0*M_PI/180.0;
+  ASSERT_TRUE(doublePendulumActuactors.setControlReference(ref.data()));
+
+  yarp::os::Time::delay(2.0);
+
+  // joint 0 reaches its position reference, joint 1 moves with its velocity reference
+  ASSERT_TRUE(doublePendulumSensors.readSensors(wbi::SENSOR_ENCODER_POS,real_q.data(),0,true));
+  EXPECT_NEAR(ref[0],real_q[0],0.1);
+  EXPECT_GT(real_q[1]-start_q[1],0.1);
+
+  ref[1] = 0.0;
+  ASSERT_TRUE(doublePendulumActuactors.setControlReference(ref.data()));
+
+  ASSERT_TRUE(doublePendulumSensors.close());
+  ASSERT_TRUE(doublePendulumActuactors.close());
+}
+
+/////////////////////////////////////////////////
+TEST_F(yarpWbiActuatorsUnitTest, asyncReferencesTest)
+{
+  Load("double_pendulum.world", false);
+  ASSERT_TRUE(yarp::os::NetworkBase::checkNetwork(1.0));
+
+  yarpWbi::yarpWholeBodyActuators doublePendulumActuactors("test_actuactors");
+  yarpWbi::yarpWholeBodySensors    doublePendulumSensors("test_sensors");
+  ASSERT_TRUE(initDoublePendulum(doublePendulumActuactors,doublePendulumSensors,"asyncReferences\n"));
+
+  yarp::sig::Vector real_q(2), desired_q(2), ref_dq(2,40.0*M_PI/180.0);
+
+  ASSERT_TRUE(doublePendulumActuactors.setControlMode(wbi::CTRL_MODE_POS));
+  ASSERT_TRUE(doublePendulumActuactors.setControlParam(wbi::CTRL_PARAM_REF_VEL, ref_dq.data()));
+
+  ASSERT_TRUE(doublePendulumSensors.readSensors(wbi::SENSOR_ENCODER_POS,real_q.data(),0,true));
+  desired_q[0] = real_q[0] + M_PI/4;
+  desired_q[1] = real_q[1] + M_PI/4;
+
+  // the references are left to the writer thread of the controlboard, only the last one is sure to be sent
+  for(int i=0; i < 10; i++ )
+  {
+    ASSERT_TRUE(doublePendulumActuactors.setControlReference(desired_q.data()));
+  }
+
+  yarp::os::Time::delay(5.0);
+
+  yarpWbi::ReferenceWriterStatistics statistics;
+  ASSERT_TRUE(doublePendulumActuactors.getReferenceWriterStatistics(0, statistics));
+  EXPECT_GE(statistics.sent, 1u);
+  EXPECT_EQ(statistics.sent + statistics.overwritten, 10u);
+  EXPECT_EQ(statistics.failed, 0u);
+  EXPECT_FALSE(doublePendulumActuactors.getReferenceWriterStatistics(1, statistics));
+
+  ASSERT_TRUE(doublePendulumSensors.readSensors(wbi::SENSOR_ENCODER_POS,real_q.data(),0,true));
+  EXPECT_NEAR(desired_q[0],real_q[0],0.1);
+  EXPECT_NEAR(desired_q[1],real_q[1],0.1);
+
+  ASSERT_TRUE(doublePendulumSensors.close());
+  ASSERT_TRUE(doublePendulumActuactors.close());
+}
+
+/////////////////////////////////////////////////
+TEST_F(yarpWbiActuatorsUnitTest, parallelReferencesTest)
+{
+  Load("double_pendulum.world", false);
+  ASSERT_TRUE(yarp::os::NetworkBase::checkNetwork(1.0));
+
+  yarpWbi::yarpWholeBodyActuators doublePendulumActuactors("test_actuactors");
+  yarpWbi::yarpWholeBodySensors    doublePendulumSensors("test_sensors");
+  ASSERT_TRUE(initDoublePendulum(doublePendulumActuactors,doublePendulumSensors,"parallelReferences\n"));
+
+  yarp::sig::Vector real_q(2), desired_q(2), ref_dq(2,40.0*M_PI/180.0);
+  yarpWbi::ReferenceWriterStatistics statistics;
+
+  ASSERT_TRUE(doublePendulumActuactors.setControlMode(wbi::CTRL_MODE_POS));
+  ASSERT_TRUE(doublePendulumActuactors.setControlParam(wbi::CTRL_PARAM_REF_VEL, ref_dq.data()));
+
+  ASSERT_TRUE(doublePendulumSensors.readSensors(wbi::SENSOR_ENCODER_POS,real_q.data(),0,true));
+  desired_q[0] = real_q[0] - M_PI/4;
+  desired_q[1] = real_q[1] - M_PI/4;
+
+  // the references are sent by the writer of the controlboard before setControlReference returns, none is overwritten
+  for(int i=0; i < 10; i++ )
+  {
+    ASSERT_TRUE(doublePendulumActuactors.setControlReference(desired_q.data()));
+    ASSERT_TRUE(doublePendulumActuactors.getReferenceWriterStatistics(0, statistics));
+    EXPECT_EQ(statistics.sent, (unsigned long)(i+1));
+  }
+  EXPECT_EQ(statistics.overwritten, 0u);
+  EXPECT_EQ(statistics.failed, 0u);
+
+  yarp::os::Time::delay(5.0);
+
+  ASSERT_TRUE(doublePendulumSensors.readSensors(wbi::SENSOR_ENCODER_POS,real_q.data(),0,true));
+  EXPECT_NEAR(desired_q[0],real_q[0],0.1);
+  EXPECT_NEAR(desired_q[1],real_q[1],0.1);
+
+  ASSERT_TRUE(doublePendulumSensors.close());
+  ASSERT_TRUE(doublePendulumActuactors.close());
+}
+
+/////////////////////////////////////////////////
+TEST_F(yarpWbiActuatorsUnitTest, referenceDeadbandTest)
+{
+  Load("double_pendulum.world", false);
+  ASSERT_TRUE(yarp::os::NetworkBase::checkNetwork(1.0));
+
+  // the refresh period must be below the reference watchdog of the controlboards
+  {
+    yarpWbi::yarpWholeBodyActuators doublePendulumActuactors("test_actuactors");
+    yarpWbi::yarpWholeBodySensors    doublePendulumSensors("test_sensors");
+    EXPECT_FALSE(initDoublePendulum(doublePendulumActuactors,doublePendulumSensors,
+                                    "referenceDeadband 0.01\nreferenceRefreshPeriod 0.5\n"));
+    doublePendulumSensors.close();
+    doublePendulumActuactors.close();
+  }
+
+  // the failed init must not leave its ports open
+  yarpWbi::yarpWholeBodyActuators doublePendulumActuactors("test_actuactors");
+  yarpWbi::yarpWholeBodySensors    doublePendulumSensors("test_sensors");
+  ASSERT_TRUE(initDoublePendulum(doublePendulumActuactors,doublePendulumSensors,
+                                 "referenceDeadband 0.01\nreferenceRefreshPeriod 0.1\n"));
+
+  yarp::sig::Vector real_q(2), desired_q(2), ref_dq(2,40.0*M_PI/180.0);
+  yarpWbi::ReferenceFilterStatistics statistics;
+
+  ASSERT_TRUE(doublePendulumActuactors.setControlMode(wbi::CTRL_MODE_POS));
+  ASSERT_TRUE(doublePendulumActuactors.setControlParam(wbi::CTRL_PARAM_REF_VEL, ref_dq.data()));
+  doublePendulumActuactors.resetReferenceFilterStatistics();
+
+  ASSERT_TRUE(doublePendulumSensors.readSensors(wbi::SENSOR_ENCODER_POS,real_q.data(),0,true));
+  desired_q[0] = real_q[0] + M_PI/4;
+  desired_q[1] = real_q[1] + M_PI/4;
+
+  // the first reference is sent, the repeated ones are suppressed until the refresh period elapses
+  for(int i=0; i < 10; i++ )
+  {
+    ASSERT_TRUE(doublePendulumActuactors.setControlReference(desired_q.data()));
+  }
+  ASSERT_TRUE(doublePendulumActuactors.getReferenceFilterStatistics(statistics));
+  EXPECT_EQ(statistics.sent + statistics.filtered, 20u);
+  EXPECT_GE(statistics.sent, 2u);
+  EXPECT_GT(statistics.filtered, 0u);
+
+  // a reference out of the deadband is always sent
+  doublePendulumActuactors.resetReferenceFilterStatistics();
+  desired_q[0] += 0.1;
+  ASSERT_TRUE(doublePendulumActuactors.setControlReference(desired_q.data()));
+  ASSERT_TRUE(doublePendulumActuactors.getReferenceFilterStatistics(statistics));
+  EXPECT_GE(statistics.sent, 1u);
+
+  yarp::os::Time::delay(5.0);
+
+  ASSERT_TRUE(doublePendulumSensors.readSensors(wbi::SENSOR_ENCODER_POS,real_q.data(),0,true));
+  EXPECT_NEAR(desired_q[0],real_q[0],0.1);
+  EXPECT_NEAR(desired_q[1],real_q[1],0.1);
+
+  ASSERT_TRUE(doublePendulumSensors.close());
+  ASSERT_TRUE(doublePendulumActuactors.close());
+}
+
+/////////////////////////////////////////////////
+TEST_F(yarpWbiActuatorsUnitTest, pidGainsAllJointsTest)
+{
+  Load("double_pendulum.world", false);
+  ASSERT_TRUE(yarp::os::NetworkBase::checkNetwork(1.0));
+
+  yarpWbi::yarpWholeBodyActuators doublePendulumActuactors("test_actuactors");
+  yarpWbi::yarpWholeBodySensors    doublePendulumSensors("test_sensors");
+  ASSERT_TRUE(initDoublePendulum(doublePendulumActuactors,doublePendulumSensors,""));
+
+  // the torque pids of all the joints are read and written with one call for the controlboard
+  yarpWbi::PIDList pids(2), newPids(2), readPids(2);
+  ASSERT_TRUE(doublePendulumActuactors.getPIDGains(pids, wbi::CTRL_MODE_TORQUE));
+  newPids = pids;
+  newPids.pidList()[0].kp = pids.pidList()[0].kp + 0.5;
+  newPids.pidList()[1].kp = pids.pidList()[1].kp + 1.0;
+  ASSERT_TRUE(doublePendulumActuactors.setPIDGains(newPids, wbi::CTRL_MODE_TORQUE));
+  ASSERT_TRUE(doublePendulumActuactors.getPIDGains(readPids, wbi::CTRL_MODE_TORQUE));
+  EXPECT_NEAR(newPids.pidList()[0].kp,readPids.pidList()[0].kp,1e-6);
+  EXPECT_NEAR(newPids.pidList()[1].kp,readPids.pidList()[1].kp,1e-6);
+
+  // a single joint reads the same pid
+  yarp::dev::Pid singlePid;
+  ASSERT_TRUE(doublePendulumActuactors.getPIDGains(&singlePid, wbi::CTRL_MODE_TORQUE, 1));
+  EXPECT_NEAR(newPids.pidList()[1].kp,singlePid.kp,1e-6);
+
+  ASSERT_TRUE(doublePendulumActuactors.setPIDGains(pids, wbi::CTRL_MODE_TORQUE));
+
+  // the PWM control mode has no pids, and lists of the wrong size are rejected
+  EXPECT_FALSE(doublePendulumActuactors.getPIDGains(readPids, wbi::CTRL_MODE_MOTOR_PWM));
+  EXPECT_FALSE(doublePendulumActuactors.setPIDGains(pids, wbi::CTRL_MODE_MOTOR_PWM));
+  yarpWbi::PIDList wrongSizePids(3);
+  EXPECT_FALSE(doublePendulumActuactors.getPIDGains(wrongSizePids, wbi::CTRL_MODE_TORQUE));
+
+  ASSERT_TRUE(doublePendulumSensors.close());
+  ASSERT_TRUE(doublePendulumActuactors.close());
+}
+
+/////////////////////////////////////////////////
+TEST_F(yarpWbiActuatorsUnitTest, cacheControlReferencesTest)
+{
+  Load("double_pendulum.world", false);
+  ASSERT_TRUE(yarp::os::NetworkBase::checkNetwork(1.0));
+
+  yarpWbi::yarpWholeBodyActuators doublePendulumActuactors("test_actuactors");
+  yarpWbi::yarpWholeBodySensors    doublePendulumSensors("test_sensors");
+  ASSERT_TRUE(initDoublePendulum(doublePendulumActuactors,doublePendulumSensors,
+                                 "cacheControlReferences\ncontrolReferencesVerificationPeriod 0\n"));
+
+  yarp::sig::Vector real_q(2), desired_q(2), read_q(2), zero_dq(2,0.0), ref_dq(2,40.0*M_PI/180.0);
+
+  ASSERT_TRUE(doublePendulumActuactors.setControlMode(wbi::CTRL_MODE_POS));
+  ASSERT_TRUE(doublePendulumActuactors.setControlParam(wbi::CTRL_PARAM_REF_VEL, ref_dq.data()));
+
+  ASSERT_TRUE(doublePendulumSensors.readSensors(wbi::SENSOR_ENCODER_POS,real_q.data(),0,true));
+  desired_q[0] = real_q[0] + 0.3;
+  desired_q[1] = real_q[1] - 0.3;
+  ASSERT_TRUE(doublePendulumActuactors.setControlReference(desired_q.data()));
+
+  // the commanded references are returned without contacting the controlboards
+  ASSERT_TRUE(doublePendulumActuactors.getControlReferences(wbi::CTRL_MODE_POS, read_q.data()));
+  EXPECT_DOUBLE_EQ(desired_q[0],read_q[0]);
+  EXPECT_DOUBLE_EQ(desired_q[1],read_q[1]);
+  desired_q[1] += 0.1;
+  ASSERT_TRUE(doublePendulumActuactors.setControlReference(&(desired_q[1]), 1));
+  ASSERT_TRUE(doublePendulumActuactors.getControlReferences(wbi::CTRL_MODE_POS, &(read_q[1]), 1));
+  EXPECT_DOUBLE_EQ(desired_q[1],read_q[1]);
+
+  // a mode change invalidates only the reference of the switched joint, the one sent with the switch is cached again
+  ASSERT_TRUE(doublePendulumActuactors.setControlMode(wbi::CTRL_MODE_VEL, &(zero_dq[0]), 0));
+  ASSERT_TRUE(doublePendulumActuactors.setControlMode(wbi::CTRL_MODE_POS, &(desired_q[0]), 0));
+  ASSERT_TRUE(doublePendulumActuactors.getControlReferences(wbi::CTRL_MODE_POS, read_q.data()));
+  EXPECT_DOUBLE_EQ(desired_q[0],read_q[0]);
+  EXPECT_DOUBLE_EQ(desired_q[1],read_q[1]);
+
+  // the joint index must be smaller than the number of actuators
+  EXPECT_FALSE(doublePendulumActuactors.setControlMode(wbi::CTRL_MODE_POS, desired_q.data(), 2));
+  EXPECT_FALSE(doublePendulumActuactors.setControlReference(desired_q.data(), 2));
+  EXPECT_FALSE(doublePendulumActuactors.getControlReferences(wbi::CTRL_MODE_POS, read_q.data(), 2));
+  EXPECT_FALSE(doublePendulumActuactors.getControlReferencesFromControlBoards(wbi::CTRL_MODE_POS, read_q.data(), 2));
+
+  ASSERT_TRUE(doublePendulumSensors.close());
+  ASSERT_TRUE(doublePendulumActuactors.close());
+}
+
+/////////////////////////////////////////////////
+TEST_F(yarpWbiActuatorsUnitTest, referenceLimiterTest)
+{
+  Load("double_pendulum.world", false);
+  ASSERT_TRUE(yarp::os::NetworkBase::checkNetwork(1.0));
+
+  yarpWbi::yarpWholeBodyActuators doublePendulumActuactors("test_actuactors");
+  yarpWbi::yarpWholeBodySensors    doublePendulumSensors("test_sensors");
+  ASSERT_TRUE(initDoublePendulum(doublePendulumActuactors,doublePendulumSensors,
+                                 "referenceLimiter\nreferencePositionLimits ((upper_joint -0.5 0.5) (lower_joint -0.5 0.5))\nmaxVelocityReference 0.2\n"));
+
+  yarp::sig::Vector real_q(2), desired_q(2), desired_dq(2), ref_dq(2,40.0*M_PI/180.0);
+  yarpWbi::ReferenceLimiterStatistics statistics;
+
+  ASSERT_TRUE(doublePendulumActuactors.setControlMode(wbi::CTRL_MODE_POS));
+  ASSERT_TRUE(doublePendulumActuactors.setControlParam(wbi::CTRL_PARAM_REF_VEL, ref_dq.data()));
+  doublePendulumActuactors.resetReferenceLimiterStatistics();
+
+  // the position references are clamped to the configured limits
+  desired_q[0] = 1.0;
+  desired_q[1] = -1.0;
+  ASSERT_TRUE(doublePendulumActuactors.setControlReference(desired_q.data()));
+  for(int j=0; j < 2; j++ )
+  {
+    ASSERT_TRUE(doublePendulumActuactors.getReferenceLimiterStatistics(j, statistics));
+    EXPECT_EQ(statistics.saturations, 1u);
+  }
+
+  yarp::os::Time::delay(5.0);
+
+  ASSERT_TRUE(doublePendulumSensors.readSensors(wbi::SENSOR_ENCODER_POS,real_q.data(),0,true));
+  EXPECT_NEAR(0.5,real_q[0],0.1);
+  EXPECT_NEAR(-0.5,real_q[1],0.1);
+
+  // the references sent with a mode switch go through the limiter of the new mode
+  doublePendulumActuactors.resetReferenceLimiterStatistics();
+  desired_dq[0] = 1.0;
+  desired_dq[1] = 0.1;
+  ASSERT_TRUE(doublePendulumActuactors.setControlMode(wbi::CTRL_MODE_VEL, desired_dq.data()));
+  ASSERT_TRUE(doublePendulumActuactors.getReferenceLimiterStatistics(0, statistics));
+  EXPECT_EQ(statistics.saturations, 1u);
+  ASSERT_TRUE(doublePendulumActuactors.getReferenceLimiterStatistics(1, statistics));
+  EXPECT_EQ(statistics.saturations, 0u);
+
+  // also the ones sent with the switch of a single joint
+  desired_dq[1] = -1.0;
+  ASSERT_TRUE(doublePendulumActuactors.setControlMode(wbi::CTRL_MODE_VEL, &(desired_dq[1]), 1));
+  ASSERT_TRUE(doublePendulumActuactors.getReferenceLimiterStatistics(1, statistics));
+  EXPECT_EQ(statistics.saturations, 1u);
+
+  EXPECT_FALSE(doublePendulumActuactors.getReferenceLimiterStatistics(2, statistics));
+  doublePendulumActuactors.resetReferenceLimiterStatistics();
+  ASSERT_TRUE(doublePendulumActuactors.getReferenceLimiterStatistics(0, statistics));
+  EXPECT_EQ(statistics.saturations, 0u);
+  EXPECT_EQ(statistics.rateLimitations, 0u);
+
+  desired_dq.zero();
+  ASSERT_TRUE(doublePendulumActuactors.setControlReference(desired_dq.data()));
+
+  ASSERT_TRUE(doublePendulumSensors.close());
+  ASSERT_TRUE(doublePendulumActuactors.close());
+}
+
 /////////////////////////////////////////////////
 /// Main
 int main(int argc, char **argv)